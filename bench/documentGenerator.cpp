@@ -0,0 +1,260 @@
+// bench/documentGenerator.cpp
+#include "documentGenerator.hpp"
+
+#include <stdexcept>
+
+namespace {
+
+// splitmix64, fully specified so generated documents never depend on the standard library
+class Random {
+public:
+    explicit Random(uint64_t seed) : state(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    // Uniform in [low, high]
+    int64_t range(int64_t low, int64_t high) {
+        return low + static_cast<int64_t>(next() % static_cast<uint64_t>(high - low + 1));
+    }
+
+private:
+    uint64_t state;
+};
+
+// Random values are appended one statement at a time: the operands of a + chain are not
+// sequenced, so two draws in one expression could be taken in a different order per compiler
+void appendInt(std::string& out, Random& random, int64_t low, int64_t high) {
+    out += std::to_string(random.range(low, high));
+}
+
+// Doubles with a fixed number of decimals print identically everywhere
+void appendDecimal(std::string& out, Random& random) {
+    int64_t cents = random.range(-10000000, 10000000);
+    if (cents < 0) {
+        out += '-';
+        cents = -cents;
+    }
+    out += std::to_string(cents / 100);
+    out += '.';
+    out += static_cast<char>('0' + (cents / 10) % 10);
+    out += static_cast<char>('0' + cents % 10);
+}
+
+const char* const Levels[] = {"DEBUG", "INFO", "INFO", "INFO", "WARN", "ERROR"};
+const char* const Methods[] = {"GET", "GET", "POST", "PUT", "DELETE"};
+const char* const Resources[] = {"items", "users", "orders", "sessions"};
+
+} // namespace
+
+std::vector<std::string> DocumentGenerator::shapes() {
+    return {"deep", "wide", "numeric", "scientific", "logs", "ndjson"};
+}
+
+BenchDocument DocumentGenerator::generate(const std::string& shape, size_t targetBytes, uint64_t seed) {
+    if (shape == "deep") {
+        return deep(targetBytes, seed);
+    }
+    if (shape == "wide") {
+        return wide(targetBytes, seed);
+    }
+    if (shape == "numeric") {
+        return numeric(targetBytes, seed);
+    }
+    if (shape == "scientific") {
+        return scientific(targetBytes, seed);
+    }
+    if (shape == "logs") {
+        return logs(targetBytes, seed);
+    }
+    if (shape == "ndjson") {
+        return ndjson(targetBytes, seed);
+    }
+    throw std::runtime_error("Unknown document shape: " + shape);
+}
+
+// Many 32-level chains of nested objects and arrays
+BenchDocument DocumentGenerator::deep(size_t targetBytes, uint64_t seed) {
+    const int depth = 32;
+    Random random(seed);
+    BenchDocument doc;
+    doc.name = "deep";
+    doc.text = "{\"deep\": [";
+
+    size_t chains = 0;
+    while (doc.text.size() < targetBytes) {
+        if (chains++ > 0) {
+            doc.text += ", ";
+        }
+        for (int level = 0; level < depth; ++level) {
+            doc.text += level % 2 == 0 ? "{\"a\": " : "[";
+        }
+        doc.text += "{\"leaf\": [";
+        appendInt(doc.text, random, 0, 1000);
+        doc.text += ", ";
+        appendInt(doc.text, random, 0, 1000);
+        doc.text += "]}";
+        for (int level = depth - 1; level >= 0; --level) {
+            doc.text += level % 2 == 0 ? "}" : "]";
+        }
+    }
+    doc.text += "]}";
+
+    std::string path = "deep[" + std::to_string(chains / 2) + "]";
+    for (int level = 0; level < depth; level += 2) {
+        path += ".a[0]";
+    }
+    doc.expressions = {path + ".leaf[1]", "max(" + path + ".leaf)", "size(deep)"};
+    return doc;
+}
+
+// One object with a very large number of members
+BenchDocument DocumentGenerator::wide(size_t targetBytes, uint64_t seed) {
+    Random random(seed);
+    BenchDocument doc;
+    doc.name = "wide";
+    doc.text = "{\"wide\": {";
+
+    size_t members = 0;
+    while (doc.text.size() < targetBytes) {
+        if (members > 0) {
+            doc.text += ", ";
+        }
+        doc.text += "\"k" + std::to_string(members) + "\": ";
+        if (members % 2 == 0) {
+            doc.text += std::to_string(random.range(-1000000, 1000000));
+        } else {
+            doc.text += "\"value-" + std::to_string(random.next() % 100000) + "\"";
+        }
+        ++members;
+    }
+    doc.text += "}}";
+
+    doc.expressions = {"wide.k" + std::to_string((members - 1) & ~size_t(1)), "wide.k1", "size(wide)"};
+    return doc;
+}
+
+// Two huge homogeneous arrays, the telemetry case
+BenchDocument DocumentGenerator::numeric(size_t targetBytes, uint64_t seed) {
+    Random random(seed);
+    BenchDocument doc;
+    doc.name = "numeric";
+
+    std::string ints = "[";
+    std::string doubles = "[";
+    while (ints.size() + doubles.size() < targetBytes) {
+        if (ints.size() > 1) {
+            ints += ", ";
+            doubles += ", ";
+        }
+        ints += std::to_string(random.range(-1000000000, 1000000000));
+        appendDecimal(doubles, random);
+    }
+    doc.text = "{\"ints\": " + ints + "], \"doubles\": " + doubles + "]}";
+
+    doc.expressions = {"max(ints)", "min(doubles)", "max(ints, doubles)", "size(ints)", "sum(ints)", "avg(doubles[1:])"};
+    return doc;
+}
+
+// Exponents, long mantissas and integers past int64: the number forms that leave the integer path
+BenchDocument DocumentGenerator::scientific(size_t targetBytes, uint64_t seed) {
+    Random random(seed);
+    BenchDocument doc;
+    doc.name = "scientific";
+    doc.text = "{\"values\": [";
+
+    size_t count = 0;
+    while (doc.text.size() < targetBytes) {
+        if (count++ > 0) {
+            doc.text += ", ";
+        }
+        int64_t kind = random.range(0, 3);
+        if (kind == 0) {
+            appendInt(doc.text, random, -9, 9);
+            doc.text += '.';
+            appendInt(doc.text, random, 100000, 999999);
+            doc.text += random.next() % 2 ? "e-" : "e+";
+            appendInt(doc.text, random, 0, 300);
+        } else if (kind == 1) {
+            // Beyond int64, promoted to double
+            appendInt(doc.text, random, 10, 99);
+            appendInt(doc.text, random, 100000000000000000, 999999999999999999);
+        } else if (kind == 2) {
+            doc.text += "0.";
+            appendInt(doc.text, random, 1000000000000000, 9999999999999999);
+        } else {
+            appendInt(doc.text, random, -4000000000000000000, 4000000000000000000);
+        }
+    }
+    doc.text += "]}";
+
+    doc.expressions = {"max(values)", "min(values)", "size(values)"};
+    return doc;
+}
+
+// Structured log records with string-heavy, partly escaped messages
+BenchDocument DocumentGenerator::logs(size_t targetBytes, uint64_t seed) {
+    Random random(seed);
+    BenchDocument doc;
+    doc.name = "logs";
+    doc.text = "{\"logs\": [";
+
+    size_t records = 0;
+    int64_t timestamp = 1700000000000;
+    while (doc.text.size() < targetBytes) {
+        if (records++ > 0) {
+            doc.text += ", ";
+        }
+        timestamp += random.range(1, 250);
+        doc.text += "{\"ts\": " + std::to_string(timestamp);
+        doc.text += ", \"level\": \"" + std::string(Levels[random.next() % 6]) + "\"";
+        doc.text += ", \"host\": \"node-" + std::to_string(random.range(1, 64)) + "\"";
+        doc.text += ", \"msg\": \"request \\\"";
+        doc.text += Methods[random.next() % 5];
+        doc.text += " /api/v1/";
+        doc.text += Resources[random.next() % 4];
+        doc.text += "/";
+        appendInt(doc.text, random, 1, 99999);
+        doc.text += "\\\" took ";
+        appendInt(doc.text, random, 1, 900);
+        doc.text += " ms\\n\"";
+        doc.text += ", \"tags\": [\"http\", \"" + std::string(random.next() % 2 ? "cache-hit" : "cache-miss") + "\"]}";
+    }
+    doc.text += "]}";
+
+    doc.expressions = {"logs[" + std::to_string(records / 2) + "].msg", "size(logs[" + std::to_string(records - 1) + "].msg)", "size(logs)",
+                       "max(logs[*].ts)", "count(logs[::2].tags)"};
+    return doc;
+}
+
+// Newline-delimited small records
+BenchDocument DocumentGenerator::ndjson(size_t targetBytes, uint64_t seed) {
+    Random random(seed);
+    BenchDocument doc;
+    doc.name = "ndjson";
+    doc.lines = true;
+
+    size_t records = 0;
+    while (doc.text.size() < targetBytes) {
+        doc.text += "{\"id\": " + std::to_string(records++);
+        doc.text += ", \"user\": \"u" + std::to_string(random.range(1, 50000)) + "\"";
+        doc.text += ", \"value\": ";
+        appendDecimal(doc.text, random);
+        doc.text += ", \"ok\": " + std::string(random.next() % 8 ? "true" : "false");
+        doc.text += ", \"samples\": [";
+        for (int i = 0; i < 3; ++i) {
+            if (i > 0) {
+                doc.text += ", ";
+            }
+            appendInt(doc.text, random, 0, 99);
+        }
+        doc.text += "]}\n";
+    }
+
+    doc.expressions = {"value", "max(samples)", "size(user)"};
+    return doc;
+}
@@ -0,0 +1,46 @@
+// bench/documentGenerator.hpp
+#ifndef DOCUMENT_GENERATOR_HPP
+#define DOCUMENT_GENERATOR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @struct BenchDocument
+ * @brief One synthetic input for json_bench together with the expressions evaluated against it
+ *
+ * NDJSON documents hold one JSON value per line; they are parsed and evaluated line by line.
+ */
+struct BenchDocument {
+    std::string name;
+    std::string text;
+    std::vector<std::string> expressions;
+    bool lines = false;
+};
+
+/**
+ * @class DocumentGenerator
+ * @brief Deterministic generators for realistic document shapes
+ *
+ * Every generator grows its document until it reaches the requested size. The output only depends
+ * on the size and the seed (a fixed splitmix64 stream, no std:: distributions), so the same
+ * arguments produce byte-identical inputs on every platform and release.
+ */
+class DocumentGenerator {
+public:
+    static constexpr uint64_t DefaultSeed = 0x5eed;
+
+    static std::vector<std::string> shapes();
+    static BenchDocument generate(const std::string& shape, size_t targetBytes, uint64_t seed = DefaultSeed);
+
+    static BenchDocument deep(size_t targetBytes, uint64_t seed);
+    static BenchDocument wide(size_t targetBytes, uint64_t seed);
+    static BenchDocument numeric(size_t targetBytes, uint64_t seed);
+    static BenchDocument scientific(size_t targetBytes, uint64_t seed);
+    static BenchDocument logs(size_t targetBytes, uint64_t seed);
+    static BenchDocument ndjson(size_t targetBytes, uint64_t seed);
+};
+
+#endif // DOCUMENT_GENERATOR_HPP
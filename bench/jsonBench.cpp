@@ -0,0 +1,712 @@
+// bench/jsonBench.cpp
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "documentGenerator.hpp"
+#include "../include/json_parser/json.hpp"
+#include "../include/json_parser/jsonDocument.hpp"
+#include "../include/json_parser/jsonParser.hpp"
+#include "../include/json_parser/jsonEvaluator.hpp"
+#include "../include/json_parser/jsonPath.hpp"
+#include "../include/json_parser/jsonWriter.hpp"
+#include "../include/json_parser/structuralIndex.hpp"
+
+// ----------
+// ALLOCATION TRACKING
+// ----------
+
+// Every allocation of the process goes through these counters. A header in front of each block
+// remembers its size, so the live heap and its peak can be followed without sized delete.
+namespace {
+
+std::atomic<uint64_t> allocationCount{0};
+std::atomic<int64_t> liveBytes{0};
+std::atomic<int64_t> peakBytes{0};
+
+constexpr size_t HeaderSize = alignof(std::max_align_t);
+
+void* trackedAlloc(size_t size) {
+    void* block = std::malloc(size + HeaderSize);
+    if (block == nullptr) {
+        throw std::bad_alloc();
+    }
+    *static_cast<size_t*>(block) = size;
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    int64_t live = liveBytes.fetch_add(static_cast<int64_t>(size), std::memory_order_relaxed) + static_cast<int64_t>(size);
+    int64_t peak = peakBytes.load(std::memory_order_relaxed);
+    while (live > peak && !peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+    }
+    return static_cast<char*>(block) + HeaderSize;
+}
+
+void trackedFree(void* pointer) {
+    if (pointer == nullptr) {
+        return;
+    }
+    void* block = static_cast<char*>(pointer) - HeaderSize;
+    liveBytes.fetch_sub(static_cast<int64_t>(*static_cast<size_t*>(block)), std::memory_order_relaxed);
+    std::free(block);
+}
+
+} // namespace
+
+void* operator new(size_t size) { return trackedAlloc(size); }
+void* operator new[](size_t size) { return trackedAlloc(size); }
+void operator delete(void* pointer) noexcept { trackedFree(pointer); }
+void operator delete[](void* pointer) noexcept { trackedFree(pointer); }
+void operator delete(void* pointer, size_t) noexcept { trackedFree(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { trackedFree(pointer); }
+
+// std::pmr::new_delete_resource always allocates through the aligned forms. Blocks are aligned to
+// max_align_t, which covers everything the library allocates
+void* operator new(size_t size, std::align_val_t alignment) {
+    if (static_cast<size_t>(alignment) > HeaderSize) {
+        throw std::bad_alloc();
+    }
+    return trackedAlloc(size);
+}
+void operator delete(void* pointer, std::align_val_t) noexcept { trackedFree(pointer); }
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept { trackedFree(pointer); }
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Allocations a DOM parse may make besides its nodes (see checkAllocations), per document
+constexpr uint64_t MaxBookkeepingAllocations = 64;
+
+/**
+ * @brief Allocations and heap growth of one measured call
+ */
+struct HeapUsage {
+    uint64_t allocations = 0;
+    int64_t peakBytes = 0;     // Highest live heap during the call, above the live heap before it
+};
+
+template <class F>
+HeapUsage measureHeap(F&& f) {
+    int64_t before = liveBytes.load();
+    peakBytes.store(before);
+    uint64_t count = allocationCount.load();
+    f();
+    return HeapUsage{allocationCount.load() - count, peakBytes.load() - before};
+}
+
+template <class F>
+double secondsOf(F&& f) {
+    auto start = Clock::now();
+    f();
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+double median(std::vector<double> samples) {
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+// Nearest-rank percentile of sorted samples
+double percentile(const std::vector<double>& sorted, double p) {
+    size_t rank = static_cast<size_t>(p / 100.0 * static_cast<double>(sorted.size()) + 0.5);
+    return sorted[std::min(sorted.size() - 1, rank > 0 ? rank - 1 : 0)];
+}
+
+long peakRssKb() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return static_cast<long>(counters.PeakWorkingSetSize / 1024);
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+#endif
+}
+
+std::string quoted(std::string_view text) {
+    std::string out = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+        }
+        out += c;
+    }
+    return out + "\"";
+}
+
+// Splits NDJSON into its non-empty lines
+std::vector<std::string_view> splitLines(std::string_view text) {
+    std::vector<std::string_view> lines;
+    size_t start = 0;
+    while (start < text.size()) {
+        size_t end = text.find('\n', start);
+        if (end == std::string_view::npos) {
+            end = text.size();
+        }
+        if (end > start) {
+            lines.push_back(text.substr(start, end - start));
+        }
+        start = end + 1;
+    }
+    return lines;
+}
+
+struct Options {
+    bool checkAllocations = false;
+    std::string checkParsers;
+    size_t megabytes = 8;
+    int repeat = 3;
+    int iterations = 200;
+    std::vector<std::string> shapes = DocumentGenerator::shapes();
+    std::string output;
+};
+
+// ----------
+// MEASUREMENTS
+// ----------
+
+/**
+ * @class ShapeBench
+ * @brief Runs every measurement for one generated document and writes its JSON record
+ *
+ * Documents are parsed whole, except NDJSON which is parsed and evaluated one line at a time.
+ */
+class ShapeBench {
+public:
+    ShapeBench(const BenchDocument& doc, const Options& options) : doc(doc), options(options) {
+        if (doc.lines) {
+            lines = splitLines(doc.text);
+        } else {
+            lines.push_back(doc.text);
+        }
+    }
+
+    void run(std::ostream& out) {
+        out << "    {\n";
+        out << "      \"shape\": " << quoted(doc.name) << ",\n";
+        out << "      \"bytes\": " << doc.text.size() << ",\n";
+        out << "      \"documents\": " << lines.size() << ",\n";
+
+        std::vector<Json> doms;
+        std::vector<JsonTape> tapes;
+        out << "      \"parse\": {\n";
+        // The previous run's documents are released only after the new ones are built, so the
+        // measured heap peak is that of one full parse
+        writeParse(out, "dom", [this, &doms]() {
+            std::vector<Json> parsed;
+            parsed.reserve(lines.size());
+            for (std::string_view line : lines) {
+                parsed.push_back(JsonParser::parse(line));
+            }
+            doms.swap(parsed);
+        });
+        out << ",\n";
+        // Same DOM in one arena per document, releasing the previous run frees a few blocks per document
+        std::vector<JsonDocument> documents;
+        writeParse(out, "dom_arena", [this, &documents]() {
+            std::vector<JsonDocument> parsed;
+            parsed.reserve(lines.size());
+            for (std::string_view line : lines) {
+                parsed.emplace_back(line);
+            }
+            documents.swap(parsed);
+        });
+        out << ",\n";
+        writeParse(out, "tape", [this, &tapes]() {
+            std::vector<JsonTape> parsed;
+            parsed.reserve(lines.size());
+            for (std::string_view line : lines) {
+                parsed.push_back(JsonParser::parseTape(line));
+            }
+            tapes.swap(parsed);
+        });
+        out << "\n      },\n";
+
+        out << "      \"evaluate\": [\n";
+        for (size_t i = 0; i < doc.expressions.size(); ++i) {
+            CompiledExpression expression = CompiledExpression::compile(doc.expressions[i]);
+            writeEvaluate(out, doc.expressions[i], "dom", expression, doms);
+            out << ",\n";
+            writeEvaluate(out, doc.expressions[i], "tape", expression, tapes);
+            out << (i + 1 < doc.expressions.size() ? ",\n" : "\n");
+        }
+        out << "      ],\n";
+
+        writeSerialize(out, doms);
+        out << "    }";
+    }
+
+private:
+    const BenchDocument& doc;
+    const Options& options;
+    std::vector<std::string_view> lines;
+
+    template <class F>
+    void writeParse(std::ostream& out, const char* target, F&& parseAll) {
+        std::vector<double> seconds;
+        for (int i = 0; i < options.repeat; ++i) {
+            seconds.push_back(secondsOf(parseAll));
+        }
+        HeapUsage heap = measureHeap(parseAll);
+
+        out << "        " << quoted(target) << ": {"
+            << "\"mb_per_s\": " << static_cast<double>(doc.text.size()) / 1e6 / median(seconds)
+            << ", \"allocations\": " << heap.allocations / lines.size()
+            << ", \"peak_heap_bytes\": " << heap.peakBytes << "}";
+    }
+
+    // Latency of one evaluation as json_eval runs it (results are views), NDJSON spreads the iterations over its documents
+    template <class Document>
+    void writeEvaluate(std::ostream& out, const std::string& text, const char* target,
+                       const CompiledExpression& expression, const std::vector<Document>& documents) {
+        size_t iterations = std::max<size_t>(static_cast<size_t>(options.iterations), doc.lines ? documents.size() : 0);
+        std::vector<double> micros;
+        micros.reserve(iterations);
+        for (size_t i = 0; i < iterations; ++i) {
+            const Document& document = documents[i % documents.size()];
+            micros.push_back(secondsOf([&]() { JsonEvaluator::evaluateRef(document, expression); }) * 1e6);
+        }
+        std::sort(micros.begin(), micros.end());
+        HeapUsage heap = measureHeap([&]() { JsonEvaluator::evaluateRef(documents.front(), expression); });
+
+        out << "        {\"expression\": " << quoted(text) << ", \"target\": " << quoted(target)
+            << ", \"iterations\": " << iterations
+            << ", \"p50_us\": " << percentile(micros, 50) << ", \"p90_us\": " << percentile(micros, 90)
+            << ", \"p99_us\": " << percentile(micros, 99) << ", \"max_us\": " << micros.back()
+            << ", \"allocations\": " << heap.allocations << "}";
+    }
+
+    void writeSerialize(std::ostream& out, const std::vector<Json>& doms) {
+        size_t bytes = 0;
+        auto serializeAll = [&doms, &bytes]() {
+            std::ostringstream text;
+            for (const Json& json : doms) {
+                text << json << '\n';
+            }
+            bytes = static_cast<size_t>(text.tellp());
+        };
+
+        std::vector<double> seconds;
+        for (int i = 0; i < options.repeat; ++i) {
+            seconds.push_back(secondsOf(serializeAll));
+        }
+        HeapUsage heap = measureHeap(serializeAll);
+
+        out << "      \"serialize\": {\"mb_per_s\": " << static_cast<double>(bytes) / 1e6 / median(seconds)
+            << ", \"output_bytes\": " << bytes << ", \"allocations\": " << heap.allocations / doms.size() << "}\n";
+    }
+};
+
+// Heap blocks the parsed DOM needs: two per non-empty array (the container and its elements), three
+// per non-empty object (the container, its members and their hashes) plus its index past
+// JsonObject::IndexThreshold, one per string too long to be stored inline and per key too long for SSO
+uint64_t nodeAllocations(const Json& root) {
+    const size_t keyCapacity = std::pmr::string().capacity();
+    uint64_t blocks = 0;
+    std::vector<const Json*> pending{&root};
+    while (!pending.empty()) {
+        const Json& value = *pending.back();
+        pending.pop_back();
+        if (value.isString()) {
+            blocks += value.asString().size() > Json::ShortStringCapacity;
+        } else if (value.isArray() && !value.asArray().empty()) {
+            blocks += 2;
+            for (const Json& item : value.asArray()) {
+                pending.push_back(&item);
+            }
+        } else if (value.isObject() && !value.asObject().empty()) {
+            blocks += value.asObject().size() > JsonObject::IndexThreshold ? 4 : 3;
+            for (const auto& [key, member] : value.asObject()) {
+                blocks += key.capacity() > keyCapacity;
+                pending.push_back(&member);
+            }
+        }
+    }
+    return blocks;
+}
+
+/**
+ * @brief Checks that a DOM parse allocates every node once, and a JsonDocument none of them
+ *
+ * Whatever the parse allocates beyond nodeAllocations() is its own bookkeeping: the structural
+ * index and the scratch stacks, which grow geometrically. Copying nodes, or growing containers
+ * element by element, would show up as allocations proportional to the document instead.
+ */
+void checkAllocations(const BenchDocument& doc, std::ostream& out) {
+    std::vector<std::string_view> lines = doc.lines ? splitLines(doc.text) : std::vector<std::string_view>{doc.text};
+    uint64_t allocations = 0;
+    uint64_t nodes = 0;
+    uint64_t bookkeeping = 0;
+    uint64_t arenaAllocations = 0;
+    for (std::string_view line : lines) {
+        Json parsed;
+        allocations += measureHeap([&]() { parsed = JsonParser::parse(line); }).allocations;
+        nodes += nodeAllocations(parsed);
+        bookkeeping += MaxBookkeepingAllocations;
+        arenaAllocations += measureHeap([&]() { JsonDocument document(line); }).allocations;
+    }
+
+    if (allocations < nodes || allocations - nodes > bookkeeping) {
+        throw std::runtime_error("DOM parse of " + doc.name + " made " + std::to_string(allocations) + " allocations for " +
+                                 std::to_string(nodes) + " heap-backed nodes");
+    }
+    // In an arena the nodes take no allocations of their own, only its blocks which grow geometrically
+    if (arenaAllocations > bookkeeping) {
+        throw std::runtime_error("Arena parse of " + doc.name + " made " + std::to_string(arenaAllocations) + " allocations");
+    }
+    out << doc.name << ": ok\n";
+}
+
+template <class T>
+std::string compact(const T& value) {
+    std::ostringstream text;
+    {
+        JsonWriter writer(text, JsonWriter::Style::Compact);
+        writer.write(value);
+    }
+    return text.str();
+}
+
+// Writes the document of path once its DOM and its tape, each parsed on one thread and split
+// between the cores, print the same. Covers the rules both must share, such as repeated keys
+void checkParsers(const std::string& path, std::ostream& out) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Cannot open " + path);
+    }
+    std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    std::string dom = compact(JsonParser::parse(text));
+    const std::pair<const char*, std::string> others[] = {
+        {"parallel DOM", compact(JsonParser::parseParallel(text))},
+        {"tape", compact(JsonParser::parseTape(text).root())},
+        {"parallel tape", compact(JsonParser::parseTapeParallel(text).root())}
+    };
+    for (const auto& [name, printed] : others) {
+        if (printed != dom) {
+            throw std::runtime_error(std::string("The ") + name + " of " + path + " is " + printed + ", the DOM is " + dom);
+        }
+    }
+    out << dom << "\n";
+}
+
+/**
+ * @brief Heap bytes per object and key lookups per second, for objects of a few sizes
+ *
+ * Lookups cycle through every key of every object, once with the hash precomputed (as compiled
+ * paths do) and once hashing the key on every call.
+ */
+void writeObjects(std::ostream& out, const Options& options) {
+    constexpr size_t Objects = 4096;
+    const size_t memberCounts[] = {4, JsonObject::IndexThreshold, 64};
+
+    out << "  \"objects\": [\n";
+    for (size_t m = 0; m < std::size(memberCounts); ++m) {
+        size_t members = memberCounts[m];
+        std::vector<std::string> keys;
+        std::vector<uint32_t> hashes;
+        for (size_t k = 0; k < members; ++k) {
+            keys.push_back("field_" + std::to_string(k));
+            hashes.push_back(JsonObject::hashKey(keys.back()));
+        }
+
+        std::vector<Json> objects;
+        objects.reserve(Objects);
+        HeapUsage heap = measureHeap([&]() {
+            for (size_t i = 0; i < Objects; ++i) {
+                JsonObject object;
+                for (size_t k = 0; k < members; ++k) {
+                    object.emplace(keys[k], Json(static_cast<int64_t>(k)));
+                }
+                objects.emplace_back(std::move(object));
+            }
+        });
+
+        size_t found = 0;
+        auto lookups = [&](bool precomputed) {
+            std::vector<double> seconds;
+            for (int r = 0; r < options.repeat; ++r) {
+                seconds.push_back(secondsOf([&]() {
+                    for (size_t k = 0; k < members; ++k) {
+                        for (const Json& object : objects) {
+                            const JsonObject& map = object.asObject();
+                            found += (precomputed ? map.find(keys[k], hashes[k]) : map.find(keys[k])) != nullptr;
+                        }
+                    }
+                }));
+            }
+            return static_cast<double>(Objects * members) / median(seconds);
+        };
+        double precomputed = lookups(true);
+        double hashed = lookups(false);
+        if (found != 2 * static_cast<size_t>(options.repeat) * Objects * members) {
+            throw std::runtime_error("Object lookup missed a key");
+        }
+
+        out << "    {\"members\": " << members
+            << ", \"bytes_per_object\": " << static_cast<double>(heap.peakBytes) / Objects
+            << ", \"lookups_per_s\": " << precomputed
+            << ", \"hashed_lookups_per_s\": " << hashed << "}"
+            << (m + 1 < std::size(memberCounts) ? ",\n" : "\n");
+    }
+    out << "  ],\n";
+}
+
+/**
+ * @brief Heap bytes per element and evaluation throughput for large DOM arrays of one element type
+ *
+ * The bytes include the array's own storage and anything its elements keep out of line; strings are
+ * short enough to be stored inline.
+ */
+void writeArrays(std::ostream& out, const Options& options) {
+    constexpr size_t Elements = size_t(1) << 20;
+    struct Case {
+        const char* type;
+        const char* expression;
+        Json (*element)(size_t i);
+    };
+    const Case cases[] = {
+        {"int", "sum(values)", [](size_t i) { return Json(static_cast<int64_t>(i)); }},
+        {"double", "sum(values)", [](size_t i) { return Json(static_cast<double>(i) * 0.5); }},
+        {"string", "count(values[*])", [](size_t i) { return Json("item_" + std::to_string(i % 1000)); }},
+    };
+
+    out << "  \"arrays\": [\n";
+    for (size_t c = 0; c < std::size(cases); ++c) {
+        Json document;
+        HeapUsage heap = measureHeap([&]() {
+            Json::Array values;
+            values.reserve(Elements);
+            for (size_t i = 0; i < Elements; ++i) {
+                values.push_back(cases[c].element(i));
+            }
+            JsonObject root;
+            root.emplace("values", Json(std::move(values)));
+            document = Json(std::move(root));
+        });
+
+        CompiledExpression expression = CompiledExpression::compile(cases[c].expression);
+        std::vector<double> seconds;
+        for (int r = 0; r < options.repeat; ++r) {
+            seconds.push_back(secondsOf([&]() { JsonEvaluator::evaluateRef(document, expression); }));
+        }
+
+        out << "    {\"type\": " << quoted(cases[c].type) << ", \"elements\": " << Elements
+            << ", \"bytes_per_element\": " << static_cast<double>(heap.peakBytes) / Elements
+            << ", \"expression\": " << quoted(cases[c].expression)
+            << ", \"elements_per_s\": " << static_cast<double>(Elements) / median(seconds) << "}"
+            << (c + 1 < std::size(cases) ? ",\n" : "\n");
+    }
+    out << "  ],\n";
+}
+
+/**
+ * @brief Lookups per second of one fixed path in the DOM and on the tape: compiled on every call
+ *        (JsonEvaluator's string overloads), compiled once, and parsed at compile time (JSON_PATH)
+ */
+void writePaths(std::ostream& out, const Options& options) {
+    constexpr size_t Lookups = size_t(1) << 16;
+    constexpr const char* Path = "a.b[2].c";
+    static constexpr auto path = JSON_PATH("a.b[2].c");
+
+    const std::string text = R"({"a": {"x": 0, "b": [1, 2, {"c": "test"}, [11, 12]], "y": 1}})";
+    Json dom = JsonParser::parse(text);
+    JsonTape tape = JsonParser::parseTape(text);
+    CompiledExpression compiled = CompiledExpression::compile(Path);
+
+    size_t found = 0;
+    auto rate = [&](auto&& lookup) {
+        std::vector<double> seconds;
+        for (int r = 0; r < options.repeat; ++r) {
+            seconds.push_back(secondsOf([&]() {
+                for (size_t i = 0; i < Lookups; ++i) {
+                    found += lookup();
+                }
+            }));
+        }
+        return static_cast<double>(Lookups) / median(seconds);
+    };
+
+    auto write = [&](const char* target, double perCall, double once, double constant) {
+        out << "    {\"path\": " << quoted(Path) << ", \"target\": " << quoted(target)
+            << ", \"compiled_per_call_per_s\": " << perCall << ", \"compiled_once_per_s\": " << once
+            << ", \"compile_time_per_s\": " << constant << "}";
+    };
+
+    out << "  \"paths\": [\n";
+    write("dom",
+          rate([&]() { return JsonEvaluator::evaluateRef(dom, CompiledExpression::compile(Path)).isView(); }),
+          rate([&]() { return JsonEvaluator::evaluateRef(dom, compiled).isView(); }),
+          rate([&]() { return path.evaluate(dom).isString(); }));
+    out << ",\n";
+    write("tape",
+          rate([&]() { return JsonEvaluator::evaluateRef(tape, CompiledExpression::compile(Path)).isView(); }),
+          rate([&]() { return JsonEvaluator::evaluateRef(tape, compiled).isView(); }),
+          rate([&]() { return path.evaluate(tape).isString(); }));
+    out << "\n  ],\n";
+
+    if (found != 6 * static_cast<size_t>(options.repeat) * Lookups) {
+        throw std::runtime_error("Path lookup returned another value");
+    }
+}
+
+/**
+ * @brief Evaluations per second of a path that resolves and of one whose key is missing, the miss
+ *        returned by tryEvaluateRef and thrown by evaluateRef, and the allocations of a returned miss
+ */
+void writeMisses(std::ostream& out, const Options& options) {
+    constexpr size_t Evaluations = size_t(1) << 16;
+    const std::string text = R"({"a": {"x": 0, "b": [1, 2, {"c": "test"}, [11, 12]], "y": 1}})";
+    Json dom = JsonParser::parse(text);
+    JsonTape tape = JsonParser::parseTape(text);
+    CompiledExpression hit = CompiledExpression::compile("a.b[2].c");
+    CompiledExpression miss = CompiledExpression::compile("a.b[2].d");
+
+    size_t found = 0;
+    auto rate = [&](auto&& evaluate) {
+        std::vector<double> seconds;
+        for (int r = 0; r < options.repeat; ++r) {
+            seconds.push_back(secondsOf([&]() {
+                for (size_t i = 0; i < Evaluations; ++i) {
+                    found += evaluate();
+                }
+            }));
+        }
+        return static_cast<double>(Evaluations) / median(seconds);
+    };
+
+    auto write = [&](const char* target, const auto& document) {
+        double hits = rate([&]() { return JsonEvaluator::tryEvaluateRef(document, hit).ok(); });
+        double misses = rate([&]() { return !JsonEvaluator::tryEvaluateRef(document, miss).ok(); });
+        double thrown = rate([&]() {
+            try {
+                JsonEvaluator::evaluateRef(document, miss);
+                return false;
+            } catch (const std::runtime_error&) {
+                return true;
+            }
+        });
+        HeapUsage heap = measureHeap([&]() { found += !JsonEvaluator::tryEvaluateRef(document, miss).ok(); });
+
+        out << "    {\"target\": " << quoted(target) << ", \"hits_per_s\": " << hits
+            << ", \"returned_misses_per_s\": " << misses << ", \"thrown_misses_per_s\": " << thrown
+            << ", \"miss_allocations\": " << heap.allocations << "}";
+    };
+
+    out << "  \"misses\": [\n";
+    write("dom", dom);
+    out << ",\n";
+    write("tape", tape);
+    out << "\n  ],\n";
+
+    if (found != 2 * (3 * static_cast<size_t>(options.repeat) * Evaluations + 1)) {
+        throw std::runtime_error("Miss benchmark returned another result");
+    }
+}
+
+bool parseOptions(int argc, char* argv[], Options& options) try {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--size" && hasValue) {
+            options.megabytes = std::stoul(argv[++i]);
+        } else if (arg == "--repeat" && hasValue) {
+            options.repeat = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--iterations" && hasValue) {
+            options.iterations = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--shape" && hasValue) {
+            options.shapes = {argv[++i]};
+        } else if (arg == "--check-allocations") {
+            options.checkAllocations = true;
+        } else if (arg == "--check-parsers" && hasValue) {
+            options.checkParsers = argv[++i];
+        } else if (arg == "--output" && hasValue) {
+            options.output = argv[++i];
+        } else {
+            return false;
+        }
+    }
+    return true;
+} catch (const std::exception&) {
+    return false;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::cerr << "\033[38;5;208m" << "Usage: " << argv[0]
+                  << " [--size MB] [--repeat N] [--iterations N] [--shape deep|wide|numeric|scientific|logs|ndjson] [--output file | --check-allocations | --check-parsers file]"
+                  << "\033[0m" << std::endl;
+        return 1;
+    }
+
+    try {
+        if (!options.checkParsers.empty()) {
+            checkParsers(options.checkParsers, std::cout);
+            return 0;
+        }
+        if (options.checkAllocations) {
+            for (const std::string& shape : options.shapes) {
+                checkAllocations(DocumentGenerator::generate(shape, options.megabytes << 20), std::cout);
+            }
+            return 0;
+        }
+
+        std::ostringstream report;
+        report << "{\n";
+        report << "  \"version\": 1,\n";
+        report << "  \"kernel\": " << quoted(StructuralIndex::kernelName(StructuralIndex::activeKernel())) << ",\n";
+        report << "  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n";
+        report << "  \"size_mb\": " << options.megabytes << ",\n";
+        report << "  \"results\": [\n";
+        for (size_t i = 0; i < options.shapes.size(); ++i) {
+            BenchDocument doc = DocumentGenerator::generate(options.shapes[i], options.megabytes << 20);
+            ShapeBench(doc, options).run(report);
+            report << (i + 1 < options.shapes.size() ? ",\n" : "\n");
+        }
+        report << "  ],\n";
+        writeObjects(report, options);
+        writeArrays(report, options);
+        writePaths(report, options);
+        writeMisses(report, options);
+        // ru_maxrss only grows, run a single --shape to attribute it to one document
+        report << "  \"peak_rss_kb\": " << peakRssKb() << "\n";
+        report << "}\n";
+
+        if (options.output.empty()) {
+            std::cout << report.str();
+        } else {
+            std::ofstream file(options.output);
+            file << report.str();
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "\033[1;31m" "Error: " << e.what() << "\033[0m" << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,59 @@
+// include/json_parser/aggregate.hpp
+#ifndef AGGREGATE_HPP
+#define AGGREGATE_HPP
+
+#include "json.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/**
+ * @class Aggregate
+ * @brief Running min, max, sum, average or count over a stream of ints and doubles
+ *
+ * Ints and doubles are tracked apart, so int64 values are never rounded through double:
+ * min/max compare an int against a double exactly and return the winner in its own type,
+ * sum stays an int64 until it overflows or a double is added; avg is the sum divided by the
+ * count, always a double. Partial aggregates computed on different threads are combined with
+ * merge(), values reduced elsewhere (by NumericKernels) are added with addPartial().
+ */
+class Aggregate {
+public:
+    enum class Kind {
+        Min,
+        Max,
+        Sum,
+        Avg,
+        Count
+    };
+
+    explicit Aggregate(Kind kind) : aggregateKind(kind) {}
+
+    // Accepts "min", "max", "sum", "avg" and "count"
+    static bool parseKind(std::string_view name, Kind& kind);
+
+    Kind kind() const { return aggregateKind; }
+    bool empty() const { return count == 0; }
+
+    void add(int64_t number);
+    void add(double number);
+    // The min, max or sum (matching kind()) of `values` numbers, values > 0
+    void addPartial(int64_t number, size_t values);
+    void addPartial(double number, size_t values);
+    // Counts values whatever their type, for Count
+    void addCount(size_t values) { count += values; }
+    void merge(const Aggregate& other);
+
+    // The aggregate as a Json number; empty aggregates only have a count
+    Json result() const;
+
+private:
+    Kind aggregateKind;
+    size_t count = 0;
+    bool hasInt = false;
+    bool hasDouble = false;
+    int64_t intValue = 0;       // Extreme int or exact int sum
+    double doubleValue = 0;     // Extreme double or sum of the doubles (and of an overflowed int sum)
+};
+
+#endif // AGGREGATE_HPP
@@ -0,0 +1,143 @@
+// include/json_parser/compiledExpression.hpp
+#ifndef COMPILED_EXPRESSION_HPP
+#define COMPILED_EXPRESSION_HPP
+
+#include "json.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @class CompiledExpression
+ * @brief An expression tokenized and parsed once into a flat node array
+ *
+ * Nodes, path steps and function arguments live in three contiguous vectors and reference each
+ * other by index, so evaluating a compiled expression does no string work at all. The same
+ * instance can be evaluated against any number of documents (see JsonEvaluator::evaluate).
+ *
+ * Grammar:
+ *  expression := function '(' expression (',' expression)* ')' | number | path
+ *  path       := (key | '[' subscript ']') ('.' key | '[' subscript ']')*
+ *  subscript  := digits | '*' | slice | '?' predicate | expression
+ *  slice      := integer? ':' integer? (':' integer?)?
+ *  predicate  := term ('||' term)*
+ *  term       := factor ('&&' factor)*
+ *  factor     := '!' factor | '(' predicate ')' | operand (comparison operand)?
+ *  comparison := '==' | '!=' | '<' | '<=' | '>' | '>='
+ *  operand    := number | 'string' | "string" | true | false | null | field
+ *  field      := ('@' | key) ('.' key | '[' digits ']')*
+ *
+ * A path with a '*', slice or filter subscript is a projection: the rest of the path is applied to
+ * every selected element and the results form a list. Slices follow Python: negative bounds count
+ * from the end, the step must be positive. A filter keeps the elements its predicate holds for;
+ * fields are read from the element ('@' is the element itself), a missing field is null, and an
+ * operand without a comparison holds unless it is null, false or an empty string, array or object.
+ * Numbers compare by value, strings by their bytes; < <= > >= are false between other types.
+ */
+class CompiledExpression {
+public:
+    enum class NodeType : uint8_t {
+        Path,
+        Number,
+        Min,
+        Max,
+        Size,
+        Sum,
+        Avg,
+        Count
+    };
+
+    enum class StepType : uint8_t {
+        Key,        // Object member lookup
+        Index,      // Constant array index
+        Expression, // Array index computed by another node
+        Slice,      // Every element from start to end by stride, '*' selects them all
+        Filter      // Every element the predicate `value` holds for
+    };
+
+    enum class PredicateType : uint8_t {
+        Or,
+        And,
+        Not,
+        Compare,
+        Truthy
+    };
+
+    enum class Comparison : uint8_t {
+        Equal,
+        NotEqual,
+        Less,
+        LessEqual,
+        Greater,
+        GreaterEqual
+    };
+
+    static constexpr int64_t OpenEnd = INT64_MAX;
+
+    struct Step {
+        StepType type;
+        size_t value = 0;   // Array index (Index), node id (Expression) or predicate id (Filter)
+        std::string key;    // Member name (Key)
+        uint32_t hash = 0;  // JsonObject::hashKey(key), computed once at compile time (Key)
+        int64_t start = 0;  // Slice bounds, negative ones count from the end of the array
+        int64_t end = OpenEnd;
+        int64_t stride = 1;
+        size_t position = 0;    // Byte offset of the step in the expression text (path steps)
+    };
+
+    struct Node {
+        NodeType type = NodeType::Path;
+        size_t first = 0;   // First step (Path) or first argument slot (functions)
+        size_t count = 0;   // Number of steps or arguments
+        size_t cost = 0;    // Static estimate of the evaluation work, nested subscripts weigh most
+        bool projection = false;    // A Path node with at least one Slice or Filter step
+        Json literal;       // Value of a Number node
+    };
+
+    // A predicate of a filter, children and operands are referenced by id
+    struct Predicate {
+        PredicateType type = PredicateType::Truthy;
+        Comparison comparison = Comparison::Equal;
+        size_t left = 0;    // Predicates (Or, And, Not) or operands (Compare, Truthy)
+        size_t right = 0;
+    };
+
+    // A literal, or a field read from the filtered element by Key and Index steps
+    struct Operand {
+        bool isField = false;
+        size_t first = 0;   // Steps of the field, none for '@'
+        size_t count = 0;
+        std::string field;  // The steps spelled out (".a[0]"), equal for equal fields
+        Json literal;
+    };
+
+    static constexpr size_t StepCost = 1;
+    static constexpr size_t NestedSubscriptCost = 8;
+    static constexpr size_t ProjectionCost = 32;
+
+    static CompiledExpression compile(const std::string& expression);
+
+    size_t root() const { return rootNode; }
+    const Node& node(size_t id) const { return nodes[id]; }
+    size_t nodeCount() const { return nodes.size(); }
+    const Step& step(size_t id) const { return steps[id]; }
+    size_t argument(const Node& function, size_t i) const { return arguments[function.first + i]; }
+    const Predicate& predicate(size_t id) const { return predicates[id]; }
+    const Operand& operand(size_t id) const { return operands[id]; }
+
+    const std::string& source() const { return text; }
+
+private:
+    struct Token;
+    class Compiler;
+
+    std::string text;
+    std::vector<Node> nodes;
+    std::vector<Step> steps;
+    std::vector<size_t> arguments;
+    std::vector<Predicate> predicates;
+    std::vector<Operand> operands;
+    size_t rootNode = 0;
+};
+
+#endif // COMPILED_EXPRESSION_HPP
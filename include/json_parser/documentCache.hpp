@@ -0,0 +1,82 @@
+// include/json_parser/documentCache.hpp
+#ifndef DOCUMENT_CACHE_HPP
+#define DOCUMENT_CACHE_HPP
+
+#include "filterIndex.hpp"
+#include "jsonTape.hpp"
+#include "mappedFile.hpp"
+#include "snapshot.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+/**
+ * @class DocumentCache
+ * @brief Thread-safe LRU cache of parsed documents keyed by file path
+ *
+ * Snapshot files (see Snapshot) are evaluated in place as on the command line after their payload
+ * checksum is verified, once per load; other files are parsed into a tape. Every lookup stats the file; an entry is reused only while the file's modification time, inode
+ * and size are unchanged, so edited or replaced files are parsed again on their next use. Documents
+ * are handed out as shared read-only tapes: evaluating them needs no locking, and an evicted
+ * document stays alive until its last reader is done. Misses parse outside the lock.
+ *
+ * The tape views the mapped file, so files should be replaced (written elsewhere and renamed)
+ * rather than rewritten in place while they are cached.
+ */
+class DocumentCache {
+public:
+    struct Document {
+        explicit Document(const std::string& path);
+
+        const JsonTape& tape() const { return snapshot ? snapshot->tape() : parsed; }
+
+        MappedFile file;                    // Moved into snapshot when the file is one
+        std::optional<Snapshot> snapshot;
+        JsonTape parsed;                    // Views into file
+        mutable FilterIndex indexes;    // Built on demand by queries, internally synchronized
+    };
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        size_t documents = 0;
+    };
+
+    explicit DocumentCache(size_t capacity);
+
+    std::shared_ptr<const Document> get(const std::string& path);
+    Stats stats() const;
+
+private:
+    struct Stamp {
+        int64_t modified = 0;
+        uint64_t inode = 0;
+        uint64_t size = 0;
+
+        bool operator==(const Stamp& other) const {
+            return modified == other.modified && inode == other.inode && size == other.size;
+        }
+    };
+
+    struct Entry {
+        Stamp stamp;
+        std::shared_ptr<const Document> document;
+        std::list<std::string>::iterator position;
+    };
+
+    mutable std::mutex mutex;
+    size_t capacity;
+    std::list<std::string> order;       // Most recently used first
+    std::unordered_map<std::string, Entry> entries;
+    Stats counters;
+
+    static Stamp stampOf(const std::string& path);
+};
+
+#endif // DOCUMENT_CACHE_HPP
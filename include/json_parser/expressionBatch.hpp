@@ -0,0 +1,87 @@
+// include/json_parser/expressionBatch.hpp
+#ifndef EXPRESSION_BATCH_HPP
+#define EXPRESSION_BATCH_HPP
+
+#include "json.hpp"
+#include "compiledExpression.hpp"
+#include "jsonEvaluator.hpp"
+#include "jsonRef.hpp"
+#include "jsonTape.hpp"
+#include "jsonWriter.hpp"
+#include "pathFilter.hpp"
+#include <cstddef>
+#include <istream>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * @class ExpressionBatch
+ * @brief Many expressions answered against one parsed document
+ *
+ * The leading constant steps (keys and constant indices) of every path in every expression are
+ * merged into one trie. Evaluating the batch resolves each trie node once, then runs every
+ * expression with its paths starting at their resolved prefix, so a.b.c[0] and a.b.c[1] walk
+ * a.b.c a single time. Prefixes that do not resolve are left to the evaluator, which then reports
+ * the same error a single expression would. Filter indexes built by one expression are reused by
+ * the others, so users[?id==1] and users[?id==2] hash users once.
+ *
+ * An expression that fails to compile or evaluate only fails its own result.
+ */
+class ExpressionBatch {
+public:
+    struct Result {
+        bool ok = false;
+        JsonRef value;      // Views into the tape given to evaluate()
+        std::string error;
+    };
+
+    static ExpressionBatch compile(const std::vector<std::string>& expressions);
+
+    // One expression per line, blank lines are skipped
+    static ExpressionBatch compile(std::istream& input);
+
+    size_t size() const { return entries.size(); }
+    const std::string& source(size_t i) const { return entries[i].source; }
+
+    // Union of every expression's paths for selective parsing
+    const PathFilter& filter() const { return paths; }
+
+    std::vector<Result> evaluate(const JsonTape& tape) const;
+
+    // One result per line ("Error: ..." for failures), or a JSON object keyed by expression
+    void write(std::ostream& out, const std::vector<Result>& results, bool asObject,
+               JsonWriter::Style style = JsonWriter::Style::Spaced) const;
+
+private:
+    using Ref = JsonTape::Ref;
+
+    // One constant step below its parent, node 0 is the document root
+    struct TrieNode {
+        size_t parent = 0;
+        size_t depth = 0;
+        bool isKey = false;
+        std::string key;
+        size_t index = 0;
+        std::vector<size_t> children;
+    };
+
+    struct Entry {
+        std::string source;
+        std::optional<CompiledExpression> expression;
+        std::string error;
+        std::vector<size_t> prefixNodes;    // Trie node of each Path node's constant prefix, by node id
+    };
+
+    std::vector<TrieNode> trie;
+    std::vector<Entry> entries;
+    PathFilter paths;
+
+    ExpressionBatch() : trie(1) {}
+
+    void add(const std::string& source);
+    size_t child(size_t parent, const CompiledExpression::Step& step);
+};
+
+#endif // EXPRESSION_BATCH_HPP
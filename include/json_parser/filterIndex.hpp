@@ -0,0 +1,86 @@
+// include/json_parser/filterIndex.hpp
+#ifndef FILTER_INDEX_HPP
+#define FILTER_INDEX_HPP
+
+#include "jsonTape.hpp"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * @class FilterIndex
+ * @brief Hash indexes over the arrays of one JsonTape, built on demand by equality filters
+ *
+ * A filter such as users[?id==42] over a large array looks its literal up in a table from field
+ * value to the elements holding it instead of testing every element. The first such query builds
+ * the table of its (array, field) pair in one pass; later queries of the same batch or daemon
+ * session reuse it, so a point lookup costs O(1) plus its matches. Tables are keyed by the array's
+ * position on the tape: an index belongs to one tape and must not outlive it.
+ *
+ * Only scalars are indexed, a missing field counts as null as it does in the filter. Numbers that
+ * compare equal have the same key whether they are ints or doubles. Lookups are thread-safe, a table
+ * is built outside the lock and the first one finished is kept.
+ */
+class FilterIndex {
+public:
+    using Ref = JsonTape::Ref;
+    using Table = std::unordered_map<std::string, std::vector<Ref>>;
+
+    // Smaller arrays are scanned, building a table would cost as much as the scan
+    static constexpr size_t MinElements = 64;
+
+    // Table key of a scalar, false for arrays and objects
+    template <class Cursor>
+    static bool keyOf(const Cursor& value, std::string& key);
+
+    // Table of field over the elements of array; key() fills in the key of one element, false to skip it
+    std::shared_ptr<const Table> table(const Ref& array, const std::string& field,
+                                       const std::function<bool(const Ref&, std::string&)>& key);
+
+private:
+    std::mutex mutex;
+    std::map<std::pair<size_t, std::string>, std::shared_ptr<const Table>> tables;
+};
+
+template <class Cursor>
+bool FilterIndex::keyOf(const Cursor& value, std::string& key) {
+    auto number = [&key](char type, const void* bits) {
+        key.assign(1, type);
+        key.append(static_cast<const char*>(bits), 8);
+    };
+
+    if (value.isInt()) {
+        int64_t integer = value.asInt();
+        number('i', &integer);
+    } else if (value.isDouble()) {
+        // Integral doubles in range take the key of the int they equal
+        double real = value.asDouble();
+        if (std::trunc(real) == real && real >= -9223372036854775808.0 && real < 9223372036854775808.0) {
+            int64_t integer = static_cast<int64_t>(real);
+            number('i', &integer);
+        } else {
+            number('d', &real);
+        }
+    } else if (value.isString()) {
+        key.assign(1, 's');
+        key.append(value.asString());
+    } else if (value.isBool()) {
+        key.assign(value.asBool() ? "t" : "f");
+    } else if (value.isNull()) {
+        key.assign("n");
+    } else {
+        return false;
+    }
+    return true;
+}
+
+#endif // FILTER_INDEX_HPP
@@ -2,111 +2,249 @@
 #ifndef JSON_HPP
 #define JSON_HPP
 
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory_resource>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <utility>
 #include <variant>
 #include <vector>
 #include <algorithm>
 #include <iostream>
+#include <stdexcept>
+
+class Json;
+
+/**
+ * @class JsonObject
+ * @brief Object members in insertion order, stored flat
+ *
+ * Members sit in one vector, next to a parallel vector of 32-bit key hashes. Objects of up to
+ * IndexThreshold members (most objects in real documents) are searched linearly over the hashes,
+ * which stay within one or two cache lines. Larger objects also keep an open-addressing index of
+ * member positions, built when they grow past the threshold. Keys are unique: emplace keeps the
+ * value already stored and operator[] inserts null for a missing key, as std::unordered_map did.
+ * Members, keys and the index are allocated from the memory resource the object was created with.
+ */
+class JsonObject {
+public:
+    using Member = std::pair<std::pmr::string, Json>;
+    using iterator = std::pmr::vector<Member>::iterator;
+    using const_iterator = std::pmr::vector<Member>::const_iterator;
+
+    static constexpr size_t IndexThreshold = 16;
+
+    // FNV-1a, compiled expressions store it with their keys so lookups skip the hashing
+    static constexpr uint32_t hashKey(std::string_view key) {
+        uint32_t hash = 2166136261u;
+        for (char c : key) {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+        }
+        return hash;
+    }
+
+    JsonObject() = default;
+    explicit JsonObject(std::pmr::memory_resource* resource) : members(resource), hashes(resource), slots(resource) {}
+    JsonObject(const std::unordered_map<std::string, Json>& map);
+
+    size_t size() const { return members.size(); }
+    bool empty() const { return members.empty(); }
+    std::pmr::memory_resource* resource() const { return members.get_allocator().resource(); }
+    // Sizes the members and, past IndexThreshold, the index for count members at once
+    void reserve(size_t count);
+
+    iterator begin() { return members.begin(); }
+    iterator end() { return members.end(); }
+    const_iterator begin() const { return members.begin(); }
+    const_iterator end() const { return members.end(); }
+
+    // nullptr when the key is missing
+    const Json* find(std::string_view key) const { return find(key, hashKey(key)); }
+    const Json* find(std::string_view key, uint32_t hash) const;
+    Json* find(std::string_view key, uint32_t hash);
+
+    // Adds the member unless the key is present, returns the stored value either way.
+    // A moved key is kept when it uses the object's resource, other keys are copied into it
+    Json& emplace(std::string_view key, Json value);
+    Json& emplace(std::pmr::string&& key, Json value);
+    Json& emplace(const char* key, Json value);
+    Json& operator[](std::string_view key);
+
+    // Member order does not matter, as for JSON objects
+    bool operator==(const JsonObject& other) const;
+    bool operator!=(const JsonObject& other) const { return !(*this == other); }
+
+private:
+    static constexpr uint32_t EmptySlot = 0;
+
+    std::pmr::vector<Member> members;
+    std::pmr::vector<uint32_t> hashes;
+    std::pmr::vector<uint32_t> slots;   // Member position + 1, EmptySlot where unused
+
+    // Index size for count members: a power of two, at least 64 and at most half full
+    static size_t indexCapacity(size_t count);
+
+    size_t locate(std::string_view key, uint32_t hash) const;
+    template <class Key>
+    Json& insert(Key&& key, Json&& value);
+    void insertSlot(size_t position);
+    void rebuildIndex(size_t capacity);
+};
 
 /**
  * @class Json
  * @brief Represents a JSON value that can be any valid JSON data type
  * 
- * This class uses std::variant to store different JSON value types including:
- *  null, bool, int(int64_t), double, string, Object(unordered_map<std::string, Json>), Array(vector<Json>)
+ * A value is 16 bytes: a one-byte type tag and an 8-byte payload, or a string of up to
+ * ShortStringCapacity bytes stored in the value itself. Numbers, booleans, null and short strings
+ * never allocate, so an array of them is a flat run of 16-byte elements. Longer strings take one
+ * block (a small header followed by the characters); arrays and objects keep a pointer to their
+ * std::pmr container. An empty array or object has no container at all.
+ *
+ * Out-of-line storage comes from a std::pmr::memory_resource. The std::string, std::vector and
+ * std::unordered_map constructors use the default resource; a parser building into an arena passes
+ * its own (see JsonParser::parse and JsonDocument). Moves keep the storage of the moved value,
+ * copies use the default resource.
  */
 class Json {
-    std::variant<
-        std::nullptr_t,
-        bool,
-        int64_t,
-        double,
-        std::string,
-        std::unordered_map<std::string, Json>,
-        std::vector<Json>> value;
-
 public:
-    Json() = default;
-    Json(Json const&) = default;
-    Json(Json&&) = default;
-
-    Json(std::nullptr_t) : value(nullptr) {}
-    Json(bool b) : value(b) {}
-    Json(int64_t i) : value(i) {}
-    Json(double d) : value(d) {}
-    Json(const std::string& s) : value(s) {}
-    Json(std::string&& s) : value(std::move(s)) {}
-    Json(const std::unordered_map<std::string, Json>& obj) : value(obj) {}
-    Json(std::unordered_map<std::string, Json>&& obj) : value(std::move(obj)) {}
-    Json(const std::vector<Json>& arr) : value(arr) {}
-    Json(std::vector<Json>&& arr) : value(std::move(arr)) {}
-
-    // Assignment operators
-    Json& operator=(Json const&) = default;
-    Json& operator=(Json&&) = default;
+    using Array = std::pmr::vector<Json>;
+
+    static constexpr size_t ShortStringCapacity = 14;
+
+    Json() noexcept : Json(nullptr) {}
+    Json(const Json& other);
+    Json(Json&& other) noexcept : storage(other.storage) { other.storage.tagged.kind = Kind::Null; }
+    ~Json() { release(); }
+
+    Json(std::nullptr_t) noexcept { storage.tagged.kind = Kind::Null; }
+    Json(bool b) noexcept { storage.tagged.kind = Kind::Bool; storage.tagged.boolean = b; }
+    Json(int64_t i) noexcept { storage.tagged.kind = Kind::Int; storage.tagged.integer = i; }
+    Json(double d) noexcept { storage.tagged.kind = Kind::Double; storage.tagged.real = d; }
+    Json(const std::string& s) : Json(std::string_view(s)) {}
+    explicit Json(std::string_view s, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+    Json(const JsonObject& obj);
+    Json(JsonObject&& obj);
+    Json(const std::unordered_map<std::string, Json>& obj) : Json(JsonObject(obj)) {}
+    Json(const std::vector<Json>& arr);
+    Json(std::vector<Json>&& arr);
+    Json(Array&& arr);
+
+    // Assignment operators, the source may be a part of this value
+    Json& operator=(const Json& other);
+    Json& operator=(Json&& other) noexcept;
 
     // Comparison operators
-    bool operator==(Json const& other) const {
-        return value == other.value;
-    }
+    bool operator==(Json const& other) const;
     bool operator!=(Json const& other) const {
-        return value != other.value;
+        return !(*this == other);
     }
 
-    // Emplace method
+    // Replaces the value with a T built from args
     template <class T, class... Args>
     void emplace(Args&&... args) {
-        value.emplace<T>(std::forward<Args>(args)...);
+        *this = Json(T(std::forward<Args>(args)...));
     }
 
-    // Method to check the index of the currently active element
-    std::size_t index() const {
-        return value.index();
-    }
+    // Type of the value, numbered as the alternatives null, bool, int, double, string, object, array
+    std::size_t index() const;
 
     // Accessors
-    bool isNull() const { return std::holds_alternative<std::nullptr_t>(value); }
-    bool isBool() const { return std::holds_alternative<bool>(value); }
-    bool isInt() const { return std::holds_alternative<int64_t>(value); }
-    bool isDouble() const { return std::holds_alternative<double>(value); }
-    bool isString() const { return std::holds_alternative<std::string>(value); }
-    bool isObject() const { return std::holds_alternative<std::unordered_map<std::string, Json>>(value); }
-    bool isArray() const { return std::holds_alternative<std::vector<Json>>(value); }
-
-    bool asBool() const { return std::get<bool>(value); }
-    int64_t asInt() const { return std::get<int64_t>(value); }
-    double asDouble() const { return std::get<double>(value); }
-    const std::string& asString() const { return std::get<std::string>(value); }
-    const std::unordered_map<std::string, Json>& asObject() const { return std::get<std::unordered_map<std::string, Json>>(value); }
-    const std::vector<Json>& asArray() const { return std::get<std::vector<Json>>(value); }
+    bool isNull() const { return kind() == Kind::Null; }
+    bool isBool() const { return kind() == Kind::Bool; }
+    bool isInt() const { return kind() == Kind::Int; }
+    bool isDouble() const { return kind() == Kind::Double; }
+    bool isString() const { return kind() == Kind::ShortString || kind() == Kind::String; }
+    bool isObject() const { return kind() == Kind::Object; }
+    bool isArray() const { return kind() == Kind::Array; }
+
+    // Throw std::bad_variant_access when the value has another type
+    bool asBool() const { return expect(Kind::Bool).boolean; }
+    int64_t asInt() const { return expect(Kind::Int).integer; }
+    double asDouble() const { return expect(Kind::Double).real; }
+    std::string_view asString() const;
+    const JsonObject& asObject() const;
+    const Array& asArray() const;
 
     // Mutators
-    void setNull() { value = nullptr; }
-    void setBool(bool b) { value = b; }
-    void setInt(int64_t i) { value = i; }
-    void setDouble(double d) { value = d; }
-    void setString(const std::string& s) { value = s; }
-    void setObject(const std::unordered_map<std::string, Json>& obj) { value = obj; }
-    void setArray(const std::vector<Json>& arr) { value = arr; }
+    void setNull() { *this = Json(); }
+    void setBool(bool b) { *this = Json(b); }
+    void setInt(int64_t i) { *this = Json(i); }
+    void setDouble(double d) { *this = Json(d); }
+    void setString(const std::string& s) { *this = Json(s); }
+    void setObject(const JsonObject& obj) { *this = Json(obj); }
+    void setObject(const std::unordered_map<std::string, Json>& obj) { *this = Json(obj); }
+    void setArray(const std::vector<Json>& arr) { *this = Json(arr); }
 
     // Overload operator[] for object access
-    Json& operator[](const std::string& key) {
-        if (!isObject()) {
-            throw std::runtime_error("Error: Json value is not an object");
-        }
-        return std::get<std::unordered_map<std::string, Json>>(value)[key];
-    }
+    Json& operator[](const std::string& key);
 
     // Overload operator[] for array access
-    Json& operator[](size_t index) {
-        if (!isArray()) {
-            throw std::runtime_error("Error: Json value is not an array");
+    Json& operator[](size_t index);
+
+    friend std::ostream& operator<<(std::ostream& os, const Json& json);
+
+private:
+    enum class Kind : uint8_t {
+        Null,
+        Bool,
+        Int,
+        Double,
+        ShortString,
+        String,
+        Object,
+        Array
+    };
+
+    // A long string: the characters follow the header in the same block
+    struct StringBlock {
+        std::pmr::memory_resource* resource;
+        size_t size;
+
+        const char* data() const { return reinterpret_cast<const char*>(this + 1); }
+    };
+
+    // Both layouts start with the tag, which is read through tagged whichever one is active
+    struct Inline {
+        Kind kind;
+        uint8_t size;
+        char text[ShortStringCapacity];
+    };
+
+    struct Tagged {
+        Kind kind;
+        union {
+            bool boolean;
+            int64_t integer;
+            double real;
+            StringBlock* string;
+            JsonObject* object;     // nullptr when empty
+            Array* array;           // nullptr when empty
+        };
+    };
+
+    union Storage {
+        Inline inlined;
+        Tagged tagged;
+    } storage;
+
+    Kind kind() const { return storage.tagged.kind; }
+    const Tagged& expect(Kind expected) const {
+        if (kind() != expected) {
+            throw std::bad_variant_access();
         }
-        return std::get<std::vector<Json>>(value)[index];
+        return storage.tagged;
     }
 
-    friend std::ostream& operator<<(std::ostream& os, const Json& json);
+    static Json copyOf(const Json& other);
+    void release() noexcept;
+    JsonObject& mutableObject();
+    Array& mutableArray();
 };
 
-#endif // JSON_HPP
\ No newline at end of file
+static_assert(sizeof(Json) <= 16, "Json values are meant to be 16 bytes");
+
+#endif // JSON_HPP
@@ -0,0 +1,37 @@
+// include/json_parser/jsonDocument.hpp
+#ifndef JSON_DOCUMENT_HPP
+#define JSON_DOCUMENT_HPP
+
+#include "json.hpp"
+#include "pathFilter.hpp"
+#include <memory>
+#include <memory_resource>
+#include <string_view>
+
+/**
+ * @class JsonDocument
+ * @brief A parsed DOM that lives in an arena of its own
+ *
+ * Every node is allocated from a monotonic buffer resource that grows in large blocks taken from
+ * upstream, so parsing makes a handful of allocations instead of one per container. Releasing the
+ * document hands those blocks back without visiting the tree: the nodes are never destroyed one by
+ * one, which makes it O(1) in the number of nodes.
+ *
+ * The tree is read-only; a copy of root() uses the default resource and may outlive the document.
+ * upstream can be a per-thread pool reused across documents, it must outlive the JsonDocument.
+ */
+class JsonDocument {
+public:
+    explicit JsonDocument(std::string_view jsonString,
+                          std::pmr::memory_resource* upstream = std::pmr::get_default_resource());
+    JsonDocument(std::string_view jsonString, const PathFilter& filter,
+                 std::pmr::memory_resource* upstream = std::pmr::get_default_resource());
+
+    const Json& root() const { return *value; }
+
+private:
+    std::unique_ptr<std::pmr::monotonic_buffer_resource> arena;
+    const Json* value = nullptr;    // Placed in the arena, released with it
+};
+
+#endif // JSON_DOCUMENT_HPP
@@ -3,49 +3,209 @@
 #define JSON_EVALUATOR_HPP
 
 #include "json.hpp"
+#include "aggregate.hpp"
+#include "compiledExpression.hpp"
+#include "filterIndex.hpp"
+#include "jsonTape.hpp"
+#include "jsonRef.hpp"
+#include "jsonResult.hpp"
+#include "threadPool.hpp"
 #include <string>
 #include <stdexcept>
-#include <regex>
 #include <algorithm>
 #include <iostream>
+#include <exception>
 #include <future>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
 #include <vector>
 
 
 /**
  * @class JsonEvaluator
- * @brief Static function for evaluating a passed Json object with a passed string expression
+ * @brief Static functions for evaluating a compiled expression against a passed Json object or JsonTape
+ *
+ * The string overloads compile the expression and run it once. Callers evaluating the same
+ * expression against many documents should compile it once and use the CompiledExpression overloads.
+ * Evaluation is written once against a read-only cursor (JsonTape::Ref or a Json adapter), so path
+ * lookups and size() run directly on whichever representation was parsed. evaluateRef returns a path
+ * result as a JsonRef view into the document instead of copying it, so selecting or measuring a large
+ * subtree allocates nothing; evaluate copies the result into a Json.
+ *
+ * min/max/sum/avg only go parallel when it pays off: arguments are handed to the shared ThreadPool
+ * when at least two of them have a static cost (CompiledExpression::Node::cost) above
+ * ParallelArgumentCost, and long arrays with random access are reduced in chunks. Everything else
+ * runs on the caller.
+ *
+ * Projections (a.b[*].price) evaluate to an array of the selected values. Inside the aggregate
+ * functions they are never built as Json: one pass over the array gathers the numbers into a Column,
+ * which NumericKernels reduces like a packed array. Like whole array arguments, an array reached by
+ * a projection contributes its elements. count counts values of any type, the others need numbers.
+ *
+ * The evaluateRef overloads take the memory resource for the temporaries of the calling thread (the
+ * gathered Columns and a projection's result array), e.g. an arena reset after every document.
+ * Work handed to the ThreadPool allocates from the default resource, so the resource need not be
+ * thread-safe.
+ *
+ * Filters ([?predicate]) test every element of their array. Given a FilterIndex, a filter over a
+ * tape array of at least FilterIndex::MinElements elements that requires a field to equal a literal
+ * (id == 42, alone or as a term of its && chain) only tests the elements the index holds for that
+ * literal, building the index on first use.
+ *
+ * The tryEvaluateRef overloads return failures as a JsonError instead of throwing them. Path misses
+ * (missing keys, indices out of bounds, steps into the wrong type) never raise an exception: they
+ * are passed back up the evaluation as return values, so a miss costs about as much as a hit. Rarer
+ * failures, such as a function given a value of the wrong type, still unwind to the tryEvaluateRef
+ * boundary. evaluateRef throws std::runtime_error with the error's message.
  */
 class JsonEvaluator {
 public:
     static Json evaluate(const Json& json, const std::string& expression) {
-        std::string exp = expression;
-        exp.erase(std::remove_if(exp.begin(), exp.end(), ::isspace), exp.end());
-
-        size_t pos = 0;
-
-        if (exp.substr(0, 3) == "min" && exp[3] == '(') {
-            pos += 4;
-            return evaluateMin(json, exp, pos);
-        } else if (exp.substr(0, 3) == "max" && exp[3] == '(') {
-            pos += 4;
-            return evaluateMax(json, exp, pos);
-        } else if (exp.substr(0, 4) == "size" && exp[4] == '(') {
-            pos += 5;
-            return evaluateSize(json, exp, pos);
-        } else {
-            return evaluateExpression(json, exp, pos);
-        }
+        return evaluate(json, CompiledExpression::compile(expression));
     }
 
+    static Json evaluate(const JsonTape& tape, const std::string& expression) {
+        return evaluate(tape, CompiledExpression::compile(expression));
+    }
+
+    static Json evaluate(const Json& json, const CompiledExpression& expression) {
+        return evaluateRef(json, expression).toJson();
+    }
+
+    static Json evaluate(const JsonTape& tape, const CompiledExpression& expression) {
+        return evaluateRef(tape, expression).toJson();
+    }
+
+    // The result points into json or tape, which must outlive it, an owned result may use resource
+    static JsonRef evaluateRef(const Json& json, const CompiledExpression& expression,
+                               std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+    static JsonRef evaluateRef(const JsonTape& tape, const CompiledExpression& expression,
+                               std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    // Equality filters over large arrays use and extend indexes, which must belong to tape
+    static JsonRef evaluateRef(const JsonTape& tape, const CompiledExpression& expression, FilterIndex& indexes,
+                               std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    // Start of a Path node resolved ahead of time: its first `steps` steps lead to `value`
+    template <class Ref>
+    struct PathPrefix {
+        size_t steps = 0;
+        Ref value;
+    };
+
+    // Paths start from their prefix instead of the root, prefixes is indexed by node id (see ExpressionBatch)
+    static JsonRef evaluateRef(const JsonTape& tape, const CompiledExpression& expression,
+                               const std::vector<PathPrefix<JsonTape::Ref>>& prefixes, FilterIndex* indexes = nullptr,
+                               std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    // Same as the evaluateRef overloads, failures are returned instead of thrown
+    static JsonResult<JsonRef> tryEvaluateRef(const Json& json, const CompiledExpression& expression,
+                                              std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+    static JsonResult<JsonRef> tryEvaluateRef(const JsonTape& tape, const CompiledExpression& expression,
+                                              std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+    static JsonResult<JsonRef> tryEvaluateRef(const JsonTape& tape, const CompiledExpression& expression, FilterIndex& indexes,
+                                              std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+    static JsonResult<JsonRef> tryEvaluateRef(const JsonTape& tape, const CompiledExpression& expression,
+                                              const std::vector<PathPrefix<JsonTape::Ref>>& prefixes, FilterIndex* indexes = nullptr,
+                                              std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    // A JsonError's key views the expression, which must outlive the result
+    static JsonResult<JsonRef> tryEvaluateRef(const Json& json, CompiledExpression&& expression,
+                                              std::pmr::memory_resource* resource = std::pmr::get_default_resource()) = delete;
+    static JsonResult<JsonRef> tryEvaluateRef(const JsonTape& tape, CompiledExpression&& expression,
+                                              std::pmr::memory_resource* resource = std::pmr::get_default_resource()) = delete;
+    static JsonResult<JsonRef> tryEvaluateRef(const JsonTape& tape, CompiledExpression&& expression, FilterIndex& indexes,
+                                              std::pmr::memory_resource* resource = std::pmr::get_default_resource()) = delete;
+    static JsonResult<JsonRef> tryEvaluateRef(const JsonTape& tape, CompiledExpression&& expression,
+                                              const std::vector<PathPrefix<JsonTape::Ref>>& prefixes, FilterIndex* indexes = nullptr,
+                                              std::pmr::memory_resource* resource = std::pmr::get_default_resource()) = delete;
+
 private:
-    static Json evaluateExpression(const Json& json, const std::string& exp, size_t& pos);
-    static void evaluateObject(const Json*& current, const std::string& exp, size_t& start, size_t& pos);
-    static void evaluateList(const Json& json, const Json*& current, const std::string& exp, size_t& pos);
+    using Node = CompiledExpression::Node;
+
+    template <class Ref>
+    struct Document {
+        Ref root;
+        const std::vector<PathPrefix<Ref>>* prefixes = nullptr;
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource();
+        FilterIndex* indexes = nullptr;
+        std::optional<JsonError>* error = nullptr;  // Where the first path miss is recorded
+    };
+
+    static constexpr size_t ParallelArgumentCost = 32;
+    static constexpr size_t ParallelArrayElements = size_t(1) << 15;
+    static constexpr size_t ParallelArrayChunk = size_t(1) << 13;
+    static constexpr size_t ParallelPackedChunk = size_t(1) << 16;
+
+    // Path misses come back as the error, every other failure is thrown
+    template <class Ref>
+    static JsonResult<JsonRef> evaluateChecked(Document<Ref> document, const CompiledExpression& expression);
+    template <class Ref>
+    static JsonResult<JsonRef> tryEvaluateRoot(const Document<Ref>& document, const CompiledExpression& expression);
+
+    // The functions returning bool return false after a path miss, recorded in document.error
+    template <class Ref>
+    static bool miss(const Document<Ref>& document, JsonError error);
+    template <class Ref>
+    static bool evaluateRoot(const Document<Ref>& document, const CompiledExpression& expression, JsonRef& out);
+    template <class Ref>
+    static bool evaluateNode(const Document<Ref>& document, const CompiledExpression& expression, size_t id, Json& out);
+    template <class Ref>
+    static bool evaluatePath(const Document<Ref>& document, const CompiledExpression& expression, size_t id, Ref& out);
+    template <class Ref, class F>
+    static bool withArgument(const Document<Ref>& document, const CompiledExpression& expression, size_t id, F&& f);
+    template <class Ref>
+    static bool evaluateIndex(const Document<Ref>& document, const CompiledExpression& expression,
+                              const CompiledExpression::Step& step, size_t& index);
+
+    // Numbers reached by a projection as raw tape words (int64 or the bits of a double)
+    struct Column {
+        explicit Column(std::pmr::memory_resource* resource) : ints(resource), doubles(resource) {}
+
+        std::pmr::vector<uint64_t> ints;
+        std::pmr::vector<uint64_t> doubles;
+        size_t others = 0;      // Values that are not numbers
+    };
+
+    template <class Ref>
+    static bool walkPath(const Document<Ref>& document, const CompiledExpression& expression, size_t id, size_t last, Ref& out);
+    template <class Ref, class F>
+    static bool project(const Document<Ref>& document, const CompiledExpression& expression, size_t id, F&& f);
+    template <class Ref, class F>
+    static void projectFrom(const Document<Ref>& document, const CompiledExpression& expression, const Node& node, size_t i, Ref current, F& f);
+    template <class Ref, class F>
+    static void filter(const Document<Ref>& document, const CompiledExpression& expression, size_t predicate, const Ref& array, F&& f);
+    template <class Ref, class F>
+    static bool filterIndexed(const Document<Ref>&, const CompiledExpression&, size_t, const Ref&, F&) { return false; }
+    template <class F>
+    static bool filterIndexed(const Document<JsonTape::Ref>& document, const CompiledExpression& expression, size_t predicate,
+                              const JsonTape::Ref& array, F& f);
+    static bool indexedEquality(const CompiledExpression& expression, size_t predicate, size_t& field, size_t& literal);
 
-    static Json evaluateMin(const Json& json, const std::string& exp, size_t& pos);
-    static Json evaluateMax(const Json& json, const std::string& exp, size_t& pos);
-    static Json evaluateSize(const Json& json, const std::string& exp, size_t& pos);
+    template <class Ref>
+    static bool evaluateAggregate(const Document<Ref>& document, const CompiledExpression& expression, const Node& node,
+                                  Aggregate::Kind kind, Json& out);
+    template <class Ref>
+    static bool mergeArguments(const Document<Ref>& document, const CompiledExpression& expression, const Node& node,
+                               ThreadPool& pool, Aggregate& result);
+    template <class Ref>
+    static bool evaluateCount(const Document<Ref>& document, const CompiledExpression& expression, const Node& node, Json& out);
+    template <class Ref>
+    static bool evaluateSize(const Document<Ref>& document, const CompiledExpression& expression, const Node& node, Json& out);
+    template <class Ref>
+    static bool accumulateArgument(const Document<Ref>& document, const CompiledExpression& expression, size_t id, Aggregate& result);
+    template <class Ref>
+    static void accumulateArray(const Ref& array, Aggregate& result);
+    static void accumulatePacked(const uint64_t* values, size_t count, bool isInt, Aggregate& result);
+    static Aggregate reducePacked(const uint64_t* values, size_t count, bool isInt, Aggregate::Kind kind);
+    template <class Ref>
+    static void accumulateNumber(const Ref& value, Aggregate& result, const char* error);
+    template <class Ref>
+    static void gather(const Ref& value, Column& column);
+    template <class Ref>
+    static void gatherNumber(const Ref& value, Column& column);
+    static void accumulateColumn(const Column& column, Aggregate& result);
 };
 
-#endif // JSON_EVALUATOR_HPP
\ No newline at end of file
+#endif // JSON_EVALUATOR_HPP
@@ -0,0 +1,48 @@
+// include/json_parser/jsonLines.hpp
+#ifndef JSON_LINES_HPP
+#define JSON_LINES_HPP
+
+#include "aggregate.hpp"
+#include "compiledExpression.hpp"
+#include "jsonWriter.hpp"
+#include "pathFilter.hpp"
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <ostream>
+#include <string_view>
+
+/**
+ * @class JsonLines
+ * @brief Evaluates one expression on every record of an NDJSON / JSON Lines input
+ *
+ * The input is cut into chunks of about chunkBytes at line boundaries. Each chunk is parsed and
+ * evaluated on the shared ThreadPool, record by record on the tape, while the calling thread writes
+ * finished chunks in input order. At most maxChunksInFlight chunks are pending, so memory stays
+ * bounded by that many chunks of output however large the input is. Blank lines are skipped.
+ *
+ * A record that fails reports "Error: line N: ..." on the error stream and the run continues.
+ * With an aggregate, per-record results are not written; their min/max/sum/count is returned.
+ */
+class JsonLines {
+public:
+    struct Options {
+        size_t chunkBytes = size_t(4) << 20;
+        size_t maxChunksInFlight = 0;                   // 0: twice the pool size
+        const PathFilter* filter = nullptr;             // Selective parsing of every record
+        std::optional<Aggregate::Kind> aggregate;
+        JsonWriter::Style style = JsonWriter::Style::Spaced;       // Layout of the per-record results
+        std::function<void(size_t offset, size_t length)> consumed;    // Input range no longer referenced
+    };
+
+    struct Summary {
+        size_t records = 0;
+        size_t failures = 0;
+        std::optional<Aggregate> aggregate;
+    };
+
+    static Summary process(std::string_view input, const CompiledExpression& expression, const Options& options,
+                           std::ostream& out, std::ostream& err);
+};
+
+#endif // JSON_LINES_HPP
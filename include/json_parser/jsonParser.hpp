@@ -3,28 +3,193 @@
 #define JSON_PARSER_HPP
 
 #include "json.hpp"
+#include "jsonResult.hpp"
+#include "jsonTape.hpp"
+#include "structuralIndex.hpp"
+#include "pathFilter.hpp"
+#include <cstddef>
+#include <memory_resource>
 #include <string>
+#include <string_view>
 #include <stdexcept>
-#include <regex>
+#include <vector>
 
 /**
  * @class JsonParser
- * @brief Static function for parsing string to Json object
+ * @brief Static functions for parsing a string to a Json object or to a read-only JsonTape
+ *
+ * The input is taken as a std::string_view, so a MappedFile can be parsed without copying it.
+ * A JsonTape keeps pointing into the input for strings without escapes, therefore parseTape
+ * refuses temporaries. Parsing runs in two stages: StructuralIndex marks every token start with
+ * SIMD, then the recursive descent below jumps from token to token using that bitmap.
+ *
+ * The DOM is built without copies: children are parsed onto a Scratch stack shared by the whole
+ * parse and moved into their container once it closes, so every array and object allocates its
+ * storage once, at its final size.
+ *
+ * parse builds every string, array and object of the DOM from the memory resource it is given,
+ * the default resource unless one is passed. With an arena the whole document is one allocation
+ * block that can be dropped at once, see JsonDocument. The Parallel variants build from the default
+ * resource, their chunks are filled on several threads.
+ *
+ * The PathFilter overloads only build what an expression can reach. Everything else is skipped by
+ * bracket matching over the structural index, and is therefore not validated either.
+ *
+ * The Parallel variants split a large top-level array or object between its elements: a pre-scan
+ * over the structural index tracks the bracket depth and cuts at depth-one commas, each chunk is
+ * parsed on the ThreadPool into buffers of its own, and the chunks are joined in input order.
+ * Documents below two chunks, or whose root is not a container, are parsed on the calling thread.
+ *
+ * Malformed input throws ParseError, which carries the offset of the byte the parser stopped at in
+ * the whole input. When a chunk fails the Parallel variants parse the document again on the calling
+ * thread, so the error and its offset are those of a sequential parse. The try variants return it
+ * as an InvalidJson JsonError instead.
  */
 class JsonParser {
 public:
-    static Json parse(const std::string& jsonString) {
+    class ParseError : public std::runtime_error {
+    public:
+        ParseError(const std::string& message, size_t offset)
+            : std::runtime_error(message + " at byte " + std::to_string(offset)), position(offset) {}
+
+        size_t offset() const { return position; }
+
+    private:
+        size_t position;
+    };
+
+    static constexpr size_t DefaultChunkBytes = size_t(1) << 20;
+
+    static Json parse(std::string_view jsonString,
+                      std::pmr::memory_resource* resource = std::pmr::get_default_resource()) {
+        StructuralIndex index(jsonString);
+        Scratch scratch(resource);
         size_t pos = 0;
-        return parseValue(jsonString, pos);
+        return located(pos, [&]() { return parseValue(index, pos, scratch); });
+    }
+
+    static Json parse(std::string_view jsonString, const PathFilter& filter,
+                      std::pmr::memory_resource* resource = std::pmr::get_default_resource()) {
+        StructuralIndex index(jsonString);
+        Scratch scratch(resource);
+        size_t pos = 0;
+        return located(pos, [&]() { return parseValue(index, pos, scratch, filter.root()); });
+    }
+
+    static JsonTape parseTape(std::string_view jsonString) {
+        return buildTape(StructuralIndex(jsonString), nullptr);
+    }
+
+    static JsonTape parseTape(std::string_view jsonString, const PathFilter& filter) {
+        return buildTape(StructuralIndex(jsonString), filter.root());
+    }
+
+    static Json parseParallel(std::string_view jsonString, size_t minChunkBytes = chunkBytes());
+    static JsonTape parseTapeParallel(std::string_view jsonString, size_t minChunkBytes = chunkBytes());
+
+    static JsonTape parseTape(std::string&& jsonString) = delete;
+    static JsonTape parseTape(std::string&& jsonString, const PathFilter& filter) = delete;
+    static JsonTape parseTapeParallel(std::string&& jsonString, size_t minChunkBytes = chunkBytes()) = delete;
+
+    // Malformed input is returned as an error at the offset the parse stopped at instead of thrown
+    static JsonResult<Json> tryParse(std::string_view jsonString,
+                                     std::pmr::memory_resource* resource = std::pmr::get_default_resource()) {
+        return attempt([&]() { return parse(jsonString, resource); });
+    }
+
+    static JsonResult<JsonTape> tryParseTape(std::string_view jsonString) {
+        return attempt([&]() { return parseTape(jsonString); });
+    }
+
+    static JsonResult<JsonTape> tryParseTape(std::string_view jsonString, const PathFilter& filter) {
+        return attempt([&]() { return parseTape(jsonString, filter); });
     }
 
+    static JsonResult<JsonTape> tryParseTape(std::string&& jsonString) = delete;
+    static JsonResult<JsonTape> tryParseTape(std::string&& jsonString, const PathFilter& filter) = delete;
+
+    // Smallest chunk the Parallel variants hand to a worker, JSON_EVAL_CHUNK_BYTES overrides DefaultChunkBytes
+    static size_t chunkBytes();
+
 private:
-    static Json parseValue(const std::string& content, size_t& pos);
-    static Json parseObject(const std::string& content, size_t& pos);
-    static Json parseArray(const std::string& content, size_t& pos);
-    static std::string parseString(const std::string& json, size_t& pos);
-    static Json parseNumber(const std::string& json, size_t& pos);
-    static void skipWhitespace(const std::string& content, size_t& pos);
+    // A null scope parses everything, otherwise only what the PathFilter node reaches
+    using Scope = const PathFilter::Node*;
+
+    // Children of the containers still open, each container moves its own off the top when it closes.
+    // The stacks are reused for the whole parse and live on the heap, the nodes use resource.
+    // Escaped strings are decoded into text before they are copied into their value
+    struct Scratch {
+        explicit Scratch(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) : resource(resource) {}
+
+        std::pmr::memory_resource* resource;
+        std::vector<Json> elements;
+        std::vector<JsonObject::Member> members;
+        std::string text;
+    };
+
+    static Json parseValue(const StructuralIndex& content, size_t& pos, Scratch& scratch, Scope scope = nullptr);
+    static Json parseObject(const StructuralIndex& content, size_t& pos, Scratch& scratch, Scope scope);
+    static Json parseArray(const StructuralIndex& content, size_t& pos, Scratch& scratch, Scope scope);
+    // The characters of the string, decoded into buffer if it has escapes
+    static std::string_view parseString(const StructuralIndex& content, size_t& pos, std::string& buffer);
+    static std::string_view scanString(const StructuralIndex& content, size_t& pos, bool& escaped);
+    template <class String>
+    static void unescapeString(std::string_view raw, String& out);
+    struct Number {
+        bool isInt = false;
+        int64_t integer = 0;
+        double real = 0;
+    };
+
+    static Json parseNumber(const StructuralIndex& content, size_t& pos);
+    static Number scanNumber(const StructuralIndex& content, size_t& pos);
+    static void skipWhitespace(const StructuralIndex& content, size_t& pos);
+    static bool matchLiteral(const StructuralIndex& content, size_t& pos, std::string_view literal);
+    static void skipValue(const StructuralIndex& content, size_t& pos);
+    static bool isSelective(Scope scope) { return scope != nullptr && !scope->full; }
+
+    // Rethrows errors of parse() as ParseError at pos, the position the parser had reached
+    template <class F>
+    static auto located(size_t& pos, F&& parse) -> decltype(parse()) {
+        try {
+            return parse();
+        } catch (const ParseError&) {
+            throw;
+        } catch (const std::runtime_error& e) {
+            throw ParseError(e.what(), pos);
+        }
+    }
+
+    template <class F>
+    static auto attempt(F&& parse) -> JsonResult<decltype(parse())> {
+        try {
+            return parse();
+        } catch (const ParseError& e) {
+            return JsonError(JsonError::Code::InvalidJson, e.what(), e.offset());
+        }
+    }
+
+    // Element counts and shape of one chunk of a split container
+    struct Elements {
+        size_t count = 0;
+        bool uniform = true;
+        bool allInt = true;
+        bool allDouble = true;
+    };
+
+    static JsonTape buildTape(const StructuralIndex& content, Scope scope);
+    static std::vector<size_t> splitElements(const StructuralIndex& content, size_t open, size_t minChunkBytes);
+    template <class F>
+    static void parseElements(const StructuralIndex& content, size_t& pos, size_t end, bool isObject, F&& element);
+    template <class F>
+    static bool parseChunks(size_t open, const std::vector<size_t>& ends, F&& parseChunk);
+    static Elements parseTapeElements(const StructuralIndex& content, size_t& pos, size_t end, JsonTape& tape, bool isObject);
+    static void joinTape(JsonTape& tape, std::vector<JsonTape>& chunks, const std::vector<Elements>& shapes, bool isObject);
+
+    static void parseTapeValue(const StructuralIndex& content, size_t& pos, JsonTape& tape, Scope scope = nullptr);
+    static void parseTapeContainer(const StructuralIndex& content, size_t& pos, JsonTape& tape, bool isObject, Scope scope);
+    static void parseTapeString(const StructuralIndex& content, size_t& pos, JsonTape& tape);
+    static void mergeRepeatedKeys(JsonTape& tape, size_t start);
 };
 
 #endif // JSON_PARSER_HPP
\ No newline at end of file
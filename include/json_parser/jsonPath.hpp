@@ -0,0 +1,227 @@
+// include/json_parser/jsonPath.hpp
+#ifndef JSON_PATH_HPP
+#define JSON_PATH_HPP
+
+#include "json.hpp"
+#include "jsonTape.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+/**
+ * @struct JsonPathStep
+ * @brief One step of a JsonPath: a key with its precomputed hash, or a constant index
+ *
+ * parse() is constexpr, so a malformed path in a constant expression fails the build with the
+ * message it would throw at run time.
+ */
+struct JsonPathStep {
+    bool isKey = false;
+    std::string_view key;   // Points into the parsed text
+    uint32_t hash = 0;
+    size_t index = 0;
+
+    // Number of steps in path; out, when given, receives them
+    static constexpr size_t parse(std::string_view path, JsonPathStep* out) {
+        size_t count = 0;
+        size_t pos = skipSpaces(path, 0);
+        if (pos == path.size()) {
+            throw std::runtime_error("Empty path");
+        }
+
+        while (pos < path.size()) {
+            JsonPathStep step;
+            if (path[pos] == '[') {
+                pos = skipSpaces(path, pos + 1);
+                size_t digits = pos;
+                for (; pos < path.size() && path[pos] >= '0' && path[pos] <= '9'; ++pos) {
+                    if (step.index > (SIZE_MAX - 9) / 10) {
+                        throw std::runtime_error("Index too large in path");
+                    }
+                    step.index = step.index * 10 + static_cast<size_t>(path[pos] - '0');
+                }
+                if (pos == digits) {
+                    throw std::runtime_error("Paths only take constant non-negative indices");
+                }
+                pos = skipSpaces(path, pos);
+                if (pos == path.size() || path[pos] != ']') {
+                    throw std::runtime_error("Expected ']' in path");
+                }
+                ++pos;
+            } else {
+                if (count > 0) {
+                    if (path[pos] != '.') {
+                        throw std::runtime_error("Expected '.' or '[' in path");
+                    }
+                    pos = skipSpaces(path, pos + 1);
+                }
+                size_t begin = pos;
+                while (pos < path.size() && !isSpace(path[pos]) && !isDelimiter(path[pos])) {
+                    ++pos;
+                }
+                if (pos == begin) {
+                    throw std::runtime_error("Expected a key in path");
+                }
+                step.isKey = true;
+                step.key = path.substr(begin, pos - begin);
+                step.hash = JsonObject::hashKey(step.key);
+            }
+
+            if (out != nullptr) {
+                out[count] = step;
+            }
+            ++count;
+            pos = skipSpaces(path, pos);
+        }
+        return count;
+    }
+
+    // Moves current to the step's child. A strict step throws the errors JsonEvaluator reports
+    // where a lenient one returns false
+    bool follow(const Json*& current, bool strict) const {
+        const Json* next = nullptr;
+        if (isKey) {
+            next = current->isObject() ? current->asObject().find(key, hash) : nullptr;
+        } else if (current->isArray() && index < current->asArray().size()) {
+            next = &current->asArray()[index];
+        }
+        if (next == nullptr) {
+            return strict && fail(isKey ? current->isObject() : current->isArray());
+        }
+        current = next;
+        return true;
+    }
+
+    bool follow(JsonTape::Ref& current, bool strict) const {
+        bool found = isKey ? current.isObject() && current.find(key, hash, current)
+                           : current.isArray() && current.at(index, current);
+        return found || (strict && fail(isKey ? current.isObject() : current.isArray()));
+    }
+
+private:
+    static constexpr bool isSpace(char c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+    }
+
+    // The delimiters of CompiledExpression, a key ends at any of them
+    static constexpr bool isDelimiter(char c) {
+        return std::string_view(".[](),:*?@'\"=!<>&|").find(c) != std::string_view::npos;
+    }
+
+    static constexpr size_t skipSpaces(std::string_view path, size_t pos) {
+        while (pos < path.size() && isSpace(path[pos])) {
+            ++pos;
+        }
+        return pos;
+    }
+
+    // container: current had the step's type, so the key or index was missing
+    bool fail(bool container) const {
+        if (isKey) {
+            throw std::runtime_error(container ? "Key '" + std::string(key) + "' not found"
+                                               : "Invalid path: Expected object at '" + std::string(key) + "'");
+        }
+        throw std::runtime_error(container ? "Array index out of bounds: " + std::to_string(index)
+                                           : "Invalid path: Expected array access");
+    }
+};
+
+/**
+ * @class JsonPath
+ * @brief A path of N keys and constant indices, parsed at compile time
+ *
+ * For embedders reading fixed paths on every request: JSON_PATH("a.b[2].c") parses the literal
+ * while compiling, and following the path is then a loop over N steps with hashes computed ahead,
+ * without the tokenizing, compiling and node dispatch of JsonEvaluator. The syntax is that of
+ * CompiledExpression paths without dynamic subscripts, slices or filters. With C++20 class-type
+ * template parameters, jsonPath<"a.b[2].c"> names the same path.
+ *
+ *     static constexpr auto price = JSON_PATH("order.items[0].price");
+ *     const Json* value = price.find(document);     // nullptr when missing
+ *
+ * find() returns a missing value as nullptr/false, evaluate() throws the errors JsonEvaluator would.
+ */
+template <size_t N>
+class JsonPath {
+public:
+    static_assert(N > 0, "A path has at least one step");
+
+    static constexpr JsonPath parse(std::string_view path) {
+        if (JsonPathStep::parse(path, nullptr) != N) {
+            throw std::runtime_error("Path does not have the expected number of steps");
+        }
+        JsonPath result;
+        JsonPathStep::parse(path, result.steps.data());
+        return result;
+    }
+
+    static constexpr size_t size() { return N; }
+    constexpr const JsonPathStep& operator[](size_t i) const { return steps[i]; }
+
+    const Json* find(const Json& root) const {
+        const Json* current = &root;
+        return walk(current, false) ? current : nullptr;
+    }
+
+    bool find(const JsonTape::Ref& root, JsonTape::Ref& out) const {
+        out = root;
+        return walk(out, false);
+    }
+
+    const Json& evaluate(const Json& root) const {
+        const Json* current = &root;
+        walk(current, true);
+        return *current;
+    }
+
+    // The result points into tape
+    JsonTape::Ref evaluate(const JsonTape& tape) const {
+        JsonTape::Ref current = tape.root();
+        walk(current, true);
+        return current;
+    }
+
+private:
+    std::array<JsonPathStep, N> steps{};
+
+    template <class Cursor>
+    bool walk(Cursor& current, bool strict) const {
+        for (const JsonPathStep& step : steps) {
+            if (!step.follow(current, strict)) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+// Parses a path literal at compile time into a JsonPath; C++17 has no string template arguments
+#define JSON_PATH(literal)                                                                         \
+    ([]() {                                                                                        \
+        constexpr std::string_view jsonPathText = literal;                                         \
+        constexpr auto jsonPathValue = JsonPath<JsonPathStep::parse(jsonPathText, nullptr)>::parse(jsonPathText); \
+        return jsonPathValue;                                                                      \
+    }())
+
+#if defined(__cpp_nontype_template_args) && __cpp_nontype_template_args >= 201911L
+// A string literal usable as a template argument; the steps' keys point into its copy
+template <size_t Size>
+struct JsonPathLiteral {
+    char text[Size] = {};
+
+    constexpr JsonPathLiteral(const char (&literal)[Size]) {
+        for (size_t i = 0; i < Size; ++i) {
+            text[i] = literal[i];
+        }
+    }
+    constexpr std::string_view view() const { return std::string_view(text, Size - 1); }
+};
+
+template <JsonPathLiteral Literal>
+inline constexpr auto jsonPath = JsonPath<JsonPathStep::parse(Literal.view(), nullptr)>::parse(Literal.view());
+#endif
+
+#endif // JSON_PATH_HPP
@@ -0,0 +1,50 @@
+// include/json_parser/jsonRef.hpp
+#ifndef JSON_REF_HPP
+#define JSON_REF_HPP
+
+#include "json.hpp"
+#include "jsonTape.hpp"
+#include <ostream>
+#include <utility>
+#include <variant>
+
+/**
+ * @class JsonRef
+ * @brief Result of an evaluation: a view into the evaluated document or a value it owns
+ *
+ * Paths select a value that already exists, so they are returned as a view (a DOM node or a tape
+ * cursor) without copying the subtree. Only computed values (function results, literals) are owned.
+ * A view is valid as long as the document it points into; call toJson() to keep a copy beyond that.
+ */
+class JsonRef {
+public:
+    JsonRef() : value(Json()) {}
+    explicit JsonRef(const Json* node) : value(node) {}
+    explicit JsonRef(const JsonTape::Ref& ref) : value(ref) {}
+    explicit JsonRef(Json owned) : value(std::move(owned)) {}
+
+    bool isView() const { return !std::holds_alternative<Json>(value); }
+
+    // Calls f with the value as a const Json& or a const JsonTape::Ref&, whichever it is
+    template <class F>
+    decltype(auto) visit(F&& f) const {
+        if (const auto* node = std::get_if<const Json*>(&value)) {
+            return f(**node);
+        }
+        if (const auto* ref = std::get_if<JsonTape::Ref>(&value)) {
+            return f(*ref);
+        }
+        return f(std::get<Json>(value));
+    }
+
+    // A deep copy of a view; an owned value is moved out of an rvalue
+    Json toJson() const&;
+    Json toJson() &&;
+
+private:
+    std::variant<const Json*, JsonTape::Ref, Json> value;
+};
+
+std::ostream& operator<<(std::ostream& os, const JsonRef& ref);
+
+#endif // JSON_REF_HPP
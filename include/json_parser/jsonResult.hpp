@@ -0,0 +1,109 @@
+// include/json_parser/jsonResult.hpp
+#ifndef JSON_RESULT_HPP
+#define JSON_RESULT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+
+/**
+ * @class JsonError
+ * @brief Why an evaluation or a parse failed: a code, a byte offset and a message formatted on demand
+ *
+ * Path misses (a missing key, an index out of bounds, a step into a value of the wrong type) are
+ * routine in real data and cost no allocation: the key is a view into the CompiledExpression, which
+ * must outlive the error, and the offset is the byte of the failing step in the expression text.
+ * Other failures keep their text; parse errors are offset in the input. message() is the text the
+ * throwing API reports for the same failure.
+ */
+class JsonError {
+public:
+    enum class Code : uint8_t {
+        KeyNotFound,        // An object without the key
+        ExpectedObject,     // A key step into a value that is not an object
+        ExpectedArray,      // A subscript into a value that is not an array
+        IndexOutOfBounds,
+        InvalidJson,        // Malformed input
+        EvaluationFailed    // Anything else, e.g. a function given a value of the wrong type
+    };
+
+    static constexpr size_t NoOffset = SIZE_MAX;
+
+    // A path miss; index is that of IndexOutOfBounds, below zero when negative is set
+    JsonError(Code code, size_t offset, std::string_view key = {}, uint64_t index = 0, bool negative = false)
+        : kind(code), position(offset), subject(key), magnitude(index), negativeIndex(negative) {}
+
+    // A failure described by its text
+    JsonError(Code code, std::string message, size_t offset = NoOffset)
+        : kind(code), position(offset), text(std::move(message)) {}
+
+    Code code() const { return kind; }
+    // In the expression for path misses, in the input for InvalidJson, NoOffset when unknown
+    size_t offset() const { return position; }
+    std::string_view key() const { return subject; }
+
+    std::string message() const {
+        switch (kind) {
+            case Code::KeyNotFound:
+                return "Key '" + std::string(subject) + "' not found";
+            case Code::ExpectedObject:
+                return "Invalid path: Expected object at '" + std::string(subject) + "'";
+            case Code::ExpectedArray:
+                return "Invalid path: Expected array access";
+            case Code::IndexOutOfBounds:
+                return "Array index out of bounds: " + std::string(negativeIndex ? "-" : "") + std::to_string(magnitude);
+            default:
+                return text;
+        }
+    }
+
+private:
+    Code kind;
+    size_t position;
+    std::string_view subject;
+    uint64_t magnitude = 0;
+    bool negativeIndex = false;
+    std::string text;
+};
+
+/**
+ * @class JsonResult
+ * @brief A T, or the JsonError that prevented it, in the manner of std::expected
+ */
+template <class T>
+class JsonResult {
+public:
+    JsonResult(T value) : state(std::in_place_index<0>, std::move(value)) {}
+    JsonResult(JsonError error) : state(std::in_place_index<1>, std::move(error)) {}
+
+    bool ok() const { return state.index() == 0; }
+    explicit operator bool() const { return ok(); }
+
+    // Throw std::bad_variant_access when the result holds the other alternative
+    T& value() & { return std::get<0>(state); }
+    const T& value() const& { return std::get<0>(state); }
+    T&& value() && { return std::get<0>(std::move(state)); }
+    const JsonError& error() const { return std::get<1>(state); }
+
+    T& operator*() & { return value(); }
+    const T& operator*() const& { return value(); }
+    T* operator->() { return &value(); }
+    const T* operator->() const { return &value(); }
+
+    // The value, or std::runtime_error with the message the throwing API reports
+    T valueOrThrow() && {
+        if (!ok()) {
+            throw std::runtime_error(error().message());
+        }
+        return std::get<0>(std::move(state));
+    }
+
+private:
+    std::variant<T, JsonError> state;
+};
+
+#endif // JSON_RESULT_HPP
@@ -0,0 +1,259 @@
+// include/json_parser/jsonTape.hpp
+#ifndef JSON_TAPE_HPP
+#define JSON_TAPE_HPP
+
+#include "json.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @class JsonTape
+ * @brief Read-only JSON document stored as one contiguous tape of tagged 64-bit words
+ *
+ * Every word carries its type in the top 8 bits and a 56-bit payload:
+ *  - null, true, false: one word, no payload
+ *  - int, double: tag word followed by a word holding the raw value
+ *  - string: tag word with the offset of the characters, followed by a word holding the length.
+ *    Strings without escape sequences point straight into the parsed input (SourceFlag set),
+ *    only escaped strings are decoded into the tape's own string buffer
+ *  - array, object: start word with the index of the matching end word, end word with the element count.
+ *    Arrays whose elements all take exactly two words carry UniformFlag and support O(1) at()
+ *  - packed array: a non-empty array of only ints or only doubles drops the per-element tag words,
+ *    the raw values follow the start word back to back (PackedIntFlag / PackedDoubleFlag) so numeric
+ *    reductions can run SIMD kernels over them (see NumericKernels)
+ *
+ * Object members are stored as a string (the key) followed by the value; a repeated key keeps its
+ * first position and takes the last value, as in Json. Because containers know
+ * where they end, a subtree is skipped in O(1) and size() never walks the children. Lookups into an
+ * object of at least Ref::IndexedMembers members go through a hash table of its keys, built by the
+ * second lookup into that object and kept with the tape (thread-safe).
+ * Built by JsonParser::parseTape or viewed in place in a mapped Snapshot; use the Json DOM when the
+ * document needs to be mutated. A tape references the input it was parsed from, which must outlive
+ * it (see MappedFile).
+ */
+class JsonTape {
+public:
+    enum class Type : uint8_t {
+        Null = 'n',
+        True = 't',
+        False = 'f',
+        Int = 'l',
+        Double = 'd',
+        String = '"',
+        ArrayStart = '[',
+        ArrayEnd = ']',
+        ObjectStart = '{',
+        ObjectEnd = '}'
+    };
+
+    static constexpr uint64_t PayloadMask = (uint64_t(1) << 56) - 1;
+    static constexpr uint64_t SourceFlag = uint64_t(1) << 55;
+    static constexpr uint64_t UniformFlag = uint64_t(1) << 55;
+    static constexpr uint64_t PackedIntFlag = uint64_t(1) << 54;
+    static constexpr uint64_t PackedDoubleFlag = uint64_t(1) << 53;
+    static constexpr uint64_t ContainerFlags = UniformFlag | PackedIntFlag | PackedDoubleFlag;
+
+    /**
+     * @class JsonTape::Ref
+     * @brief Lightweight cursor pointing at one value on the tape
+     *
+     * Elements of packed arrays have no tag word, their cursors carry the type in the top bits of
+     * the position instead. Walk packed arrays with forEach() or at(), not child()/after().
+     */
+    class Ref {
+    public:
+        Ref() = default;
+        Ref(const JsonTape* tape, size_t index) : tape(tape), pos(index) {}
+
+        Type type() const {
+            if (pos & PackedElement) {
+                return (pos & PackedInt) ? Type::Int : Type::Double;
+            }
+            return static_cast<Type>(word(pos) >> 56);
+        }
+        size_t index() const { return pos & ~PackedElement; }
+
+        bool isNull() const { return type() == Type::Null; }
+        bool isBool() const { return type() == Type::True || type() == Type::False; }
+        bool isInt() const { return type() == Type::Int; }
+        bool isDouble() const { return type() == Type::Double; }
+        bool isString() const { return type() == Type::String; }
+        bool isObject() const { return type() == Type::ObjectStart; }
+        bool isArray() const { return type() == Type::ArrayStart; }
+        bool isEnd() const { return type() == Type::ArrayEnd || type() == Type::ObjectEnd; }
+
+        bool asBool() const { return type() == Type::True; }
+        int64_t asInt() const { return static_cast<int64_t>(word(valueIndex())); }
+        double asDouble() const {
+            uint64_t raw = word(valueIndex());
+            double d;
+            std::memcpy(&d, &raw, sizeof(d));
+            return d;
+        }
+        std::string_view asString() const {
+            uint64_t offset = payload();
+            std::string_view base = (offset & SourceFlag) ? tape->source : std::string_view(tape->strings);
+            size_t start = static_cast<size_t>(offset & ~SourceFlag);
+            size_t length = static_cast<size_t>(word(pos + 1));
+            if (start > base.size() || length > base.size() - start) {
+                corrupted();
+            }
+            return base.substr(start, length);
+        }
+
+        // Element count of an array or object, length of a string. A container holds no more
+        // elements than words, so a corrupted count cannot send a reader past the container
+        size_t size() const {
+            if (isString()) {
+                return static_cast<size_t>(word(pos + 1));
+            }
+            size_t end = endIndex();
+            if (payload() & (PackedIntFlag | PackedDoubleFlag)) {
+                return end - pos - 1;
+            }
+            return std::min(static_cast<size_t>(word(end) & PayloadMask), end - pos - 1);
+        }
+
+        // Elements can be addressed directly instead of skipping over their predecessors
+        bool hasRandomAccess() const { return isArray() && (payload() & ContainerFlags) != 0; }
+
+        // Packed arrays expose their values as one contiguous buffer of raw words
+        bool isPackedInt() const { return isArray() && (payload() & PackedIntFlag) != 0; }
+        bool isPackedDouble() const { return isArray() && (payload() & PackedDoubleFlag) != 0; }
+        const uint64_t* packedData() const { return tape->data + pos + 1; }
+
+        // First child of a container; isEnd() is true on the result when the container is empty
+        Ref child() const { return Ref(tape, pos + 1); }
+
+        // Value following this one, skipping the whole subtree
+        Ref after() const {
+            switch (type()) {
+                case Type::Int:
+                case Type::Double:
+                    return Ref(tape, pos + ((pos & PackedElement) ? 1 : 2));
+                case Type::String:
+                    return Ref(tape, pos + 2);
+                case Type::ArrayStart:
+                case Type::ObjectStart:
+                    return Ref(tape, endIndex() + 1);
+                default:
+                    return Ref(tape, pos + 1);
+            }
+        }
+
+        // Smaller objects are scanned, as is any object on its first lookup: a one-off lookup costs
+        // less than hashing every key
+        static constexpr size_t IndexedMembers = 256;
+
+        bool find(std::string_view key, Ref& out) const { return find(key, JsonObject::hashKey(key), out); }
+        // hash is JsonObject::hashKey(key)
+        bool find(std::string_view key, uint32_t hash, Ref& out) const;
+        bool at(size_t index, Ref& out) const;
+
+        template <class F>
+        void forEach(F&& f) const {
+            if (payload() & (PackedIntFlag | PackedDoubleFlag)) {
+                size_t flag = (payload() & PackedIntFlag) ? PackedInt : PackedDouble;
+                for (size_t i = pos + 1, end = endIndex(); i < end; ++i) {
+                    f(Ref(tape, i | flag));
+                }
+                return;
+            }
+            for (Ref item = child(); !item.isEnd(); item = item.after()) {
+                f(item);
+            }
+        }
+
+        Json toJson() const;
+
+    private:
+        static constexpr size_t PackedInt = ~(~size_t(0) >> 1);
+        static constexpr size_t PackedDouble = PackedInt >> 1;
+        static constexpr size_t PackedElement = PackedInt | PackedDouble;
+
+        const JsonTape* tape = nullptr;
+        size_t pos = 0;
+
+        // Words are read through word() and links are checked before they are followed, so a
+        // corrupted snapshot (see Snapshot) throws instead of reading outside the tape. Every
+        // link points forward, walks always end
+        uint64_t word(size_t index) const {
+            if (index >= tape->count) {
+                corrupted();
+            }
+            return tape->data[index];
+        }
+        uint64_t payload() const { return word(pos) & PayloadMask; }
+        size_t endIndex() const {
+            size_t end = static_cast<size_t>(payload() & ~ContainerFlags);
+            if (end <= pos || end >= tape->count) {
+                corrupted();
+            }
+            return end;
+        }
+        [[noreturn]] static void corrupted();
+        size_t valueIndex() const { return (pos & PackedElement) ? (pos & ~PackedElement) : pos + 1; }
+    };
+
+    JsonTape() = default;
+    JsonTape(const JsonTape& other)
+        : words(other.words), strings(other.strings), source(other.source),
+          data(other.data == other.words.data() ? words.data() : other.data), count(other.count),
+          keys(std::atomic_load(&other.keys)) {}
+    JsonTape& operator=(const JsonTape& other) {
+        if (this != &other) {
+            *this = JsonTape(other);
+        }
+        return *this;
+    }
+    JsonTape(JsonTape&&) = default;
+    JsonTape& operator=(JsonTape&&) = default;
+
+    Ref root() const { return Ref(this, 0); }
+
+    size_t wordCount() const { return count; }
+    size_t stringBytes() const { return strings.size(); }
+
+private:
+    friend class JsonParser;
+    friend class Snapshot;
+
+    std::vector<uint64_t> words;        // Owned tape, built by JsonParser
+    std::string strings;
+    std::string_view source;
+    const uint64_t* data = nullptr;     // What cursors read: words once sealed, or the words of a Snapshot
+    size_t count = 0;
+
+    // Key tables of large objects by start word, created by the first Ref::find that needs one.
+    // Only read and replaced through std::atomic_load / std::atomic_compare_exchange_strong
+    struct KeyIndex;
+    mutable std::shared_ptr<KeyIndex> keys;
+
+    // Publishes the finished words to the cursors, the tape must not grow afterwards
+    void seal() {
+        data = words.data();
+        count = words.size();
+    }
+
+    // Cursor on a tape still being built, valid until the next append
+    Ref pending(size_t index) {
+        seal();
+        return Ref(this, index);
+    }
+
+    size_t append(Type type, uint64_t payload = 0) {
+        words.push_back((static_cast<uint64_t>(type) << 56) | (payload & PayloadMask));
+        return words.size() - 1;
+    }
+    void appendRaw(uint64_t raw) { words.push_back(raw); }
+    void patch(size_t index, uint64_t payload) {
+        words[index] = (words[index] & ~PayloadMask) | (payload & PayloadMask);
+    }
+};
+
+#endif // JSON_TAPE_HPP
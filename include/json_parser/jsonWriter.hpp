@@ -0,0 +1,93 @@
+// include/json_parser/jsonWriter.hpp
+#ifndef JSON_WRITER_HPP
+#define JSON_WRITER_HPP
+
+#include "json.hpp"
+#include "jsonTape.hpp"
+#include "jsonRef.hpp"
+#include <array>
+#include <cstddef>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+/**
+ * @class JsonWriter
+ * @brief Buffered JSON serializer for the Json DOM and JsonTape cursors
+ *
+ * Output collects in a fixed 64 KB block that is handed to the sink (a file descriptor or an
+ * std::ostream) whenever it fills up, so the sink sees few large writes. Numbers are formatted with
+ * std::to_chars, doubles in the shortest form that reads back to the same value. Strings are
+ * escaped: a SIMD scan (following StructuralIndex::activeKernel()) skips runs that need no escaping
+ * and a table gives the escape for the rest. Containers are walked with an explicit stack, so deep
+ * documents do not recurse. Packed tape arrays are written straight from their raw values.
+ *
+ * Spaced is the historic operator<< layout (", " and ": "), Compact drops the spaces and Pretty
+ * puts every member and element on its own line, indented by two spaces per level.
+ * Anything still buffered is written when the writer is destroyed.
+ */
+class JsonWriter {
+public:
+    enum class Style {
+        Spaced,
+        Compact,
+        Pretty
+    };
+
+    static constexpr int StandardOutput = 1;
+
+    explicit JsonWriter(int fd, Style style = Style::Spaced);
+    explicit JsonWriter(std::ostream& out, Style style = Style::Spaced);
+    ~JsonWriter();
+
+    JsonWriter(const JsonWriter&) = delete;
+    JsonWriter& operator=(const JsonWriter&) = delete;
+
+    void write(const Json& value);
+    void write(const JsonTape::Ref& value);
+    void write(const JsonRef& value);
+    // text as a quoted JSON string, escaped
+    void writeString(std::string_view text);
+    void writeRaw(std::string_view text);
+    // An object assembled by the caller, laid out in the writer's style: openObject(), then
+    // writeKey() and one write() per member, then closeObject()
+    void openObject() { open('{'); }
+    void writeKey(std::string_view key, bool first);
+    void closeObject(bool empty) { close('}', empty); }
+    void flush();
+
+    // Offset of the first byte that has to be escaped in a JSON string, size when there is none
+    static size_t escapeScan(const char* text, size_t size);
+
+    // Names of the styles ("spaced", "compact", "pretty"), as the query server receives them
+    static bool parseStyle(std::string_view name, Style& style);
+    static std::string_view styleName(Style style);
+
+private:
+    static constexpr size_t BlockBytes = size_t(1) << 16;
+
+    int fd = -1;
+    std::ostream* stream = nullptr;
+    Style style;
+    std::array<char, BlockBytes> block;
+    size_t used = 0;
+    size_t depth = 0;
+
+    void put(char c) {
+        if (used == BlockBytes) {
+            flush();
+        }
+        block[used++] = c;
+    }
+
+    void writeInt(int64_t value);
+    void writeDouble(double value);
+    void open(char bracket);
+    void item(bool first);
+    void close(char bracket, bool empty);
+    void colon();
+    void indent();
+    void packed(const JsonTape::Ref& array);
+};
+
+#endif // JSON_WRITER_HPP
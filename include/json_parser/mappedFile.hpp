@@ -0,0 +1,53 @@
+// include/json_parser/mappedFile.hpp
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @class MappedFile
+ * @brief Read-only memory mapping of a whole file
+ *
+ * The file contents are exposed as a std::string_view over the mapping, so nothing is copied.
+ * Files that cannot be mapped (pipes such as /dev/stdin or a process substitution, character
+ * devices) are read into a buffer the MappedFile owns instead, behind the same view(). Anything
+ * holding views into the file (for example a JsonTape) must not outlive the MappedFile; moving it
+ * keeps the views valid.
+ */
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& filePath);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    std::string_view view() const { return std::string_view(data, length); }
+    size_t size() const { return length; }
+
+    // Drops the pages of a range that has been processed from memory, they are re-read on access
+    void discard(size_t offset, size_t count) const;
+
+private:
+    const char* data = nullptr;
+    size_t length = 0;
+    std::vector<char> buffer;       // The contents when they are read rather than mapped
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+
+    void release();
+#ifdef _WIN32
+    void readAll(const std::string& filePath);
+#else
+    void readAll(int fd, const std::string& filePath);
+#endif
+};
+
+#endif // MAPPED_FILE_HPP
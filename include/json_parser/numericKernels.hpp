@@ -0,0 +1,30 @@
+// include/json_parser/numericKernels.hpp
+#ifndef NUMERIC_KERNELS_HPP
+#define NUMERIC_KERNELS_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @class NumericKernels
+ * @brief SIMD reductions over the packed numeric arrays of a JsonTape
+ *
+ * Values are passed as the raw tape words: two's complement int64 or the bit pattern of a double.
+ * Integer kernels stay in int64 throughout, so results are exact over the whole range instead of
+ * being rounded through double. The kernel (AVX2, SSE4.2 or scalar) follows
+ * StructuralIndex::activeKernel(), including the JSON_EVAL_SIMD override.
+ * min and max require count > 0; the count of a packed array is its size().
+ */
+class NumericKernels {
+public:
+    static int64_t minInt(const uint64_t* values, size_t count);
+    static int64_t maxInt(const uint64_t* values, size_t count);
+    static double minDouble(const uint64_t* values, size_t count);
+    static double maxDouble(const uint64_t* values, size_t count);
+
+    // False when the sum does not fit into int64
+    static bool sumInt(const uint64_t* values, size_t count, int64_t& sum);
+    static double sumDouble(const uint64_t* values, size_t count);
+};
+
+#endif // NUMERIC_KERNELS_HPP
@@ -0,0 +1,80 @@
+// include/json_parser/pathFilter.hpp
+#ifndef PATH_FILTER_HPP
+#define PATH_FILTER_HPP
+
+#include "compiledExpression.hpp"
+#include <deque>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * @class PathFilter
+ * @brief Trie of every document path a compiled expression can reach
+ *
+ * Handed to JsonParser::parse/parseTape to parse selectively: object members and array elements
+ * that are not on any path are skipped with bracket/quote matching only, without allocating or
+ * validating them. A node is full when the whole subtree is needed (the end of a path, or an array
+ * indexed by a dynamic subscript such as a.b[a.b[1]]). Skipped array elements before the last
+ * needed index are kept as null placeholders so indices stay valid. A projection (a.b[*].price)
+ * keeps every element of its array but only the rest of its path inside each of them; a filter
+ * (a.b[?id==1].price) also keeps the fields its predicate reads.
+ */
+class PathFilter {
+public:
+    struct Node {
+        bool full = false;
+        std::vector<std::pair<std::string, const Node*>> members;
+        std::vector<std::pair<size_t, const Node*>> elements;
+        size_t lastElement = 0;     // Highest index in elements
+        const Node* allElements = nullptr;  // Set by a slice, covers every element and replaces elements
+
+        // Child for an object member or array element, nullptr when it can be skipped
+        const Node* member(std::string_view key) const {
+            for (const auto& [name, child] : members) {
+                if (name == key) {
+                    return child;
+                }
+            }
+            return nullptr;
+        }
+
+        const Node* element(size_t index) const {
+            if (allElements != nullptr) {
+                return allElements;
+            }
+            for (const auto& [position, child] : elements) {
+                if (position == index) {
+                    return child;
+                }
+            }
+            return nullptr;
+        }
+    };
+
+    PathFilter() : nodes(1) {}
+    PathFilter(const PathFilter&) = delete;
+    PathFilter& operator=(const PathFilter&) = delete;
+    PathFilter(PathFilter&&) = default;
+    PathFilter& operator=(PathFilter&&) = default;
+
+    static PathFilter fromExpression(const CompiledExpression& expression);
+
+    // Adds every path of another expression, a filter built this way serves a whole batch
+    void add(const CompiledExpression& expression);
+
+    const Node* root() const { return &nodes.front(); }
+
+private:
+    // Children point at their nodes, a deque keeps those addresses stable while the trie grows
+    std::deque<Node> nodes;
+
+    Node* child(Node* parent, const std::string& key);
+    Node* child(Node* parent, size_t index);
+    Node* everyElement(Node* parent);
+    void addFields(Node* element, const CompiledExpression& expression, size_t predicate);
+    void merge(Node* target, const Node* source);
+};
+
+#endif // PATH_FILTER_HPP
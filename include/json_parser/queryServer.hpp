@@ -0,0 +1,46 @@
+// include/json_parser/queryServer.hpp
+#ifndef QUERY_SERVER_HPP
+#define QUERY_SERVER_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * @class QueryServer
+ * @brief Long-lived json_eval daemon answering (file, expression) queries over a Unix domain socket
+ *
+ * serve() keeps parsed documents in a DocumentCache, so queries against cached documents pay
+ * neither process startup nor parsing. The calling thread accepts connections and does all their
+ * socket IO without blocking; only answering a request runs on the shared ThreadPool, so a slow or
+ * stalled client never holds a worker. Clients get 5 seconds to send a request and to read its
+ * response.
+ * Clients send one request per connection and get one response back, both framed as
+ * length-prefixed fields:
+ *
+ *  request  := "query" file expression [style] | "stats"
+ *  response := status ("ok" | "error") text
+ *
+ * An empty expression returns the whole document; style names the JsonWriter layout of the text
+ * ("spaced" when left out, "compact" or "pretty"). File paths are resolved by the server, clients
+ * send them absolute. SIGINT/SIGTERM stop the server and remove the socket.
+ * Unix domain sockets are required, on other platforms every call throws.
+ */
+class QueryServer {
+public:
+    struct Options {
+        size_t cacheCapacity = 16;      // Parsed documents kept
+    };
+
+    struct Response {
+        bool ok = false;
+        std::string text;
+    };
+
+    static void serve(const std::string& socketPath, const Options& options);
+
+    // Sends one request and waits for its response, throws when the server cannot be reached
+    static Response request(const std::string& socketPath, const std::vector<std::string>& fields);
+};
+
+#endif // QUERY_SERVER_HPP
@@ -0,0 +1,21 @@
+// include/json_parser/simd.hpp
+#ifndef JSON_SIMD_HPP
+#define JSON_SIMD_HPP
+
+// Shared by the SIMD translation units: kernels are compiled per function with a target
+// attribute, so the rest of the build needs no -mavx2 and still runs on any x86-64 CPU
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define JSON_PARSER_X86 1
+#include <immintrin.h>
+#else
+#define JSON_PARSER_X86 0
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define JSON_PARSER_TARGET(isa) __attribute__((target(isa)))
+#else
+#define JSON_PARSER_TARGET(isa)
+#endif
+
+#endif // JSON_SIMD_HPP
@@ -0,0 +1,67 @@
+// include/json_parser/snapshot.hpp
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+#include "jsonTape.hpp"
+#include "mappedFile.hpp"
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * @class Snapshot
+ * @brief Binary image of a parsed JsonTape that is evaluated in place after mapping it
+ *
+ * The tape is already position independent (containers and strings refer to offsets, never to
+ * pointers), so a snapshot is a fixed header, the tape words and one string area:
+ *
+ *  header  := magic "JSONSNAP", version, byte-order mark, word count, string bytes,
+ *             payload checksum, source bytes, header checksum (64 bytes)
+ *  words   := the tape words, 8-byte aligned
+ *  strings := every distinct string of the document once, keys and values share the dictionary
+ *
+ * Opening maps the file and checks the header and the file size, which is O(1) in the document
+ * size; the tape then reads the mapping directly. The payload checksum is only recomputed by
+ * verify(), so a corrupted but well-sized payload is not detected otherwise. Reading one stays
+ * safe: JsonTape::Ref checks every container end and string it follows against the word count
+ * and the string area, and throws on a link outside them.
+ */
+class Snapshot {
+public:
+    static constexpr uint32_t Version = 1;
+
+    // Writes through a temporary file and renames it, readers never see a partial snapshot
+    static void write(const JsonTape& tape, const std::string& path);
+
+    static bool isSnapshot(std::string_view bytes);
+
+    explicit Snapshot(MappedFile file);
+
+    Snapshot(const Snapshot&) = delete;
+    Snapshot& operator=(const Snapshot&) = delete;
+
+    const JsonTape& tape() const { return view; }
+
+    // Recomputes the payload checksum, O(n)
+    bool verify() const;
+
+private:
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrder;
+        uint64_t wordCount;
+        uint64_t stringBytes;
+        uint64_t payloadChecksum;
+        uint64_t sourceBytes;
+        uint64_t reserved;
+        uint64_t headerChecksum;
+    };
+
+    MappedFile file;
+    JsonTape view;
+
+    const Header& header() const { return *reinterpret_cast<const Header*>(file.view().data()); }
+};
+
+#endif // SNAPSHOT_HPP
@@ -0,0 +1,72 @@
+// include/json_parser/stats.hpp
+#ifndef STATS_HPP
+#define STATS_HPP
+
+#include "jsonTape.hpp"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+/**
+ * @class Stats
+ * @brief Process-wide counters behind json_eval --stats
+ *
+ * Each Phase is timed with a Scope, which also records the heap allocations and ThreadPool tasks
+ * made while it was open. Allocations are only seen when the executable routes operator new
+ * through countAllocation(), as json_eval does.
+ *
+ * Everything here compiles out unless JSON_EVAL_STATS is defined (CMake option JSON_EVAL_STATS):
+ * the functions become empty inline ones and Scope an empty object, so release builds pay nothing.
+ */
+class Stats {
+public:
+    enum class Phase {
+        Read,
+        Parse,
+        Evaluate,
+        Print
+    };
+
+#if JSON_EVAL_STATS
+    static constexpr bool Enabled = true;
+
+    class Scope {
+    public:
+        explicit Scope(Phase phase);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        Phase phase;
+        std::chrono::steady_clock::time_point start;
+        uint64_t allocations;
+        uint64_t allocatedBytes;
+        uint64_t tasks;
+    };
+
+    static void countAllocation(size_t bytes);
+    static void countTask();
+    static void addBytesRead(size_t bytes);
+    // Values of every type in the document, keys not included
+    static void countNodes(const JsonTape& tape);
+    static void report(std::ostream& out, bool asJson);
+#else
+    static constexpr bool Enabled = false;
+
+    class Scope {
+    public:
+        explicit Scope(Phase) {}
+    };
+
+    static void countAllocation(size_t) {}
+    static void countTask() {}
+    static void addBytesRead(size_t) {}
+    static void countNodes(const JsonTape&) {}
+    static void report(std::ostream&, bool) {}
+#endif
+};
+
+#endif // STATS_HPP
@@ -0,0 +1,80 @@
+// include/json_parser/structuralIndex.hpp
+#ifndef STRUCTURAL_INDEX_HPP
+#define STRUCTURAL_INDEX_HPP
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/**
+ * @class StructuralIndex
+ * @brief First parsing stage: a bitmap marking where every token of the input starts
+ *
+ * The input is classified 64 bytes at a time (AVX2, SSE4.2 or a portable scalar kernel, picked at
+ * runtime via CPUID). A bit is set for every structural character ({ } [ ] : ,) outside strings,
+ * every unescaped quote (opening and closing) and the first byte of every scalar (numbers, true,
+ * false, null). JsonParser consumes the bitmap in its second stage: skipping whitespace and
+ * finding the end of a string become a find-next-set-bit instead of a byte loop.
+ *
+ * Setting the environment variable JSON_EVAL_SIMD to scalar, sse42 or avx2 overrides the
+ * detected kernel (useful for benchmarks and tests); a kernel the CPU does not support falls back
+ * to the best one it does. The Kernel given to the constructor must be supported.
+ */
+class StructuralIndex {
+public:
+    enum class Kernel {
+        Scalar,
+        Sse42,
+        Avx2
+    };
+
+    explicit StructuralIndex(std::string_view content) : StructuralIndex(content, activeKernel()) {}
+    StructuralIndex(std::string_view content, Kernel kernel);
+
+    static Kernel activeKernel();
+    static const char* kernelName(Kernel kernel);
+
+    std::string_view text() const { return content; }
+    size_t size() const { return content.size(); }
+    char operator[](size_t pos) const { return content[pos]; }
+    char peek(size_t pos) const { return pos < content.size() ? content[pos] : '\0'; }
+
+    // Position of the first token starting at or after pos, size() if there is none
+    size_t nextToken(size_t pos) const {
+        size_t word = pos >> 6;
+        if (word >= tokens.size()) {
+            return content.size();
+        }
+
+        uint64_t bits = tokens[word] & (~uint64_t(0) << (pos & 63));
+        while (bits == 0) {
+            if (++word == tokens.size()) {
+                return content.size();
+            }
+            bits = tokens[word];
+        }
+        return (word << 6) + countTrailingZeros(bits);
+    }
+
+    const std::vector<uint64_t>& bitmap() const { return tokens; }
+
+private:
+    std::string_view content;
+    std::vector<uint64_t> tokens;
+
+    static unsigned countTrailingZeros(uint64_t bits) {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64(&index, bits);
+        return static_cast<unsigned>(index);
+#else
+        return static_cast<unsigned>(__builtin_ctzll(bits));
+#endif
+    }
+};
+
+#endif // STRUCTURAL_INDEX_HPP
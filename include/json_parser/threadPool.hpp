@@ -0,0 +1,144 @@
+// include/json_parser/threadPool.hpp
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @class ThreadPool
+ * @brief Process-wide work-stealing thread pool sized to the core count
+ *
+ * Every worker owns a deque: it pops its own newest task and steals the oldest task of the
+ * others when it runs dry. Threads waiting on pool work (wait, parallelFor) run queued tasks
+ * themselves instead of blocking, so tasks may safely submit and wait on nested tasks; with none
+ * left to run they sleep until a task is queued or one finishes.
+ * The shared instance is created on first use; cheap work should never reach it.
+ */
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threadCount);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    static ThreadPool& instance();
+
+    size_t size() const { return threads.size(); }
+    uint64_t tasksExecuted() const { return executed.load(std::memory_order_relaxed); }
+
+    template <class F>
+    auto submit(F&& f) -> std::future<std::invoke_result_t<std::decay_t<F>>> {
+        using Result = std::invoke_result_t<std::decay_t<F>>;
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(f));
+        std::future<Result> future = task->get_future();
+        push([task]() { (*task)(); });
+        return future;
+    }
+
+    // Blocks until the future is ready, running queued tasks in the meantime
+    template <class T>
+    T wait(std::future<T>& future) {
+        helpUntil([&future]() { return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready; });
+        return future.get();
+    }
+
+    // Calls body(begin, end) on chunks of [0, count) no smaller than minChunk, the caller takes part
+    template <class F>
+    void parallelFor(size_t count, size_t minChunk, F&& body) {
+        size_t chunks = std::min(count / std::max<size_t>(minChunk, 1), size() * 4);
+        if (chunks <= 1) {
+            body(size_t(0), count);
+            return;
+        }
+
+        struct Shared {
+            std::atomic<size_t> remaining;
+            std::mutex mutex;
+            std::exception_ptr error;
+        };
+        auto shared = std::make_shared<Shared>();
+        shared->remaining = chunks;
+
+        auto runChunk = [shared, &body, count, chunks](size_t chunk) {
+            try {
+                body(count * chunk / chunks, count * (chunk + 1) / chunks);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(shared->mutex);
+                if (!shared->error) {
+                    shared->error = std::current_exception();
+                }
+            }
+            shared->remaining.fetch_sub(1, std::memory_order_acq_rel);
+        };
+
+        for (size_t chunk = 1; chunk < chunks; ++chunk) {
+            push([runChunk, chunk]() { runChunk(chunk); });
+        }
+        runChunk(0);
+
+        helpUntil([&shared]() { return shared->remaining.load(std::memory_order_acquire) == 0; });
+        if (shared->error) {
+            std::rethrow_exception(shared->error);
+        }
+    }
+
+    // Runs one queued task on the calling thread, false if there was none
+    bool runPendingTask();
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::atomic<size_t> pending{0};
+    std::atomic<size_t> nextQueue{0};
+    std::atomic<uint64_t> executed{0};
+    bool stopping = false;
+
+    std::atomic<size_t> waiters{0};
+
+    void push(std::function<void()> task);
+    bool tryPop(size_t self, std::function<void()>& task);
+    void workerLoop(size_t index);
+    void notifyWaiters();
+
+    // Runs queued tasks until done() holds, sleeping on wake while there are none. The fence pairs
+    // with the one in notifyWaiters: either the finishing task sees this thread waiting, or this
+    // thread sees what the task completed
+    template <class Done>
+    void helpUntil(Done&& done) {
+        while (!done()) {
+            if (runPendingTask()) {
+                continue;
+            }
+            waiters.fetch_add(1);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            {
+                std::unique_lock<std::mutex> lock(sleepMutex);
+                wake.wait(lock, [this, &done]() { return done() || pending.load(std::memory_order_acquire) != 0; });
+            }
+            waiters.fetch_sub(1);
+        }
+    }
+};
+
+#endif // THREAD_POOL_HPP
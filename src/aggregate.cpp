@@ -0,0 +1,152 @@
+// src/aggregate.cpp
+#include "../include/json_parser/aggregate.hpp"
+
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+// Three-way comparison of an int64 with a double without rounding either of them
+int compareExact(int64_t integer, double number) {
+    if (number >= 9223372036854775808.0) {
+        return -1;
+    }
+    if (number < -9223372036854775808.0) {
+        return 1;
+    }
+    double whole = std::floor(number);
+    int64_t truncated = static_cast<int64_t>(whole);
+    if (integer != truncated) {
+        return integer < truncated ? -1 : 1;
+    }
+    return whole < number ? -1 : 0;
+}
+
+} // namespace
+
+bool Aggregate::parseKind(std::string_view name, Kind& kind) {
+    if (name == "min") {
+        kind = Kind::Min;
+    } else if (name == "max") {
+        kind = Kind::Max;
+    } else if (name == "sum") {
+        kind = Kind::Sum;
+    } else if (name == "avg") {
+        kind = Kind::Avg;
+    } else if (name == "count") {
+        kind = Kind::Count;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void Aggregate::add(int64_t number) {
+    ++count;
+    switch (aggregateKind) {
+        case Kind::Min:
+            if (!hasInt || number < intValue) {
+                intValue = number;
+            }
+            break;
+        case Kind::Max:
+            if (!hasInt || number > intValue) {
+                intValue = number;
+            }
+            break;
+        case Kind::Sum:
+        case Kind::Avg: {
+            int64_t sum = intValue;
+            bool overflow = number > 0 ? sum > INT64_MAX - number : sum < INT64_MIN - number;
+            if (overflow) {
+                // Continue in double once the exact sum no longer fits
+                doubleValue += static_cast<double>(intValue);
+                intValue = number;
+                hasDouble = true;
+            } else {
+                intValue = sum + number;
+            }
+            break;
+        }
+        case Kind::Count:
+            break;
+    }
+    hasInt = true;
+}
+
+void Aggregate::add(double number) {
+    ++count;
+    switch (aggregateKind) {
+        case Kind::Min:
+            if (!hasDouble || number < doubleValue) {
+                doubleValue = number;
+            }
+            break;
+        case Kind::Max:
+            if (!hasDouble || number > doubleValue) {
+                doubleValue = number;
+            }
+            break;
+        case Kind::Sum:
+        case Kind::Avg:
+            doubleValue += number;
+            break;
+        case Kind::Count:
+            break;
+    }
+    hasDouble = true;
+}
+
+void Aggregate::addPartial(int64_t number, size_t values) {
+    add(number);
+    count += values - 1;
+}
+
+void Aggregate::addPartial(double number, size_t values) {
+    add(number);
+    count += values - 1;
+}
+
+void Aggregate::merge(const Aggregate& other) {
+    size_t total = count + other.count;
+    if (other.hasInt) {
+        add(other.intValue);
+    }
+    if (other.hasDouble) {
+        add(other.doubleValue);
+    }
+    count = total;
+}
+
+// min/max return the winner in its own type, on a tie between an int and a double the int
+Json Aggregate::result() const {
+    switch (aggregateKind) {
+        case Kind::Count:
+            return Json(static_cast<int64_t>(count));
+        case Kind::Sum:
+            if (!hasDouble) {
+                return Json(intValue);
+            }
+            return Json(doubleValue + static_cast<double>(intValue));
+        case Kind::Avg:
+            if (empty()) {
+                throw std::runtime_error("Aggregate of no values");
+            }
+            return Json((doubleValue + static_cast<double>(intValue)) / static_cast<double>(count));
+        default:
+            break;
+    }
+
+    if (empty()) {
+        throw std::runtime_error("Aggregate of no values");
+    }
+    if (!hasDouble) {
+        return Json(intValue);
+    }
+    if (!hasInt) {
+        return Json(doubleValue);
+    }
+    int order = compareExact(intValue, doubleValue);
+    bool intWins = aggregateKind == Kind::Max ? order >= 0 : order <= 0;
+    return intWins ? Json(intValue) : Json(doubleValue);
+}
@@ -0,0 +1,509 @@
+// src/compiledExpression.cpp
+#include "../include/json_parser/compiledExpression.hpp"
+
+#include <cctype>
+#include <charconv>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+struct CompiledExpression::Token {
+    enum Type : uint8_t {
+        Word,
+        Dot,
+        LBracket,
+        RBracket,
+        LParen,
+        RParen,
+        Comma,
+        Colon,
+        Star,
+        Question,
+        At,
+        Operator,   // == != < <= > >= && || !
+        String,     // Quoted literal, start and length include the quotes
+        End
+    };
+
+    Type type;
+    size_t start;
+    size_t length;
+};
+
+/**
+ * @class CompiledExpression::Compiler
+ * @brief Tokenizer and recursive descent parser filling a CompiledExpression
+ */
+class CompiledExpression::Compiler {
+public:
+    explicit Compiler(CompiledExpression& out) : out(out), text(out.text) {}
+
+    void tokenize() {
+        size_t pos = 0;
+        while (pos < text.size()) {
+            char c = text[pos];
+            if (std::isspace(static_cast<unsigned char>(c))) {
+                ++pos;
+                continue;
+            }
+
+            Token::Type type;
+            switch (c) {
+                case '.': type = Token::Dot; break;
+                case '[': type = Token::LBracket; break;
+                case ']': type = Token::RBracket; break;
+                case '(': type = Token::LParen; break;
+                case ')': type = Token::RParen; break;
+                case ',': type = Token::Comma; break;
+                case ':': type = Token::Colon; break;
+                case '*': type = Token::Star; break;
+                case '?': type = Token::Question; break;
+                case '@': type = Token::At; break;
+                case '\'': case '"': type = Token::String; break;
+                case '=': case '!': case '<': case '>': case '&': case '|': type = Token::Operator; break;
+                default: type = Token::Word; break;
+            }
+
+            if (type == Token::String) {
+                size_t end = text.find(c, pos + 1);
+                if (end == std::string::npos) {
+                    throw std::runtime_error("Unterminated string at position " + std::to_string(pos));
+                }
+                tokens.push_back({type, pos, end + 1 - pos});
+                pos = end + 1;
+                continue;
+            }
+
+            if (type == Token::Operator) {
+                // Doubled: == && ||, or followed by '=': != <= >=
+                char next = pos + 1 < text.size() ? text[pos + 1] : '\0';
+                bool pair = (next == '=' && c != '&' && c != '|') || (next == c && (c == '&' || c == '|'));
+                size_t length = pair ? 2 : 1;
+                std::string_view op(text.data() + pos, length);
+                if (op == "=" || op == "&" || op == "|") {
+                    throw std::runtime_error("Unexpected '" + std::string(op) + "' at position " + std::to_string(pos));
+                }
+                tokens.push_back({type, pos, length});
+                pos += length;
+                continue;
+            }
+
+            if (type != Token::Word) {
+                tokens.push_back({type, pos, 1});
+                ++pos;
+                continue;
+            }
+
+            // A word is a key, function name or number literal. Number literals keep their
+            // fraction unless the word itself follows a '.' (then it is a key such as a.0.c)
+            bool afterDot = !tokens.empty() && tokens.back().type == Token::Dot;
+            bool numeric = !afterDot && (std::isdigit(static_cast<unsigned char>(c)) || c == '-');
+            size_t start = pos;
+            while (pos < text.size()) {
+                char ch = text[pos];
+                if (ch == '.' && numeric && pos + 1 < text.size() && std::isdigit(static_cast<unsigned char>(text[pos + 1]))) {
+                    ++pos;
+                    continue;
+                }
+                if (std::isspace(static_cast<unsigned char>(ch)) || isDelimiter(ch)) {
+                    break;
+                }
+                ++pos;
+            }
+            tokens.push_back({Token::Word, start, pos - start});
+        }
+        tokens.push_back({Token::End, text.size(), 0});
+    }
+
+    size_t compile() {
+        if (peek().type == Token::End) {
+            throw std::runtime_error("Empty expression");
+        }
+
+        size_t root = parseExpression();
+        if (peek().type != Token::End) {
+            throw std::runtime_error("Unexpected '" + tokenText(peek()) + "' at position " + std::to_string(peek().start));
+        }
+        return root;
+    }
+
+private:
+    CompiledExpression& out;
+    const std::string& text;
+    std::vector<Token> tokens;
+    size_t current = 0;
+
+    static bool isDelimiter(char c) {
+        return std::string_view(".[](),:*?@'\"=!<>&|").find(c) != std::string_view::npos;
+    }
+
+    const Token& peek(size_t ahead = 0) const {
+        size_t i = current + ahead;
+        return i < tokens.size() ? tokens[i] : tokens.back();
+    }
+
+    const Token& advance() {
+        const Token& token = tokens[current];
+        if (current + 1 < tokens.size()) {
+            ++current;
+        }
+        return token;
+    }
+
+    bool isOperator(std::string_view op) const {
+        return peek().type == Token::Operator && std::string_view(text.data() + peek().start, peek().length) == op;
+    }
+
+    void expect(Token::Type type, const char* what) {
+        if (peek().type != type) {
+            throw std::runtime_error(std::string("Expected ") + what + " at position " + std::to_string(peek().start));
+        }
+        advance();
+    }
+
+    std::string tokenText(const Token& token) const {
+        if (token.type == Token::End) {
+            return "end of expression";
+        }
+        return text.substr(token.start, token.length);
+    }
+
+    size_t addNode(Node node) {
+        out.nodes.push_back(std::move(node));
+        return out.nodes.size() - 1;
+    }
+
+    size_t parseExpression() {
+        const Token& token = peek();
+
+        if (token.type == Token::Word && peek(1).type == Token::LParen) {
+            return parseFunction();
+        }
+
+        if (token.type == Token::Word) {
+            char c = text[token.start];
+            if (std::isdigit(static_cast<unsigned char>(c)) || c == '-') {
+                return parseNumber();
+            }
+        }
+
+        return parsePath();
+    }
+
+    size_t parseFunction() {
+        const Token& name = advance();
+        std::string_view fn(text.data() + name.start, name.length);
+
+        NodeType type;
+        if (fn == "min") {
+            type = NodeType::Min;
+        } else if (fn == "max") {
+            type = NodeType::Max;
+        } else if (fn == "size") {
+            type = NodeType::Size;
+        } else if (fn == "sum") {
+            type = NodeType::Sum;
+        } else if (fn == "avg") {
+            type = NodeType::Avg;
+        } else if (fn == "count") {
+            type = NodeType::Count;
+        } else {
+            throw std::runtime_error("Unknown function '" + std::string(fn) + "'");
+        }
+        advance(); // '('
+
+        std::vector<size_t> args;
+        if (peek().type != Token::RParen) {
+            args.push_back(parseExpression());
+            while (peek().type == Token::Comma) {
+                advance();
+                args.push_back(parseExpression());
+            }
+        }
+        expect(Token::RParen, "',' or ')' in function");
+
+        if (args.empty()) {
+            throw std::runtime_error(std::string(fn) + " function requires at least one argument");
+        }
+        if (type == NodeType::Size && args.size() != 1) {
+            throw std::runtime_error("size function takes exactly one argument");
+        }
+
+        Node node;
+        node.type = type;
+        node.first = out.arguments.size();
+        node.count = args.size();
+        node.cost = StepCost;
+        for (size_t arg : args) {
+            node.cost += out.nodes[arg].cost;
+        }
+        out.arguments.insert(out.arguments.end(), args.begin(), args.end());
+        return addNode(std::move(node));
+    }
+
+    size_t parseNumber() {
+        Node node;
+        node.type = NodeType::Number;
+        node.literal = numberLiteral(advance());
+        return addNode(std::move(node));
+    }
+
+    Json numberLiteral(const Token& token) const {
+        const char* begin = text.data() + token.start;
+        const char* end = begin + token.length;
+        int64_t integer = 0;
+        auto [ptr, ec] = std::from_chars(begin, end, integer);
+        if (ec == std::errc() && ptr == end) {
+            return Json(integer);
+        }
+        double number = 0.0;
+        auto [dptr, dec] = std::from_chars(begin, end, number);
+        if (dec != std::errc() || dptr != end) {
+            throw std::runtime_error("Invalid number literal '" + tokenText(token) + "'");
+        }
+        return Json(number);
+    }
+
+    static Step keyStep(std::string key) {
+        uint32_t hash = JsonObject::hashKey(key);
+        return {StepType::Key, 0, std::move(key), hash};
+    }
+
+    size_t parsePath() {
+        std::vector<Step> path;
+
+        if (peek().type == Token::Word) {
+            path.push_back(keyStep(tokenText(peek())));
+            path.back().position = advance().start;
+        } else if (peek().type != Token::LBracket) {
+            throw std::runtime_error("Unexpected " + tokenText(peek()) + " at position " + std::to_string(peek().start));
+        }
+
+        while (true) {
+            if (peek().type == Token::Dot) {
+                advance();
+                if (peek().type != Token::Word) {
+                    throw std::runtime_error("Expected key after '.' at position " + std::to_string(peek().start));
+                }
+                path.push_back(keyStep(tokenText(peek())));
+                path.back().position = advance().start;
+            } else if (peek().type == Token::LBracket) {
+                size_t position = advance().start;
+                path.push_back(parseSubscript());
+                path.back().position = position;
+                if (peek().type != Token::RBracket) {
+                    throw std::runtime_error("Missing closing bracket ]");
+                }
+                advance();
+            } else {
+                break;
+            }
+        }
+
+        Node node;
+        node.type = NodeType::Path;
+        node.first = out.steps.size();
+        node.count = path.size();
+        for (const auto& step : path) {
+            node.cost += StepCost;
+            if (step.type == StepType::Expression) {
+                node.cost += NestedSubscriptCost + out.nodes[step.value].cost;
+            } else if (step.type == StepType::Slice || step.type == StepType::Filter) {
+                node.cost += ProjectionCost;
+                node.projection = true;
+            }
+        }
+        for (auto& step : path) {
+            out.steps.push_back(std::move(step));
+        }
+        return addNode(std::move(node));
+    }
+
+    int64_t parseSliceBound() {
+        const Token& token = advance();
+        const char* begin = text.data() + token.start;
+        const char* end = begin + token.length;
+        int64_t bound = 0;
+        auto [ptr, ec] = std::from_chars(begin, end, bound);
+        if (token.type != Token::Word || ec != std::errc() || ptr != end) {
+            throw std::runtime_error("Invalid slice bound '" + tokenText(token) + "' at position " + std::to_string(token.start));
+        }
+        return bound;
+    }
+
+    // Every bound is optional: [a:b], [a:], [:b], [::c], [:]
+    Step parseSlice() {
+        Step step{StepType::Slice, 0, {}};
+        if (peek().type != Token::Colon) {
+            step.start = parseSliceBound();
+        }
+        expect(Token::Colon, "':' in slice");
+        if (peek().type != Token::Colon && peek().type != Token::RBracket) {
+            step.end = parseSliceBound();
+        }
+        if (peek().type == Token::Colon) {
+            advance();
+            if (peek().type != Token::RBracket) {
+                size_t position = peek().start;
+                step.stride = parseSliceBound();
+                if (step.stride <= 0) {
+                    throw std::runtime_error("Slice step must be positive at position " + std::to_string(position));
+                }
+            }
+        }
+        return step;
+    }
+
+    size_t addPredicate(PredicateType type, size_t left, size_t right = 0) {
+        out.predicates.push_back({type, Comparison::Equal, left, right});
+        return out.predicates.size() - 1;
+    }
+
+    size_t parsePredicate() {
+        size_t left = parseTerm();
+        while (isOperator("||")) {
+            advance();
+            size_t right = parseTerm();
+            left = addPredicate(PredicateType::Or, left, right);
+        }
+        return left;
+    }
+
+    size_t parseTerm() {
+        size_t left = parseFactor();
+        while (isOperator("&&")) {
+            advance();
+            size_t right = parseFactor();
+            left = addPredicate(PredicateType::And, left, right);
+        }
+        return left;
+    }
+
+    size_t parseFactor() {
+        if (isOperator("!")) {
+            advance();
+            return addPredicate(PredicateType::Not, parseFactor());
+        }
+        if (peek().type == Token::LParen) {
+            advance();
+            size_t inner = parsePredicate();
+            expect(Token::RParen, "')' in filter");
+            return inner;
+        }
+
+        size_t left = parseOperand();
+        static constexpr std::pair<std::string_view, Comparison> comparisons[] = {
+            {"==", Comparison::Equal}, {"!=", Comparison::NotEqual}, {"<", Comparison::Less},
+            {"<=", Comparison::LessEqual}, {">", Comparison::Greater}, {">=", Comparison::GreaterEqual}};
+        for (const auto& [op, comparison] : comparisons) {
+            if (isOperator(op)) {
+                advance();
+                size_t right = parseOperand();
+                size_t id = addPredicate(PredicateType::Compare, left, right);
+                out.predicates[id].comparison = comparison;
+                return id;
+            }
+        }
+        return addPredicate(PredicateType::Truthy, left);
+    }
+
+    size_t parseOperand() {
+        const Token& token = peek();
+        Operand operand;
+        if (token.type == Token::String) {
+            operand.literal = Json(text.substr(token.start + 1, token.length - 2));
+            advance();
+        } else if (token.type == Token::Word && (std::isdigit(static_cast<unsigned char>(text[token.start])) || text[token.start] == '-')) {
+            operand.literal = numberLiteral(advance());
+        } else if (token.type == Token::Word && (tokenText(token) == "true" || tokenText(token) == "false")) {
+            operand.literal = Json(tokenText(advance()) == "true");
+        } else if (token.type == Token::Word && tokenText(token) == "null") {
+            advance();
+        } else if (token.type == Token::Word || token.type == Token::At) {
+            parseField(operand);
+        } else {
+            throw std::runtime_error("Expected a value in filter at position " + std::to_string(token.start));
+        }
+        out.operands.push_back(std::move(operand));
+        return out.operands.size() - 1;
+    }
+
+    // Keys and constant indices below the element, the field name spells them out
+    void parseField(Operand& operand) {
+        std::vector<Step> field;
+        const Token& start = advance();
+        if (start.type == Token::Word) {
+            field.push_back(keyStep(tokenText(start)));
+        }
+        while (true) {
+            if (peek().type == Token::Dot) {
+                advance();
+                if (peek().type != Token::Word) {
+                    throw std::runtime_error("Expected key after '.' at position " + std::to_string(peek().start));
+                }
+                field.push_back(keyStep(tokenText(advance())));
+            } else if (peek().type == Token::LBracket) {
+                advance();
+                size_t index = 0;
+                const Token& token = peek();
+                const char* begin = text.data() + token.start;
+                const char* end = begin + token.length;
+                auto [ptr, ec] = std::from_chars(begin, end, index);
+                if (token.type != Token::Word || ec != std::errc() || ptr != end) {
+                    throw std::runtime_error("Filter fields only take constant indices at position " + std::to_string(token.start));
+                }
+                advance();
+                expect(Token::RBracket, "']' in filter");
+                field.push_back({StepType::Index, index, {}});
+            } else {
+                break;
+            }
+        }
+
+        operand.isField = true;
+        operand.first = out.steps.size();
+        operand.count = field.size();
+        for (auto& step : field) {
+            operand.field += step.type == StepType::Key ? "." + step.key : "[" + std::to_string(step.value) + "]";
+            out.steps.push_back(std::move(step));
+        }
+    }
+
+    Step parseSubscript() {
+        const Token& token = peek();
+        if (token.type == Token::Question) {
+            advance();
+            return {StepType::Filter, parsePredicate(), {}};
+        }
+        if (token.type == Token::Star && peek(1).type == Token::RBracket) {
+            advance();
+            return {StepType::Slice, 0, {}};
+        }
+        if (token.type == Token::Colon || (token.type == Token::Word && peek(1).type == Token::Colon)) {
+            return parseSlice();
+        }
+
+        if (token.type == Token::Word && peek(1).type == Token::RBracket) {
+            size_t index = 0;
+            const char* begin = text.data() + token.start;
+            const char* end = begin + token.length;
+            auto [ptr, ec] = std::from_chars(begin, end, index);
+            if (ec == std::errc() && ptr == end) {
+                advance();
+                return {StepType::Index, index, {}};
+            }
+        }
+
+        return {StepType::Expression, parseExpression(), {}};
+    }
+};
+
+CompiledExpression CompiledExpression::compile(const std::string& expression) {
+    CompiledExpression result;
+    result.text = expression;
+
+    Compiler compiler(result);
+    compiler.tokenize();
+    result.rootNode = compiler.compile();
+    return result;
+}
@@ -0,0 +1,91 @@
+// src/documentCache.cpp
+#include "../include/json_parser/documentCache.hpp"
+#include "../include/json_parser/jsonParser.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+#include <system_error>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+DocumentCache::Document::Document(const std::string& path) : file(path) {
+    // A daemon serves files named by any client, the checksum is checked once per load
+    if (Snapshot::isSnapshot(file.view())) {
+        snapshot.emplace(std::move(file));
+        if (!snapshot->verify()) {
+            throw std::runtime_error("Snapshot checksum mismatch");
+        }
+    } else {
+        parsed = JsonParser::parseTape(file.view());
+    }
+}
+
+DocumentCache::DocumentCache(size_t capacity) : capacity(std::max<size_t>(capacity, 1)) {
+}
+
+DocumentCache::Stamp DocumentCache::stampOf(const std::string& path) {
+    Stamp stamp;
+    std::error_code error;
+    auto modified = std::filesystem::last_write_time(path, error);
+    if (error) {
+        throw std::runtime_error("Unable to open file: " + path);
+    }
+    stamp.modified = static_cast<int64_t>(modified.time_since_epoch().count());
+
+#ifdef _WIN32
+    stamp.size = static_cast<uint64_t>(std::filesystem::file_size(path, error));
+#else
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) {
+        throw std::runtime_error("Unable to open file: " + path);
+    }
+    stamp.inode = static_cast<uint64_t>(info.st_ino);
+    stamp.size = static_cast<uint64_t>(info.st_size);
+#endif
+    return stamp;
+}
+
+std::shared_ptr<const DocumentCache::Document> DocumentCache::get(const std::string& path) {
+    // Stamped before parsing: a file changing during the parse is simply parsed again next time
+    Stamp stamp = stampOf(path);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(path);
+        if (it != entries.end() && it->second.stamp == stamp) {
+            ++counters.hits;
+            order.splice(order.begin(), order, it->second.position);
+            return it->second.document;
+        }
+        ++counters.misses;
+    }
+
+    auto document = std::make_shared<const Document>(path);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(path);
+    if (it != entries.end()) {
+        it->second.stamp = stamp;
+        it->second.document = document;
+        order.splice(order.begin(), order, it->second.position);
+        return document;
+    }
+
+    order.push_front(path);
+    entries.emplace(path, Entry{stamp, document, order.begin()});
+    while (entries.size() > capacity) {
+        entries.erase(order.back());
+        order.pop_back();
+        ++counters.evictions;
+    }
+    return document;
+}
+
+DocumentCache::Stats DocumentCache::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    Stats result = counters;
+    result.documents = entries.size();
+    return result;
+}
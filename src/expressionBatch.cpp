@@ -0,0 +1,173 @@
+// src/expressionBatch.cpp
+#include "../include/json_parser/expressionBatch.hpp"
+#include "../include/json_parser/jsonWriter.hpp"
+
+#include <stdexcept>
+
+using NodeType = CompiledExpression::NodeType;
+using StepType = CompiledExpression::StepType;
+
+ExpressionBatch ExpressionBatch::compile(const std::vector<std::string>& expressions) {
+    ExpressionBatch batch;
+    for (const auto& source : expressions) {
+        batch.add(source);
+    }
+    return batch;
+}
+
+ExpressionBatch ExpressionBatch::compile(std::istream& input) {
+    ExpressionBatch batch;
+    std::string line;
+    while (std::getline(input, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.find_first_not_of(" \t") != std::string::npos) {
+            batch.add(line);
+        }
+    }
+    return batch;
+}
+
+void ExpressionBatch::add(const std::string& source) {
+    Entry& entry = entries.emplace_back();
+    entry.source = source;
+    try {
+        entry.expression = CompiledExpression::compile(source);
+    } catch (const std::exception& e) {
+        entry.error = e.what();
+        return;
+    }
+
+    const CompiledExpression& expression = *entry.expression;
+    entry.prefixNodes.assign(expression.nodeCount(), 0);
+    for (size_t id = 0; id < expression.nodeCount(); ++id) {
+        const auto& node = expression.node(id);
+        if (node.type != NodeType::Path) {
+            continue;
+        }
+
+        size_t current = 0;
+        for (size_t i = 0; i < node.count; ++i) {
+            const auto& step = expression.step(node.first + i);
+            if (step.type == StepType::Expression || step.type == StepType::Slice || step.type == StepType::Filter) {
+                break;
+            }
+            current = child(current, step);
+        }
+        entry.prefixNodes[id] = current;
+    }
+    paths.add(expression);
+}
+
+size_t ExpressionBatch::child(size_t parent, const CompiledExpression::Step& step) {
+    bool isKey = step.type == StepType::Key;
+    for (size_t id : trie[parent].children) {
+        const TrieNode& node = trie[id];
+        if (node.isKey == isKey && (isKey ? node.key == step.key : node.index == step.value)) {
+            return id;
+        }
+    }
+
+    TrieNode node;
+    node.parent = parent;
+    node.depth = trie[parent].depth + 1;
+    node.isKey = isKey;
+    node.key = isKey ? step.key : std::string();
+    node.index = isKey ? 0 : step.value;
+    trie.push_back(std::move(node));
+    trie[parent].children.push_back(trie.size() - 1);
+    return trie.size() - 1;
+}
+
+std::vector<ExpressionBatch::Result> ExpressionBatch::evaluate(const JsonTape& tape) const {
+    // Parents come before their children, one pass resolves every reachable prefix once
+    std::vector<Ref> values(trie.size());
+    std::vector<bool> resolved(trie.size(), false);
+    values[0] = tape.root();
+    resolved[0] = true;
+    for (size_t id = 1; id < trie.size(); ++id) {
+        const TrieNode& node = trie[id];
+        if (!resolved[node.parent]) {
+            continue;
+        }
+        const Ref& parent = values[node.parent];
+        if (node.isKey) {
+            resolved[id] = parent.isObject() && parent.find(node.key, values[id]);
+        } else {
+            resolved[id] = parent.isArray() && parent.at(node.index, values[id]);
+        }
+    }
+
+    std::vector<Result> results(entries.size());
+    std::vector<JsonEvaluator::PathPrefix<Ref>> prefixes;
+    FilterIndex indexes;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const Entry& entry = entries[i];
+        Result& result = results[i];
+        if (!entry.expression) {
+            result.error = entry.error;
+            continue;
+        }
+
+        // A path whose prefix did not resolve starts from its deepest resolved ancestor instead
+        prefixes.assign(entry.prefixNodes.size(), JsonEvaluator::PathPrefix<Ref>());
+        for (size_t id = 0; id < entry.prefixNodes.size(); ++id) {
+            size_t node = entry.prefixNodes[id];
+            while (!resolved[node]) {
+                node = trie[node].parent;
+            }
+            if (node != 0) {
+                prefixes[id] = JsonEvaluator::PathPrefix<Ref>{trie[node].depth, values[node]};
+            }
+        }
+
+        try {
+            JsonResult<JsonRef> value = JsonEvaluator::tryEvaluateRef(tape, *entry.expression, prefixes, &indexes);
+            if (value) {
+                result.value = std::move(value).value();
+                result.ok = true;
+            } else {
+                result.error = value.error().message();
+            }
+        } catch (const std::exception& e) {
+            result.error = e.what();
+        }
+    }
+    return results;
+}
+
+void ExpressionBatch::write(std::ostream& out, const std::vector<Result>& results, bool asObject,
+                            JsonWriter::Style style) const {
+    JsonWriter writer(out, style);
+    if (!asObject) {
+        for (const auto& result : results) {
+            if (result.ok) {
+                writer.write(result.value);
+            } else {
+                writer.writeRaw("Error: ");
+                writer.writeRaw(result.error);
+            }
+            writer.writeRaw("\n");
+        }
+        writer.flush();
+        return;
+    }
+
+    // Expressions and error messages are escaped like any JSON string
+    writer.openObject();
+    for (size_t i = 0; i < results.size(); ++i) {
+        writer.writeKey(entries[i].source, i == 0);
+        if (results[i].ok) {
+            writer.write(results[i].value);
+        } else {
+            writer.openObject();
+            writer.writeKey("error", true);
+            writer.writeString(results[i].error);
+            writer.closeObject(false);
+        }
+    }
+    writer.closeObject(results.empty());
+    writer.writeRaw("\n");
+    writer.flush();
+}
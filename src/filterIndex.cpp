@@ -0,0 +1,25 @@
+// src/filterIndex.cpp
+#include "../include/json_parser/filterIndex.hpp"
+
+std::shared_ptr<const FilterIndex::Table> FilterIndex::table(const Ref& array, const std::string& field,
+                                                             const std::function<bool(const Ref&, std::string&)>& key) {
+    auto id = std::make_pair(array.index(), field);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = tables.find(id);
+        if (found != tables.end()) {
+            return found->second;
+        }
+    }
+
+    auto built = std::make_shared<Table>();
+    std::string value;
+    array.forEach([&](const Ref& item) {
+        if (key(item, value)) {
+            (*built)[value].push_back(item);
+        }
+    });
+
+    std::lock_guard<std::mutex> lock(mutex);
+    return tables.emplace(std::move(id), std::move(built)).first->second;
+}
@@ -1,38 +1,324 @@
 // src/json.cpp
 #include "../include/json_parser/json.hpp"
+#include "../include/json_parser/jsonWriter.hpp"
+#include <cstring>
+#include <new>
 
-std::ostream& operator<<(std::ostream& os, const Json& json) {
-    std::visit([&os](const auto& val) {
-        using T = std::decay_t<decltype(val)>;
-        if constexpr (std::is_same_v<T, std::nullptr_t>) {
-            os << "null";
-        } else if constexpr (std::is_same_v<T, bool>) {
-            os << (val ? "true" : "false");
-        } else if constexpr (std::is_same_v<T, int64_t>) {
-            os << val;
-        } else if constexpr (std::is_same_v<T, double>) {
-            os << val;
-        } else if constexpr (std::is_same_v<T, std::string>) {
-            os << "\"" << val << "\"";
-        } else if constexpr (std::is_same_v<T, std::unordered_map<std::string, Json>>) {
-            os << "{";
-            for (auto it = val.begin(); it != val.end(); ++it) {
-                if (it != val.begin()) {
-                    os << ", ";
-                }
-                os << "\"" << it->first << "\": " << it->second;
-            }
-            os << "}";
-        } else if constexpr (std::is_same_v<T, std::vector<Json>>) {
-            os << "[";
-            for (size_t i = 0; i < val.size(); ++i) {
-                if (i != 0) {
-                    os << ", ";
-                }
-                os << val[i];
+JsonObject::JsonObject(const std::unordered_map<std::string, Json>& map) {
+    reserve(map.size());
+    for (const auto& [key, value] : map) {
+        emplace(key, value);
+    }
+}
+
+void JsonObject::reserve(size_t count) {
+    members.reserve(count);
+    hashes.reserve(count);
+    if (count > IndexThreshold && slots.size() < count * 2) {
+        rebuildIndex(indexCapacity(count));
+    }
+}
+
+size_t JsonObject::indexCapacity(size_t count) {
+    size_t capacity = 64;
+    while (capacity < count * 2) {
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+size_t JsonObject::locate(std::string_view key, uint32_t hash) const {
+    if (slots.empty()) {
+        for (size_t i = 0; i < hashes.size(); ++i) {
+            if (hashes[i] == hash && members[i].first == key) {
+                return i;
             }
-            os << "]";
         }
-    }, json.value);
+        return members.size();
+    }
+
+    size_t mask = slots.size() - 1;
+    for (size_t slot = hash & mask; slots[slot] != EmptySlot; slot = (slot + 1) & mask) {
+        size_t position = slots[slot] - 1;
+        if (hashes[position] == hash && members[position].first == key) {
+            return position;
+        }
+    }
+    return members.size();
+}
+
+const Json* JsonObject::find(std::string_view key, uint32_t hash) const {
+    size_t position = locate(key, hash);
+    return position < members.size() ? &members[position].second : nullptr;
+}
+
+Json* JsonObject::find(std::string_view key, uint32_t hash) {
+    size_t position = locate(key, hash);
+    return position < members.size() ? &members[position].second : nullptr;
+}
+
+void JsonObject::insertSlot(size_t position) {
+    size_t mask = slots.size() - 1;
+    size_t slot = hashes[position] & mask;
+    while (slots[slot] != EmptySlot) {
+        slot = (slot + 1) & mask;
+    }
+    slots[slot] = static_cast<uint32_t>(position + 1);
+}
+
+void JsonObject::rebuildIndex(size_t capacity) {
+    slots.assign(capacity, EmptySlot);
+    for (size_t i = 0; i < members.size(); ++i) {
+        insertSlot(i);
+    }
+}
+
+Json& JsonObject::emplace(std::string_view key, Json value) {
+    return insert(key, std::move(value));
+}
+
+Json& JsonObject::emplace(std::pmr::string&& key, Json value) {
+    return insert(std::move(key), std::move(value));
+}
+
+Json& JsonObject::emplace(const char* key, Json value) {
+    return insert(std::string_view(key), std::move(value));
+}
+
+// The members vector constructs the key with its own allocator: a moved key of the same resource
+// is moved, anything else is copied into the resource
+template <class Key>
+Json& JsonObject::insert(Key&& key, Json&& value) {
+    uint32_t hash = hashKey(key);
+    size_t position = locate(key, hash);
+    if (position < members.size()) {
+        return members[position].second;
+    }
+
+    members.emplace_back(std::forward<Key>(key), std::move(value));
+    hashes.push_back(hash);
+
+    // The index stays at most half full so probe runs stay short. A reserved index is kept up to
+    // date below the threshold as well, so no lookup misses a member
+    if (members.size() > IndexThreshold && members.size() * 2 > slots.size()) {
+        rebuildIndex(indexCapacity(members.size()));
+    } else if (!slots.empty()) {
+        insertSlot(members.size() - 1);
+    }
+    return members.back().second;
+}
+
+Json& JsonObject::operator[](std::string_view key) {
+    return emplace(key, Json());
+}
+
+bool JsonObject::operator==(const JsonObject& other) const {
+    if (size() != other.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < members.size(); ++i) {
+        const Json* value = other.find(members[i].first, hashes[i]);
+        if (value == nullptr || !(*value == members[i].second)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+namespace {
+
+// Containers are placed in the resource their storage comes from, and given back to it
+template <class T, class... Args>
+T* allocate(std::pmr::memory_resource* resource, Args&&... args) {
+    void* block = resource->allocate(sizeof(T), alignof(T));
+    try {
+        return new (block) T(std::forward<Args>(args)...);
+    } catch (...) {
+        resource->deallocate(block, sizeof(T), alignof(T));
+        throw;
+    }
+}
+
+template <class T>
+void deallocate(T* box, std::pmr::memory_resource* resource) {
+    box->~T();
+    resource->deallocate(box, sizeof(T), alignof(T));
+}
+
+} // namespace
+
+Json::Json(std::string_view s, std::pmr::memory_resource* resource) {
+    if (s.size() <= ShortStringCapacity) {
+        storage.inlined.kind = Kind::ShortString;
+        storage.inlined.size = static_cast<uint8_t>(s.size());
+        std::memcpy(storage.inlined.text, s.data(), s.size());
+        return;
+    }
+
+    void* block = resource->allocate(sizeof(StringBlock) + s.size(), alignof(StringBlock));
+    StringBlock* string = new (block) StringBlock{resource, s.size()};
+    std::memcpy(static_cast<char*>(block) + sizeof(StringBlock), s.data(), s.size());
+    storage.tagged.kind = Kind::String;
+    storage.tagged.string = string;
+}
+
+Json::Json(const JsonObject& obj) : Json(JsonObject(obj)) {}
+
+Json::Json(JsonObject&& obj) {
+    storage.tagged.kind = Kind::Object;
+    storage.tagged.object = obj.empty() ? nullptr : allocate<JsonObject>(obj.resource(), std::move(obj));
+}
+
+Json::Json(const std::vector<Json>& arr) : Json(Array(arr.begin(), arr.end())) {}
+
+Json::Json(std::vector<Json>&& arr)
+    : Json(Array(std::make_move_iterator(arr.begin()), std::make_move_iterator(arr.end()))) {}
+
+Json::Json(Array&& arr) {
+    storage.tagged.kind = Kind::Array;
+    storage.tagged.array = arr.empty() ? nullptr : allocate<Array>(arr.get_allocator().resource(), std::move(arr));
+}
+
+Json::Json(const Json& other) : Json(copyOf(other)) {}
+
+// Out-of-line parts are copied into the default resource
+Json Json::copyOf(const Json& other) {
+    switch (other.kind()) {
+        case Kind::String:
+            return Json(other.asString());
+        case Kind::Object:
+            return Json(other.asObject());
+        case Kind::Array:
+            return Json(Array(other.asArray().begin(), other.asArray().end()));
+        default: {
+            Json copy;
+            copy.storage = other.storage;
+            return copy;
+        }
+    }
+}
+
+Json& Json::operator=(const Json& other) {
+    if (this != &other) {
+        Json copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+Json& Json::operator=(Json&& other) noexcept {
+    if (this != &other) {
+        // Taken out first: other may live inside this value
+        Storage taken = other.storage;
+        other.storage.tagged.kind = Kind::Null;
+        release();
+        storage = taken;
+    }
+    return *this;
+}
+
+void Json::release() noexcept {
+    switch (kind()) {
+        case Kind::String: {
+            StringBlock* string = storage.tagged.string;
+            string->resource->deallocate(string, sizeof(StringBlock) + string->size, alignof(StringBlock));
+            break;
+        }
+        case Kind::Object:
+            if (JsonObject* object = storage.tagged.object) {
+                deallocate(object, object->resource());
+            }
+            break;
+        case Kind::Array:
+            if (Array* array = storage.tagged.array) {
+                deallocate(array, array->get_allocator().resource());
+            }
+            break;
+        default:
+            break;
+    }
+    storage.tagged.kind = Kind::Null;
+}
+
+// Ints and doubles stay distinct, as they were as variant alternatives
+bool Json::operator==(const Json& other) const {
+    if (index() != other.index()) {
+        return false;
+    }
+    switch (kind()) {
+        case Kind::Null: return true;
+        case Kind::Bool: return asBool() == other.asBool();
+        case Kind::Int: return asInt() == other.asInt();
+        case Kind::Double: return asDouble() == other.asDouble();
+        case Kind::Object: return asObject() == other.asObject();
+        case Kind::Array: return asArray() == other.asArray();
+        default: return asString() == other.asString();
+    }
+}
+
+std::size_t Json::index() const {
+    switch (kind()) {
+        case Kind::Null: return 0;
+        case Kind::Bool: return 1;
+        case Kind::Int: return 2;
+        case Kind::Double: return 3;
+        case Kind::Object: return 5;
+        case Kind::Array: return 6;
+        default: return 4;
+    }
+}
+
+std::string_view Json::asString() const {
+    if (kind() == Kind::ShortString) {
+        return std::string_view(storage.inlined.text, storage.inlined.size);
+    }
+    const StringBlock* string = expect(Kind::String).string;
+    return std::string_view(string->data(), string->size);
+}
+
+const JsonObject& Json::asObject() const {
+    static const JsonObject empty;
+    const JsonObject* object = expect(Kind::Object).object;
+    return object != nullptr ? *object : empty;
+}
+
+const Json::Array& Json::asArray() const {
+    static const Array empty;
+    const Array* array = expect(Kind::Array).array;
+    return array != nullptr ? *array : empty;
+}
+
+// An empty container is created on first write, in the default resource
+JsonObject& Json::mutableObject() {
+    if (storage.tagged.object == nullptr) {
+        storage.tagged.object = allocate<JsonObject>(std::pmr::get_default_resource());
+    }
+    return *storage.tagged.object;
+}
+
+Json::Array& Json::mutableArray() {
+    if (storage.tagged.array == nullptr) {
+        storage.tagged.array = allocate<Array>(std::pmr::get_default_resource());
+    }
+    return *storage.tagged.array;
+}
+
+Json& Json::operator[](const std::string& key) {
+    if (!isObject()) {
+        throw std::runtime_error("Error: Json value is not an object");
+    }
+    return mutableObject()[key];
+}
+
+Json& Json::operator[](size_t index) {
+    if (!isArray()) {
+        throw std::runtime_error("Error: Json value is not an array");
+    }
+    return mutableArray()[index];
+}
+
+std::ostream& operator<<(std::ostream& os, const Json& json) {
+    JsonWriter writer(os);
+    writer.write(json);
     return os;
-}
\ No newline at end of file
+}
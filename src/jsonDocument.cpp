@@ -0,0 +1,29 @@
+// src/jsonDocument.cpp
+#include "../include/json_parser/jsonDocument.hpp"
+#include "../include/json_parser/jsonParser.hpp"
+#include <algorithm>
+#include <new>
+
+namespace {
+
+// The DOM takes a few times the size of its text, the first block covers small documents whole
+size_t initialBlock(std::string_view jsonString) {
+    return std::max<size_t>(4096, jsonString.size() * 2);
+}
+
+// The root is placed in the arena too, so releasing the arena releases everything
+const Json* place(std::pmr::memory_resource* arena, Json root) {
+    return new (arena->allocate(sizeof(Json), alignof(Json))) Json(std::move(root));
+}
+
+} // namespace
+
+JsonDocument::JsonDocument(std::string_view jsonString, std::pmr::memory_resource* upstream)
+    : arena(std::make_unique<std::pmr::monotonic_buffer_resource>(initialBlock(jsonString), upstream)) {
+    value = place(arena.get(), JsonParser::parse(jsonString, arena.get()));
+}
+
+JsonDocument::JsonDocument(std::string_view jsonString, const PathFilter& filter, std::pmr::memory_resource* upstream)
+    : arena(std::make_unique<std::pmr::monotonic_buffer_resource>(initialBlock(jsonString), upstream)) {
+    value = place(arena.get(), JsonParser::parse(jsonString, filter, arena.get()));
+}
@@ -1,301 +1,892 @@
 // src/jsonEvaluator.cpp
 #include "../include/json_parser/jsonEvaluator.hpp"
+#include "../include/json_parser/numericKernels.hpp"
+#include <cmath>
+#include <cstring>
+
+using NodeType = CompiledExpression::NodeType;
+using StepType = CompiledExpression::StepType;
+using PredicateType = CompiledExpression::PredicateType;
+using Comparison = CompiledExpression::Comparison;
+
+namespace {
+
+/**
+ * @class DomRef
+ * @brief Read-only cursor over the Json DOM exposing the same interface as JsonTape::Ref
+ */
+class DomRef {
+public:
+    DomRef() = default;
+    explicit DomRef(const Json* node) : node(node) {}
+
+    bool isNull() const { return node->isNull(); }
+    bool isBool() const { return node->isBool(); }
+    bool isInt() const { return node->isInt(); }
+    bool isDouble() const { return node->isDouble(); }
+    bool isString() const { return node->isString(); }
+    bool isObject() const { return node->isObject(); }
+    bool isArray() const { return node->isArray(); }
+
+    bool asBool() const { return node->asBool(); }
+    int64_t asInt() const { return node->asInt(); }
+    double asDouble() const { return node->asDouble(); }
+    std::string_view asString() const { return node->asString(); }
+
+    size_t size() const {
+        if (node->isString()) {
+            return node->asString().size();
+        }
+        return node->isArray() ? node->asArray().size() : node->asObject().size();
+    }
 
-Json JsonEvaluator::evaluateExpression(const Json& json, const std::string& exp, size_t& pos) {
-    const Json* current = &json;
+    bool find(std::string_view key, uint32_t hash, DomRef& out) const {
+        const Json* value = node->asObject().find(key, hash);
+        if (value == nullptr) {
+            return false;
+        }
+        out = DomRef(value);
+        return true;
+    }
 
-    while (pos < exp.length()) {
-        size_t start = pos;
-        while (pos < exp.length() && exp[pos] != '.' && exp[pos] != '[') {
-            ++pos;
+    bool at(size_t index, DomRef& out) const {
+        const auto& arr = node->asArray();
+        if (index >= arr.size()) {
+            return false;
         }
+        out = DomRef(&arr[index]);
+        return true;
+    }
 
-        if (pos > start) {
-            evaluateObject(current, exp, start, pos);
+    bool hasRandomAccess() const { return node->isArray(); }
+
+    // The DOM keeps every element as a Json, there is no packed storage to hand to NumericKernels
+    bool isPackedInt() const { return false; }
+    bool isPackedDouble() const { return false; }
+    const uint64_t* packedData() const { return nullptr; }
+
+    template <class F>
+    void forEach(F&& f) const {
+        for (const auto& item : node->asArray()) {
+            f(DomRef(&item));
         }
+    }
+
+    Json toJson() const { return *node; }
+    const Json* get() const { return node; }
+
+private:
+    const Json* node = nullptr;
+};
+
+JsonRef viewOf(const DomRef& value) { return JsonRef(value.get()); }
+JsonRef viewOf(const JsonTape::Ref& value) { return JsonRef(value); }
 
-        if (pos < exp.length()) {
-            if (exp[pos] == '.') {
-                ++pos;
-            } else if (exp[pos] == '[') {
-                ++pos;
-                evaluateList(json, current, exp, pos);
+bool isProjection(StepType type) { return type == StepType::Slice || type == StepType::Filter; }
+
+// ----------
+// FILTER PREDICATES
+// ----------
+
+// What a missing field reads as
+const Json NullValue;
+
+// Follows the Key and Index steps of a filter field from the element, false when they do not reach a value
+template <class Ref>
+bool resolveField(const CompiledExpression& expression, const CompiledExpression::Operand& operand, Ref& value) {
+    for (size_t i = 0; i < operand.count; ++i) {
+        const auto& step = expression.step(operand.first + i);
+        if (step.type == StepType::Key) {
+            if (!value.isObject() || !value.find(step.key, step.hash, value)) {
+                return false;
             }
+        } else if (!value.isArray() || !value.at(step.value, value)) {
+            return false;
         }
     }
+    return true;
+}
 
-    return *current;
+// Calls f with the value of an operand: its literal, the element's field, or null for a missing field
+template <class Ref, class F>
+bool withOperand(const CompiledExpression& expression, size_t id, const Ref& element, F&& f) {
+    const auto& operand = expression.operand(id);
+    if (!operand.isField) {
+        return f(DomRef(&operand.literal));
+    }
+    Ref value = element;
+    return resolveField(expression, operand, value) ? f(value) : f(DomRef(&NullValue));
 }
 
-void JsonEvaluator::evaluateObject(const Json*& current, const std::string& exp, size_t& start, size_t& pos) {
-    std::string key = exp.substr(start, pos - start);
+// Orders an int against a double exactly, the int is never rounded
+int compareMixed(int64_t integer, double real) {
+    if (real >= 9223372036854775808.0) {
+        return -1;
+    }
+    if (real < -9223372036854775808.0) {
+        return 1;
+    }
+    double whole = std::trunc(real);
+    int64_t truncated = static_cast<int64_t>(whole);
+    if (integer != truncated) {
+        return integer < truncated ? -1 : 1;
+    }
+    return real > whole ? -1 : (real < whole ? 1 : 0);
+}
 
-    if (!key.empty()) {
-        if (!current->isObject()) {
-            throw std::runtime_error("Invalid path: Expected object at '" + key + "'");
-        }
+template <class A, class B>
+int compareNumbers(const A& a, const B& b) {
+    if (a.isInt() && b.isInt()) {
+        return (a.asInt() > b.asInt()) - (a.asInt() < b.asInt());
+    }
+    if (a.isInt()) {
+        return compareMixed(a.asInt(), b.asDouble());
+    }
+    if (b.isInt()) {
+        return -compareMixed(b.asInt(), a.asDouble());
+    }
+    return (a.asDouble() > b.asDouble()) - (a.asDouble() < b.asDouble());
+}
 
-        auto it = current->asObject().find(key);
-        if (it == current->asObject().end()) {
-            throw std::runtime_error("Key '" + key + "' not found");
-        }
+template <class A, class B>
+bool equal(const A& a, const B& b) {
+    bool aNumber = a.isInt() || a.isDouble();
+    bool bNumber = b.isInt() || b.isDouble();
+    if (aNumber || bNumber) {
+        return aNumber && bNumber && compareNumbers(a, b) == 0;
+    }
+    if (a.isString() && b.isString()) {
+        return a.asString() == b.asString();
+    }
+    if (a.isBool() && b.isBool()) {
+        return a.asBool() == b.asBool();
+    }
+    if (a.isNull() || b.isNull()) {
+        return a.isNull() && b.isNull();
+    }
+    if ((a.isArray() && b.isArray()) || (a.isObject() && b.isObject())) {
+        return a.toJson() == b.toJson();
+    }
+    return false;
+}
+
+// Numbers order by value and strings by their bytes, any other pair is unordered
+template <class A, class B>
+bool compare(const A& a, const B& b, Comparison comparison) {
+    if (comparison == Comparison::Equal) {
+        return equal(a, b);
+    }
+    if (comparison == Comparison::NotEqual) {
+        return !equal(a, b);
+    }
+
+    int order = 0;
+    if ((a.isInt() || a.isDouble()) && (b.isInt() || b.isDouble())) {
+        order = compareNumbers(a, b);
+    } else if (a.isString() && b.isString()) {
+        int bytes = a.asString().compare(b.asString());
+        order = (bytes > 0) - (bytes < 0);
+    } else {
+        return false;
+    }
+
+    switch (comparison) {
+        case Comparison::Less: return order < 0;
+        case Comparison::LessEqual: return order <= 0;
+        case Comparison::Greater: return order > 0;
+        default: return order >= 0;
+    }
+}
+
+template <class Ref>
+bool truthy(const Ref& value) {
+    if (value.isNull()) {
+        return false;
+    }
+    if (value.isBool()) {
+        return value.asBool();
+    }
+    if (value.isString() || value.isArray() || value.isObject()) {
+        return value.size() > 0;
+    }
+    return true;
+}
 
-        current = &it->second;
+template <class Ref>
+bool test(const CompiledExpression& expression, size_t id, const Ref& element) {
+    const auto& predicate = expression.predicate(id);
+    switch (predicate.type) {
+        case PredicateType::Or:
+            return test(expression, predicate.left, element) || test(expression, predicate.right, element);
+        case PredicateType::And:
+            return test(expression, predicate.left, element) && test(expression, predicate.right, element);
+        case PredicateType::Not:
+            return !test(expression, predicate.left, element);
+        case PredicateType::Truthy:
+            return withOperand(expression, predicate.left, element, [](const auto& value) { return truthy(value); });
+        case PredicateType::Compare:
+            return withOperand(expression, predicate.left, element, [&](const auto& left) {
+                return withOperand(expression, predicate.right, element, [&](const auto& right) {
+                    return compare(left, right, predicate.comparison);
+                });
+            });
     }
+    return false;
+}
+
+} // namespace
+
+JsonRef JsonEvaluator::evaluateRef(const Json& json, const CompiledExpression& expression,
+                                   std::pmr::memory_resource* resource) {
+    return evaluateChecked(Document<DomRef>{DomRef(&json), nullptr, resource}, expression).valueOrThrow();
+}
+
+JsonRef JsonEvaluator::evaluateRef(const JsonTape& tape, const CompiledExpression& expression,
+                                   std::pmr::memory_resource* resource) {
+    return evaluateChecked(Document<JsonTape::Ref>{tape.root(), nullptr, resource}, expression).valueOrThrow();
+}
+
+JsonRef JsonEvaluator::evaluateRef(const JsonTape& tape, const CompiledExpression& expression, FilterIndex& indexes,
+                                   std::pmr::memory_resource* resource) {
+    return evaluateChecked(Document<JsonTape::Ref>{tape.root(), nullptr, resource, &indexes}, expression).valueOrThrow();
+}
+
+JsonRef JsonEvaluator::evaluateRef(const JsonTape& tape, const CompiledExpression& expression,
+                                   const std::vector<PathPrefix<JsonTape::Ref>>& prefixes, FilterIndex* indexes,
+                                   std::pmr::memory_resource* resource) {
+    return evaluateChecked(Document<JsonTape::Ref>{tape.root(), &prefixes, resource, indexes}, expression).valueOrThrow();
+}
+
+JsonResult<JsonRef> JsonEvaluator::tryEvaluateRef(const Json& json, const CompiledExpression& expression,
+                                                  std::pmr::memory_resource* resource) {
+    return tryEvaluateRoot(Document<DomRef>{DomRef(&json), nullptr, resource}, expression);
 }
 
-void JsonEvaluator::evaluateList(const Json& json, const Json*& current, const std::string& exp, size_t& pos) {
-    if (!current->isArray()) {
-        throw std::runtime_error("Invalid path: Expected array access");
+JsonResult<JsonRef> JsonEvaluator::tryEvaluateRef(const JsonTape& tape, const CompiledExpression& expression,
+                                                  std::pmr::memory_resource* resource) {
+    return tryEvaluateRoot(Document<JsonTape::Ref>{tape.root(), nullptr, resource}, expression);
+}
+
+JsonResult<JsonRef> JsonEvaluator::tryEvaluateRef(const JsonTape& tape, const CompiledExpression& expression, FilterIndex& indexes,
+                                                  std::pmr::memory_resource* resource) {
+    return tryEvaluateRoot(Document<JsonTape::Ref>{tape.root(), nullptr, resource, &indexes}, expression);
+}
+
+JsonResult<JsonRef> JsonEvaluator::tryEvaluateRef(const JsonTape& tape, const CompiledExpression& expression,
+                                                  const std::vector<PathPrefix<JsonTape::Ref>>& prefixes, FilterIndex* indexes,
+                                                  std::pmr::memory_resource* resource) {
+    return tryEvaluateRoot(Document<JsonTape::Ref>{tape.root(), &prefixes, resource, indexes}, expression);
+}
+
+template <class Ref>
+JsonResult<JsonRef> JsonEvaluator::evaluateChecked(Document<Ref> document, const CompiledExpression& expression) {
+    std::optional<JsonError> error;
+    document.error = &error;
+    JsonRef result;
+    if (!evaluateRoot(document, expression, result)) {
+        return std::move(*error);
     }
+    return result;
+}
 
-    size_t start = pos;
-    int bracketCount = 1;
-    bool isExpression = false;
+template <class Ref>
+JsonResult<JsonRef> JsonEvaluator::tryEvaluateRoot(const Document<Ref>& document, const CompiledExpression& expression) {
+    try {
+        return evaluateChecked(document, expression);
+    } catch (const std::runtime_error& e) {
+        return JsonError(JsonError::Code::EvaluationFailed, e.what());
+    }
+}
+
+// Keeps the first miss, a projection may run into several before it gives up
+template <class Ref>
+bool JsonEvaluator::miss(const Document<Ref>& document, JsonError error) {
+    if (!*document.error) {
+        document.error->emplace(std::move(error));
+    }
+    return false;
+}
 
-    while (pos < exp.length() && bracketCount != 0) {
-        if (exp[pos] == '[') {
-            bracketCount++;
-            isExpression = true;
-        } else if (exp[pos] == ']') {
-            bracketCount--;
-        } else if (!std::isdigit(exp[pos])) {
-            isExpression = true;
+// A path selects a value of the document and is returned as a view of it, anything else is computed
+template <class Ref>
+bool JsonEvaluator::evaluateRoot(const Document<Ref>& document, const CompiledExpression& expression, JsonRef& out) {
+    const Node& node = expression.node(expression.root());
+    if (node.type == NodeType::Path && !node.projection) {
+        Ref value;
+        if (!evaluatePath(document, expression, expression.root(), value)) {
+            return false;
         }
-        ++pos;
+        out = viewOf(value);
+        return true;
     }
 
-    if (pos > exp.length() || bracketCount != 0) {
-        throw std::runtime_error("Missing closing bracket ]");
+    Json value;
+    if (!evaluateNode(document, expression, expression.root(), value)) {
+        return false;
     }
+    out = JsonRef(std::move(value));
+    return true;
+}
 
-    std::string indexStr = exp.substr(start, pos - start - 1);
+template <class Ref>
+bool JsonEvaluator::evaluateNode(const Document<Ref>& document, const CompiledExpression& expression, size_t id, Json& out) {
+    const Node& node = expression.node(id);
 
-    // Number index
-    if (std::all_of(indexStr.begin(), indexStr.end(), ::isdigit)) {
-        size_t index = std::stoull(indexStr);
-        const auto& arr = current->asArray();
-        if (index >= arr.size()) {
-            throw std::runtime_error("Array index out of bounds: " + indexStr);
+    switch (node.type) {
+        case NodeType::Path:
+            if (node.projection) {
+                Json::Array values(document.resource);
+                if (!project(document, expression, id, [&values](const auto& value) { values.push_back(value.toJson()); })) {
+                    return false;
+                }
+                out = Json(std::move(values));
+                return true;
+            } else {
+                Ref value;
+                if (!evaluatePath(document, expression, id, value)) {
+                    return false;
+                }
+                out = value.toJson();
+                return true;
+            }
+        case NodeType::Number:
+            out = node.literal;
+            return true;
+        case NodeType::Min:
+            return evaluateAggregate(document, expression, node, Aggregate::Kind::Min, out);
+        case NodeType::Max:
+            return evaluateAggregate(document, expression, node, Aggregate::Kind::Max, out);
+        case NodeType::Sum:
+            return evaluateAggregate(document, expression, node, Aggregate::Kind::Sum, out);
+        case NodeType::Avg:
+            return evaluateAggregate(document, expression, node, Aggregate::Kind::Avg, out);
+        case NodeType::Count:
+            return evaluateCount(document, expression, node, out);
+        case NodeType::Size:
+            return evaluateSize(document, expression, node, out);
+    }
+
+    throw std::runtime_error("Invalid expression node");
+}
+
+template <class Ref>
+bool JsonEvaluator::evaluatePath(const Document<Ref>& document, const CompiledExpression& expression, size_t id, Ref& out) {
+    return walkPath(document, expression, id, expression.node(id).count, out);
+}
+
+// Follows the first `last` steps of a Path node, none of them may be a Slice or Filter
+template <class Ref>
+bool JsonEvaluator::walkPath(const Document<Ref>& document, const CompiledExpression& expression, size_t id, size_t last, Ref& current) {
+    using Code = JsonError::Code;
+    const Node& node = expression.node(id);
+    current = document.root;
+    size_t first = 0;
+    if (document.prefixes != nullptr && (*document.prefixes)[id].steps > 0) {
+        first = (*document.prefixes)[id].steps;
+        current = (*document.prefixes)[id].value;
+    }
+
+    for (size_t i = first; i < last; ++i) {
+        const auto& step = expression.step(node.first + i);
+
+        if (step.type == StepType::Key) {
+            if (!current.isObject()) {
+                return miss(document, JsonError(Code::ExpectedObject, step.position, step.key));
+            }
+            if (!current.find(step.key, step.hash, current)) {
+                return miss(document, JsonError(Code::KeyNotFound, step.position, step.key));
+            }
+            continue;
         }
-        current = &arr[index];
-    } else {
-        // Expression index
-        size_t exprPos = 0;
-        Json indexResult = evaluateExpression(json, indexStr, exprPos);
-        if (!indexResult.isInt()) {
-            throw std::runtime_error("Array index expression must evaluate to a number");
+
+        if (!current.isArray()) {
+            return miss(document, JsonError(Code::ExpectedArray, step.position));
         }
-        size_t index = static_cast<size_t>(indexResult.asInt());
-        const auto& arr = current->asArray();
-        if (index >= arr.size()) {
-            throw std::runtime_error("Array index out of bounds: " + std::to_string(index));
+
+        size_t index = step.value;
+        if (step.type != StepType::Index && !evaluateIndex(document, expression, step, index)) {
+            return false;
         }
-        current = &arr[index];
+        if (!current.at(index, current)) {
+            return miss(document, JsonError(Code::IndexOutOfBounds, step.position, {}, index));
+        }
+    }
+
+    return true;
+}
+
+// Calls f with a cursor on every value a projection selects, in document order
+template <class Ref, class F>
+bool JsonEvaluator::project(const Document<Ref>& document, const CompiledExpression& expression, size_t id, F&& f) {
+    const Node& node = expression.node(id);
+    size_t slice = 0;
+    while (!isProjection(expression.step(node.first + slice).type)) {
+        ++slice;
     }
 
-    // Array of array a[1][4]
-    if (pos < exp.length() && exp[pos] == '[') {
-        ++pos;
-        evaluateList(json, current, exp, pos);
+    Ref current;
+    if (!walkPath(document, expression, id, slice, current)) {
+        return false;
+    }
+    if (!current.isArray()) {
+        return miss(document, JsonError(JsonError::Code::ExpectedArray, expression.step(node.first + slice).position));
     }
+    projectFrom(document, expression, node, slice, current, f);
+    return !*document.error;
 }
 
-Json JsonEvaluator::evaluateMin(const Json& json, const std::string& exp, size_t& pos) {
-    std::vector<std::string> substrings;
-    std::vector<double> results;
-    std::vector<std::future<Json>> futures;
-    
-    // Parse substrings
-    while (pos < exp.size()) {
-        size_t start = pos;
-        while (pos < exp.size() && exp[pos] != ',' && exp[pos] != ')') {
-            ++pos;
+// Applies steps i.. of a projection to current. Past the first slice the path is lenient:
+// elements the rest of it does not reach are left out instead of failing the expression
+template <class Ref, class F>
+void JsonEvaluator::projectFrom(const Document<Ref>& document, const CompiledExpression& expression, const Node& node, size_t i, Ref current, F& f) {
+    for (; i < node.count; ++i) {
+        const auto& step = expression.step(node.first + i);
+
+        if (step.type == StepType::Key) {
+            if (!current.isObject() || !current.find(step.key, step.hash, current)) {
+                return;
+            }
+            continue;
         }
 
-        if (pos >= exp.size()) {
-            throw std::runtime_error("Expected ',' or ')' in function");
+        if (!current.isArray()) {
+            return;
         }
 
-        if (pos != start) {
-            substrings.push_back(exp.substr(start, pos - start));
+        if (step.type == StepType::Filter) {
+            filter(document, expression, step.value, current, [&](const Ref& item) {
+                projectFrom(document, expression, node, i + 1, item, f);
+            });
+            return;
         }
-        ++pos;
-    }
 
-    // Multithreaded evaluate each substring
-    for (const auto& substr : substrings) {
-        futures.push_back(std::async(std::launch::async, [&json, substr]() {
-            size_t pos = 0;
+        if (step.type != StepType::Slice) {
+            size_t index = step.value;
+            if (step.type != StepType::Index && !evaluateIndex(document, expression, step, index)) {
+                return;
+            }
+            if (!current.at(index, current)) {
+                return;
+            }
+            continue;
+        }
 
-            if (!substr.empty() && (std::isdigit(substr[0]) || substr[0] == '-' || substr[0] == '.')) {
-                bool hasDecimalPoint = false;
-                for (size_t i = 1; i < substr.size(); ++i) {
-                    if (!std::isdigit(substr[i])) {
-                        if (substr[i] == '.' && !hasDecimalPoint) {
-                            hasDecimalPoint = true;
-                        } else {
-                            throw std::runtime_error("More than one decimal point '.'");
-                        }
-                    }
+        int64_t size = static_cast<int64_t>(current.size());
+        auto bound = [size](int64_t value) {
+            if (value < 0) {
+                return std::max<int64_t>(size + value, 0);
+            }
+            return std::min(value, size);
+        };
+        int64_t begin = bound(step.start);
+        int64_t end = bound(step.end);
+
+        if (current.hasRandomAccess()) {
+            Ref item = current;
+            for (int64_t k = begin; k < end; k = end - k > step.stride ? k + step.stride : end) {
+                current.at(static_cast<size_t>(k), item);
+                projectFrom(document, expression, node, i + 1, item, f);
+            }
+        } else {
+            int64_t k = 0;
+            current.forEach([&](const auto& item) {
+                if (k >= begin && k < end && (k - begin) % step.stride == 0) {
+                    projectFrom(document, expression, node, i + 1, item, f);
                 }
+                ++k;
+            });
+        }
+        return;
+    }
 
-                return Json(std::stod(substr));
-            }
+    f(current);
+}
 
-            return JsonEvaluator::evaluateExpression(json, substr, pos);
-        }));
+// Calls f with every element of array the predicate holds for, in document order
+template <class Ref, class F>
+void JsonEvaluator::filter(const Document<Ref>& document, const CompiledExpression& expression, size_t predicate, const Ref& array, F&& f) {
+    if (filterIndexed(document, expression, predicate, array, f)) {
+        return;
     }
+    array.forEach([&](const Ref& item) {
+        if (test(expression, predicate, item)) {
+            f(item);
+        }
+    });
+}
 
-    // Wait for all futures
-    results.reserve(futures.size());
-    for (auto& future : futures) {
-        Json result = future.get();
-        if (result.isArray()) {
+// Only the elements the index holds for the literal can match, the whole predicate is still tested on them
+template <class F>
+bool JsonEvaluator::filterIndexed(const Document<JsonTape::Ref>& document, const CompiledExpression& expression, size_t predicate,
+                                  const JsonTape::Ref& array, F& f) {
+    size_t field = 0;
+    size_t literal = 0;
+    if (document.indexes == nullptr || array.size() < FilterIndex::MinElements ||
+        !indexedEquality(expression, predicate, field, literal)) {
+        return false;
+    }
 
-            // Arrays
-            for (const auto& item : result.asArray()) {
-                if (item.isInt()) {
-                    results.push_back(static_cast<double>(item.asInt()));
-                } else if (item.isDouble()) {
-                    results.push_back(item.asDouble());
-                } else {
-                    throw std::runtime_error("Array elements must be numeric");
-                }
+    const auto& operand = expression.operand(field);
+    auto table = document.indexes->table(array, operand.field, [&expression, &operand](const JsonTape::Ref& item, std::string& key) {
+        JsonTape::Ref value = item;
+        return resolveField(expression, operand, value) ? FilterIndex::keyOf(value, key) : FilterIndex::keyOf(DomRef(&NullValue), key);
+    });
+
+    std::string key;
+    FilterIndex::keyOf(DomRef(&expression.operand(literal).literal), key);
+    auto matches = table->find(key);
+    if (matches != table->end()) {
+        for (const JsonTape::Ref& item : matches->second) {
+            if (test(expression, predicate, item)) {
+                f(item);
             }
-
-        }else if (result.isInt()) {
-            results.push_back(static_cast<double>(result.asInt()));
-        } else if (result.isDouble()) {
-            results.push_back(result.asDouble());
-        } else {
-            throw std::runtime_error("Expression must evaluate to a number");
         }
     }
+    return true;
+}
 
-    if (results.empty()) {
-        throw std::runtime_error("min function requires at least one numeric value");
+// A field == literal comparison every match satisfies: the predicate itself or a term of its top-level && chain
+bool JsonEvaluator::indexedEquality(const CompiledExpression& expression, size_t id, size_t& field, size_t& literal) {
+    const auto& predicate = expression.predicate(id);
+    if (predicate.type == PredicateType::And) {
+        return indexedEquality(expression, predicate.left, field, literal) ||
+               indexedEquality(expression, predicate.right, field, literal);
+    }
+    if (predicate.type != PredicateType::Compare || predicate.comparison != Comparison::Equal) {
+        return false;
     }
 
-    double minValue = *std::min_element(results.begin(), results.end());
-    return Json(minValue);
+    bool leftField = expression.operand(predicate.left).isField;
+    if (leftField == expression.operand(predicate.right).isField) {
+        return false;
+    }
+    field = leftField ? predicate.left : predicate.right;
+    literal = leftField ? predicate.right : predicate.left;
+    return true;
 }
 
-Json JsonEvaluator::evaluateMax(const Json& json, const std::string& exp, size_t& pos) {
-    std::vector<std::string> substrings;
-    std::vector<double> results;
-    std::vector<std::future<Json>> futures;
-    
-    // Parse substrings
-    while (pos < exp.size()) {
-        size_t start = pos;
-        while (pos < exp.size() && exp[pos] != ',' && exp[pos] != ')') {
-            ++pos;
+// Calls f with a cursor on the argument: paths point into the document, anything else is computed
+template <class Ref, class F>
+bool JsonEvaluator::withArgument(const Document<Ref>& document, const CompiledExpression& expression, size_t id, F&& f) {
+    const Node& node = expression.node(id);
+    if (node.type == NodeType::Path && !node.projection) {
+        Ref value;
+        if (!evaluatePath(document, expression, id, value)) {
+            return false;
         }
-
-        if (pos >= exp.size()) {
-            throw std::runtime_error("Expected ',' or ')' in function");
+        f(value);
+    } else if (node.type == NodeType::Number) {
+        f(DomRef(&node.literal));
+    } else {
+        Json value;
+        if (!evaluateNode(document, expression, id, value)) {
+            return false;
         }
+        f(DomRef(&value));
+    }
+    return true;
+}
 
-        if (pos != start) {
-            substrings.push_back(exp.substr(start, pos - start));
+// Value of the nested expression of an Expression step
+template <class Ref>
+bool JsonEvaluator::evaluateIndex(const Document<Ref>& document, const CompiledExpression& expression,
+                                  const CompiledExpression::Step& step, size_t& index) {
+    int64_t value = 0;
+    bool found = withArgument(document, expression, step.value, [&value](const auto& indexResult) {
+        if (!indexResult.isInt()) {
+            throw std::runtime_error("Array index expression must evaluate to a number");
         }
-        ++pos;
+        value = indexResult.asInt();
+    });
+    if (!found) {
+        return false;
     }
 
-    // Multithreaded evaluate each substring
-    for (const auto& substr : substrings) {
-        futures.push_back(std::async(std::launch::async, [&json, substr]() {
-            size_t pos = 0;
+    if (value < 0) {
+        return miss(document, JsonError(JsonError::Code::IndexOutOfBounds, step.position, {}, 0 - static_cast<uint64_t>(value), true));
+    }
+    index = static_cast<size_t>(value);
+    return true;
+}
 
-            if (!substr.empty() && (std::isdigit(substr[0]) || substr[0] == '-' || substr[0] == '.')) {
-                bool hasDecimalPoint = false;
-                for (size_t i = 1; i < substr.size(); ++i) {
-                    if (!std::isdigit(substr[i])) {
-                        if (substr[i] == '.' && !hasDecimalPoint) {
-                            hasDecimalPoint = true;
-                        } else {
-                            throw std::runtime_error("More than one decimal point '.'");
-                        }
-                    }
-                }
+template <class Ref>
+bool JsonEvaluator::evaluateAggregate(const Document<Ref>& document, const CompiledExpression& expression, const Node& node,
+                                      Aggregate::Kind kind, Json& out) {
+    size_t expensive = 0;
+    for (size_t i = 0; i < node.count; ++i) {
+        if (expression.node(expression.argument(node, i)).cost >= ParallelArgumentCost) {
+            ++expensive;
+        }
+    }
 
-                return Json(std::stod(substr));
+    Aggregate result(kind);
+    if (expensive >= 2) {
+        if (!mergeArguments(document, expression, node, ThreadPool::instance(), result)) {
+            return false;
+        }
+    } else {
+        // Nothing runs on other threads, the arguments add straight to the result
+        for (size_t i = 0; i < node.count; ++i) {
+            if (!accumulateArgument(document, expression, expression.argument(node, i), result)) {
+                return false;
             }
+        }
+    }
+
+    if (result.empty() && kind != Aggregate::Kind::Sum) {
+        const char* name = kind == Aggregate::Kind::Min ? "min" : kind == Aggregate::Kind::Max ? "max" : "avg";
+        throw std::runtime_error(std::string(name) + " function requires at least one numeric value");
+    }
+    out = result.result();
+    return true;
+}
 
-            return JsonEvaluator::evaluateExpression(json, substr, pos);
-        }));
+// Expensive arguments go to the pool, the caller evaluates the rest and then helps out.
+// Every task is waited for before an error propagates, the first failing argument wins.
+// Tasks allocate from the default resource, the caller's one is only used on its own thread.
+// Each argument records its path miss in a slot of its own.
+template <class Ref>
+bool JsonEvaluator::mergeArguments(const Document<Ref>& document, const CompiledExpression& expression, const Node& node,
+                                   ThreadPool& pool, Aggregate& result) {
+    std::vector<Aggregate> partial(node.count, Aggregate(result.kind()));
+    std::vector<std::exception_ptr> errors(node.count);
+    std::vector<std::optional<JsonError>> misses(node.count);
+    std::vector<std::pair<size_t, std::future<void>>> tasks;
+    Document<Ref> shared{document.root, document.prefixes, std::pmr::get_default_resource(), document.indexes};
+
+    for (size_t i = 0; i < node.count; ++i) {
+        size_t id = expression.argument(node, i);
+        if (expression.node(id).cost >= ParallelArgumentCost) {
+            tasks.emplace_back(i, pool.submit([task = shared, &expression, id, &part = partial[i], &miss = misses[i]]() mutable {
+                task.error = &miss;
+                accumulateArgument(task, expression, id, part);
+            }));
+        }
     }
 
-    // Wait for all futures
-    results.reserve(futures.size());
-    for (auto& future : futures) {
-        Json result = future.get();
-        if (result.isArray()) {
+    Document<Ref> local = document;
+    size_t next = 0;
+    for (size_t i = 0; i < node.count; ++i) {
+        if (next < tasks.size() && tasks[next].first == i) {
+            ++next;
+            continue;
+        }
+        try {
+            local.error = &misses[i];
+            accumulateArgument(local, expression, expression.argument(node, i), partial[i]);
+        } catch (...) {
+            errors[i] = std::current_exception();
+        }
+    }
 
-            // Arrays
-            for (const auto& item : result.asArray()) {
-                if (item.isInt()) {
-                    results.push_back(static_cast<double>(item.asInt()));
-                } else if (item.isDouble()) {
-                    results.push_back(item.asDouble());
-                } else {
-                    throw std::runtime_error("Array elements must be numeric");
-                }
-            }
+    for (auto& [i, task] : tasks) {
+        try {
+            pool.wait(task);
+        } catch (...) {
+            errors[i] = std::current_exception();
+        }
+    }
 
-        }else if (result.isInt()) {
-            results.push_back(static_cast<double>(result.asInt()));
-        } else if (result.isDouble()) {
-            results.push_back(result.asDouble());
+    for (size_t i = 0; i < node.count; ++i) {
+        if (errors[i]) {
+            std::rethrow_exception(errors[i]);
+        }
+        if (misses[i]) {
+            return miss(document, std::move(*misses[i]));
+        }
+        result.merge(partial[i]);
+    }
+    return true;
+}
+
+// Number of values in the arguments, arrays count their elements; values of any type count
+template <class Ref>
+bool JsonEvaluator::evaluateCount(const Document<Ref>& document, const CompiledExpression& expression, const Node& node, Json& out) {
+    int64_t count = 0;
+    auto add = [&count](const auto& value) {
+        count += value.isArray() ? static_cast<int64_t>(value.size()) : 1;
+    };
+
+    for (size_t i = 0; i < node.count; ++i) {
+        size_t id = expression.argument(node, i);
+        bool found = expression.node(id).projection ? project(document, expression, id, add)
+                                                    : withArgument(document, expression, id, add);
+        if (!found) {
+            return false;
+        }
+    }
+    out = Json(count);
+    return true;
+}
+
+template <class Ref>
+bool JsonEvaluator::accumulateArgument(const Document<Ref>& document, const CompiledExpression& expression, size_t id, Aggregate& result) {
+    if (expression.node(id).projection) {
+        Column column(document.resource);
+        if (!project(document, expression, id, [&column](const auto& value) { gather(value, column); })) {
+            return false;
+        }
+        accumulateColumn(column, result);
+        return true;
+    }
+
+    return withArgument(document, expression, id, [&result](const auto& value) {
+        if (value.isArray()) {
+            accumulateArray(value, result);
         } else {
-            throw std::runtime_error("Expression must evaluate to a number");
+            accumulateNumber(value, result, "Expression must evaluate to a number");
         }
+    });
+}
+
+template <class Ref>
+void JsonEvaluator::accumulateArray(const Ref& array, Aggregate& result) {
+    size_t count = array.size();
+    if (array.isPackedInt() || array.isPackedDouble()) {
+        accumulatePacked(array.packedData(), count, array.isPackedInt(), result);
+        return;
+    }
+    if (count < ParallelArrayElements || !array.hasRandomAccess()) {
+        array.forEach([&result](const auto& item) {
+            accumulateNumber(item, result, "Array elements must be numeric");
+        });
+        return;
     }
 
-    if (results.empty()) {
-        throw std::runtime_error("max function requires at least one numeric value");
+    std::mutex mutex;
+    ThreadPool::instance().parallelFor(count, ParallelArrayChunk, [&](size_t begin, size_t end) {
+        Aggregate chunk(result.kind());
+        Ref item = array;
+        for (size_t i = begin; i < end; ++i) {
+            array.at(i, item);
+            accumulateNumber(item, chunk, "Array elements must be numeric");
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        result.merge(chunk);
+    });
+}
+
+void JsonEvaluator::accumulatePacked(const uint64_t* values, size_t count, bool isInt, Aggregate& result) {
+    if (count < ParallelArrayElements) {
+        result.merge(reducePacked(values, count, isInt, result.kind()));
+        return;
     }
 
-    double maxValue = *std::max_element(results.begin(), results.end());
-    return Json(maxValue);
+    std::mutex mutex;
+    ThreadPool::instance().parallelFor(count, ParallelPackedChunk, [&](size_t begin, size_t end) {
+        Aggregate part = reducePacked(values + begin, end - begin, isInt, result.kind());
+        std::lock_guard<std::mutex> lock(mutex);
+        result.merge(part);
+    });
 }
 
-Json JsonEvaluator::evaluateSize(const Json& json, const std::string& exp, size_t& pos) {
-    size_t startArg = pos;
-    int parenthesisCount = 1;
+Aggregate JsonEvaluator::reducePacked(const uint64_t* values, size_t count, bool isInt, Aggregate::Kind kind) {
+    Aggregate part(kind);
+    if (count == 0) {
+        return part;
+    }
 
-    while (pos < exp.size() && parenthesisCount > 0) {
-        if (exp[pos] == '(') {
-            ++parenthesisCount;
-        } else if (exp[pos] == ')') {
-            --parenthesisCount;
-            if (parenthesisCount == 0) {
-                break;
+    switch (kind) {
+        case Aggregate::Kind::Min:
+            if (isInt) {
+                part.addPartial(NumericKernels::minInt(values, count), count);
+            } else {
+                part.addPartial(NumericKernels::minDouble(values, count), count);
+            }
+            break;
+        case Aggregate::Kind::Max:
+            if (isInt) {
+                part.addPartial(NumericKernels::maxInt(values, count), count);
+            } else {
+                part.addPartial(NumericKernels::maxDouble(values, count), count);
+            }
+            break;
+        case Aggregate::Kind::Sum:
+        case Aggregate::Kind::Avg: {
+            int64_t sum = 0;
+            if (!isInt) {
+                part.addPartial(NumericKernels::sumDouble(values, count), count);
+            } else if (NumericKernels::sumInt(values, count, sum)) {
+                part.addPartial(sum, count);
+            } else {
+                // The int64 sum overflows, Aggregate carries on in double from the value that overflows
+                for (size_t i = 0; i < count; ++i) {
+                    part.add(static_cast<int64_t>(values[i]));
+                }
             }
+            break;
         }
-        ++pos;
+        case Aggregate::Kind::Count:
+            part.addCount(count);
+            break;
     }
+    return part;
+}
 
-    if (pos >= exp.size() || exp[pos] != ')') {
-        throw std::runtime_error("Expected closing parenthesis in size function");
+void JsonEvaluator::accumulateColumn(const Column& column, Aggregate& result) {
+    if (column.others > 0) {
+        throw std::runtime_error("Array elements must be numeric");
     }
+    accumulatePacked(column.ints.data(), column.ints.size(), true, result);
+    accumulatePacked(column.doubles.data(), column.doubles.size(), false, result);
+}
 
-    std::string argExp = exp.substr(startArg, pos - startArg);
-    ++pos;
+// A selected array contributes its elements, packed ones are copied as they are
+template <class Ref>
+void JsonEvaluator::gather(const Ref& value, Column& column) {
+    if (value.isPackedInt() || value.isPackedDouble()) {
+        auto& target = value.isPackedInt() ? column.ints : column.doubles;
+        target.insert(target.end(), value.packedData(), value.packedData() + value.size());
+    } else if (value.isArray()) {
+        value.forEach([&column](const auto& item) { gatherNumber(item, column); });
+    } else {
+        gatherNumber(value, column);
+    }
+}
 
-    Json argValue = evaluate(json, argExp);
+template <class Ref>
+void JsonEvaluator::gatherNumber(const Ref& value, Column& column) {
+    if (value.isInt()) {
+        column.ints.push_back(static_cast<uint64_t>(value.asInt()));
+    } else if (value.isDouble()) {
+        double number = value.asDouble();
+        uint64_t bits;
+        std::memcpy(&bits, &number, sizeof(bits));
+        column.doubles.push_back(bits);
+    } else {
+        ++column.others;
+    }
+}
 
-    int64_t size = 0;
-    if (argValue.isString()) {
-        size = static_cast<int64_t>(argValue.asString().length());
-    } else if (argValue.isArray()) {
-        size = static_cast<int64_t>(argValue.asArray().size());
-    } else if (argValue.isObject()) {
-        size = static_cast<int64_t>(argValue.asObject().size());
+template <class Ref>
+void JsonEvaluator::accumulateNumber(const Ref& value, Aggregate& result, const char* error) {
+    if (value.isInt()) {
+        result.add(value.asInt());
+    } else if (value.isDouble()) {
+        result.add(value.asDouble());
     } else {
-        throw std::runtime_error("size function argument must be a string, array, or object");
+        throw std::runtime_error(error);
     }
+}
 
-    return Json(size);
-}
\ No newline at end of file
+template <class Ref>
+bool JsonEvaluator::evaluateSize(const Document<Ref>& document, const CompiledExpression& expression, const Node& node, Json& out) {
+    int64_t size = 0;
+    size_t id = expression.argument(node, 0);
+    bool found = false;
+    if (expression.node(id).projection) {
+        found = project(document, expression, id, [&size](const auto&) { ++size; });
+    } else {
+        found = withArgument(document, expression, id, [&size](const auto& argValue) {
+            if (!argValue.isString() && !argValue.isArray() && !argValue.isObject()) {
+                throw std::runtime_error("size function argument must be a string, array, or object");
+            }
+            size = static_cast<int64_t>(argValue.size());
+        });
+    }
+    if (!found) {
+        return false;
+    }
+    out = Json(size);
+    return true;
+}
@@ -0,0 +1,163 @@
+// src/jsonLines.cpp
+#include "../include/json_parser/jsonLines.hpp"
+#include "../include/json_parser/jsonParser.hpp"
+#include "../include/json_parser/jsonEvaluator.hpp"
+#include "../include/json_parser/threadPool.hpp"
+
+#include <algorithm>
+#include <deque>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Everything a worker hands back for one chunk, line numbers are relative to the chunk
+struct ChunkResult {
+    std::string output;
+    std::vector<std::pair<size_t, std::string>> errors;
+    std::optional<Aggregate> aggregate;
+    size_t lines = 0;
+    size_t records = 0;
+};
+
+bool isBlank(std::string_view line) {
+    return line.find_first_not_of(" \t\r") == std::string_view::npos;
+}
+
+ChunkResult processChunk(std::string_view chunk, const CompiledExpression& expression, const JsonLines::Options& options) {
+    ChunkResult result;
+    if (options.aggregate) {
+        result.aggregate.emplace(*options.aggregate);
+    }
+    std::ostringstream out;
+    JsonWriter writer(out, options.style);
+
+    size_t start = 0;
+    while (start < chunk.size()) {
+        size_t end = std::min(chunk.find('\n', start), chunk.size());
+        std::string_view record = chunk.substr(start, end - start);
+        start = end + 1;
+        ++result.lines;
+        if (isBlank(record)) {
+            continue;
+        }
+
+        ++result.records;
+        try {
+            // Malformed records and path misses are routine here, they are reported without unwinding
+            JsonResult<JsonTape> tape = options.filter ? JsonParser::tryParseTape(record, *options.filter)
+                                                       : JsonParser::tryParseTape(record);
+            if (!tape) {
+                result.errors.emplace_back(result.lines, tape.error().message());
+                continue;
+            }
+            JsonResult<JsonRef> evaluated = JsonEvaluator::tryEvaluateRef(*tape, expression);
+            if (!evaluated) {
+                result.errors.emplace_back(result.lines, evaluated.error().message());
+                continue;
+            }
+            const JsonRef& value = *evaluated;
+            if (!result.aggregate) {
+                writer.write(value);
+                writer.writeRaw("\n");
+                continue;
+            }
+            value.visit([&result](const auto& number) {
+                if (number.isInt()) {
+                    result.aggregate->add(number.asInt());
+                } else if (number.isDouble()) {
+                    result.aggregate->add(number.asDouble());
+                } else {
+                    throw std::runtime_error("Aggregated result must be a number");
+                }
+            });
+        } catch (const std::exception& e) {
+            result.errors.emplace_back(result.lines, e.what());
+        }
+    }
+
+    writer.flush();
+    result.output = out.str();
+    return result;
+}
+
+} // namespace
+
+JsonLines::Summary JsonLines::process(std::string_view input, const CompiledExpression& expression, const Options& options,
+                                      std::ostream& out, std::ostream& err) {
+    ThreadPool& pool = ThreadPool::instance();
+    const size_t chunkBytes = std::max<size_t>(options.chunkBytes, 1);
+    const size_t maxInFlight = options.maxChunksInFlight > 0 ? options.maxChunksInFlight : 2 * pool.size();
+
+    Summary summary;
+    if (options.aggregate) {
+        summary.aggregate.emplace(*options.aggregate);
+    }
+
+    struct Pending {
+        size_t offset;
+        size_t length;
+        std::future<ChunkResult> result;
+    };
+    std::deque<Pending> pending;
+    size_t lineBase = 0;
+
+    // Chunks are written strictly in input order, the caller helps with queued work while it waits
+    auto writeFront = [&]() {
+        Pending chunk = std::move(pending.front());
+        pending.pop_front();
+        ChunkResult result = pool.wait(chunk.result);
+
+        out << result.output;
+        for (const auto& [line, message] : result.errors) {
+            err << "Error: line " << lineBase + line << ": " << message << '\n';
+        }
+        lineBase += result.lines;
+        summary.records += result.records;
+        summary.failures += result.errors.size();
+        if (summary.aggregate) {
+            summary.aggregate->merge(*result.aggregate);
+        }
+        if (options.consumed) {
+            options.consumed(chunk.offset, chunk.length);
+        }
+    };
+
+    try {
+        size_t offset = 0;
+        while (offset < input.size()) {
+            // Cut after the first newline at or beyond the chunk size, records never straddle chunks
+            size_t end = input.size();
+            if (input.size() - offset > chunkBytes) {
+                size_t newline = input.find('\n', offset + chunkBytes - 1);
+                end = newline == std::string_view::npos ? input.size() : newline + 1;
+            }
+
+            std::string_view chunk = input.substr(offset, end - offset);
+            pending.push_back(Pending{offset, chunk.size(), pool.submit([chunk, &expression, &options]() {
+                return processChunk(chunk, expression, options);
+            })});
+            offset = end;
+
+            if (pending.size() >= maxInFlight) {
+                writeFront();
+            }
+        }
+        while (!pending.empty()) {
+            writeFront();
+        }
+    } catch (...) {
+        // Tasks reference the input and the expression, none may outlive this call
+        for (auto& chunk : pending) {
+            try {
+                pool.wait(chunk.result);
+            } catch (...) {
+            }
+        }
+        throw;
+    }
+
+    return summary;
+}
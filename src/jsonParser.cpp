@@ -1,131 +1,1011 @@
 // src/jsonParser.cpp
 #include "../include/json_parser/jsonParser.hpp"
+#include "../include/json_parser/threadPool.hpp"
 
-void JsonParser::skipWhitespace(const std::string& content, size_t& pos) {
-    while (pos < content.size() && std::isspace(content[pos])) {
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iterator>
+#include <limits>
+#include <system_error>
+
+// Jumps to the next token start from stage one. Only whitespace may be skipped: anything else at
+// pos is the unmarked tail of a malformed token and is left for the caller to reject
+void JsonParser::skipWhitespace(const StructuralIndex& content, size_t& pos) {
+    char c = content.peek(pos);
+    if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+        pos = content.nextToken(pos);
+    }
+}
+
+bool JsonParser::matchLiteral(const StructuralIndex& content, size_t& pos, std::string_view literal) {
+    if (content.text().compare(pos, literal.size(), literal) != 0) {
+        return false;
+    }
+    pos += literal.size();
+    return true;
+}
+
+// Skips one value by bracket matching over the structural index: nothing is decoded, validated or allocated
+void JsonParser::skipValue(const StructuralIndex& content, size_t& pos) {
+    skipWhitespace(content, pos);
+    char c = content.peek(pos);
+
+    if (c == '{' || c == '[') {
+        size_t depth = 0;
+        while (pos < content.size()) {
+            char token = content[pos];
+            if (token == '{' || token == '[') {
+                ++depth;
+            } else if ((token == '}' || token == ']') && --depth == 0) {
+                ++pos;
+                return;
+            }
+            pos = content.nextToken(pos + 1);
+        }
+        throw std::runtime_error("Invalid JSON value: Unterminated array or object");
+    } else if (c == '"') {
+        pos = content.nextToken(pos + 1);
+        if (content.peek(pos) != '"') {
+            throw std::runtime_error("Invalid JSON value: Expected '\"' at the end of string");
+        }
         ++pos;
+    } else if (c == '\0' || c == '}' || c == ']' || c == ',' || c == ':') {
+        throw std::runtime_error("Invalid JSON value");
+    } else {
+        // Scalars end at the next token
+        pos = content.nextToken(pos + 1);
     }
 }
 
-Json JsonParser::parseValue(const std::string& content, size_t& pos) {
+Json JsonParser::parseValue(const StructuralIndex& content, size_t& pos, Scratch& scratch, Scope scope) {
     skipWhitespace(content, pos);
-    if (content[pos] == '{') {
-        return parseObject(content, pos);
-    } else if (content[pos] == '[') {
-        return parseArray(content, pos);
-    } else if (content[pos] == '"') {
-        return Json(parseString(content, pos));
-    } else if (std::isdigit(content[pos]) || content[pos] == '-') {
+    char c = content.peek(pos);
+    if (c == '{') {
+        return parseObject(content, pos, scratch, scope);
+    } else if (c == '[') {
+        return parseArray(content, pos, scratch, scope);
+    } else if (c == '"') {
+        return Json(parseString(content, pos, scratch.text), scratch.resource);
+    } else if (std::isdigit(static_cast<unsigned char>(c)) || c == '-') {
         return parseNumber(content, pos);
-    } else if (content.substr(pos, 4) == "null") {
-        pos += 4;
+    } else if (matchLiteral(content, pos, "null")) {
         return nullptr;
-    } else if (content.substr(pos, 4) == "true") {
-        pos += 4;
+    } else if (matchLiteral(content, pos, "true")) {
         return true;
-    } else if (content.substr(pos, 5) == "false") {
-        pos += 5;
+    } else if (matchLiteral(content, pos, "false")) {
         return false;
     } else {
         throw std::runtime_error("Invalid JSON value");
     }
 }
 
-Json JsonParser::parseObject(const std::string& content, size_t& pos) {
+Json JsonParser::parseObject(const StructuralIndex& content, size_t& pos, Scratch& scratch, Scope scope) {
     ++pos;
-    std::unordered_map<std::string, Json> map;
+    const bool selective = isSelective(scope);
+
+    skipWhitespace(content, pos);
+    if (content.peek(pos) == '}') {
+        ++pos;
+        return Json(JsonObject(scratch.resource));
+    }
+
+    const size_t base = scratch.members.size();
 
     while (true) {
         skipWhitespace(content, pos);
-        std::string key = parseString(content, pos);
+        bool escaped = false;
+        std::string_view raw = scanString(content, pos, escaped);
+        std::pmr::string key(scratch.resource);
+        if (escaped) {
+            unescapeString(raw, key);
+        }
 
         skipWhitespace(content, pos);
-        if (content[pos] != ':') {
+        if (content.peek(pos) != ':') {
             throw std::runtime_error("Invalid JSON value: Expected ':' after key in object");
         }
         ++pos;
 
-        Json value = parseValue(content, pos);
-        map[key] = value;
+        Scope child = nullptr;
+        if (selective) {
+            child = scope->member(escaped ? std::string_view(key) : raw);
+            if (child == nullptr) {
+                skipValue(content, pos);
+            }
+        }
+
+        if (!selective || child != nullptr) {
+            if (!escaped) {
+                key.assign(raw);
+            }
+            Json value = parseValue(content, pos, scratch, child);
+            scratch.members.emplace_back(std::move(key), std::move(value));
+        }
 
         skipWhitespace(content, pos);
-        if (content[pos] != ',') {
+        if (content.peek(pos) != ',') {
             break;
         }
         ++pos;
     }
 
-    if (content[pos] != '}') {
+    if (content.peek(pos) != '}') {
         throw std::runtime_error("Invalid JSON value: Expected '}' at end of object");
     }
     ++pos;
 
-    return Json(map);
+    // A repeated key keeps its first position and takes the last value
+    JsonObject object(scratch.resource);
+    object.reserve(scratch.members.size() - base);
+    for (auto member = scratch.members.begin() + base; member != scratch.members.end(); ++member) {
+        object.emplace(std::move(member->first), Json()) = std::move(member->second);
+    }
+    scratch.members.erase(scratch.members.begin() + base, scratch.members.end());
+    return Json(std::move(object));
 }
 
-Json JsonParser::parseArray(const std::string& content, size_t& pos) {
+Json JsonParser::parseArray(const StructuralIndex& content, size_t& pos, Scratch& scratch, Scope scope) {
     ++pos;
-    std::vector<Json> vec;
+    const bool selective = isSelective(scope);
+    size_t index = 0;
 
+    skipWhitespace(content, pos);
+    if (content.peek(pos) == ']') {
+        ++pos;
+        return Json(Json::Array(scratch.resource));
+    }
+
+    const size_t base = scratch.elements.size();
     while (true) {
         skipWhitespace(content, pos);
-        vec.push_back(parseValue(content, pos));
+        Scope child = selective ? scope->element(index) : nullptr;
+        if (!selective || child != nullptr) {
+            Json value = parseValue(content, pos, scratch, child);
+            scratch.elements.push_back(std::move(value));
+        } else {
+            // Placeholders keep the indices of later needed elements valid
+            skipValue(content, pos);
+            if (!scope->elements.empty() && index < scope->lastElement) {
+                scratch.elements.emplace_back(nullptr);
+            }
+        }
+        ++index;
 
         skipWhitespace(content, pos);
-        if (content[pos] != ',') {
+        if (content.peek(pos) != ',') {
             break;
         }
         ++pos;
     }
 
-    if (content[pos] != ']') {
+    if (content.peek(pos) != ']') {
         throw std::runtime_error("Invalid JSON value: Expected ']' at end of array");
     }
     ++pos;
 
-    return Json(vec);
+    Json::Array array(scratch.resource);
+    array.reserve(scratch.elements.size() - base);
+    std::move(scratch.elements.begin() + base, scratch.elements.end(), std::back_inserter(array));
+    scratch.elements.erase(scratch.elements.begin() + base, scratch.elements.end());
+    return Json(std::move(array));
 }
 
-std::string JsonParser::parseString(const std::string& content, size_t& pos) {
-    if (content[pos] != '"') {
+std::string_view JsonParser::parseString(const StructuralIndex& content, size_t& pos, std::string& buffer) {
+    bool escaped = false;
+    std::string_view raw = scanString(content, pos, escaped);
+    if (!escaped) {
+        return raw;
+    }
+
+    buffer.clear();
+    unescapeString(raw, buffer);
+    return buffer;
+}
+
+// Returns the characters between the quotes without decoding them, pos ends after the closing quote
+std::string_view JsonParser::scanString(const StructuralIndex& content, size_t& pos, bool& escaped) {
+    if (content.peek(pos) != '"') {
         throw std::runtime_error("Invalid JSON value: Expected '\"' at the beginning of string");
     }
 
-    ++pos;
-    std::string result;
+    // Nothing inside a string is marked, so the next token is the closing quote
+    const size_t start = pos + 1;
+    const size_t end = content.nextToken(start);
+    if (content.peek(end) != '"') {
+        throw std::runtime_error("Invalid JSON value: Expected '\"' at the end of string");
+    }
+
+    std::string_view text = content.text();
+    escaped = std::memchr(text.data() + start, '\\', end - start) != nullptr;
+    pos = end + 1;
+    return text.substr(start, end - start);
+}
+
+template <class String>
+void JsonParser::unescapeString(std::string_view raw, String& out) {
+    out.reserve(out.size() + raw.size());
+
+    auto hex4 = [&raw](size_t at) {
+        if (at + 4 > raw.size()) {
+            throw std::runtime_error("Invalid JSON value: Truncated \\u escape in string");
+        }
+        uint32_t code = 0;
+        for (size_t i = at; i < at + 4; ++i) {
+            char h = raw[i];
+            code <<= 4;
+            if (h >= '0' && h <= '9') {
+                code |= static_cast<uint32_t>(h - '0');
+            } else if (h >= 'a' && h <= 'f') {
+                code |= static_cast<uint32_t>(h - 'a' + 10);
+            } else if (h >= 'A' && h <= 'F') {
+                code |= static_cast<uint32_t>(h - 'A' + 10);
+            } else {
+                throw std::runtime_error("Invalid JSON value: Invalid \\u escape in string");
+            }
+        }
+        return code;
+    };
+
+    for (size_t i = 0; i < raw.size(); ++i) {
+        char c = raw[i];
+        if (c != '\\') {
+            out += c;
+            continue;
+        }
+
+        if (++i >= raw.size()) {
+            throw std::runtime_error("Invalid JSON value: Unterminated escape in string");
+        }
+
+        switch (raw[i]) {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                uint32_t code = hex4(i + 1);
+                i += 4;
 
-    while (pos < content.size() && content[pos] != '"') {
-        result += content[pos];
+                // Surrogate pair
+                if (code >= 0xD800 && code <= 0xDBFF && i + 2 < raw.size() && raw[i + 1] == '\\' && raw[i + 2] == 'u') {
+                    uint32_t low = hex4(i + 3);
+                    if (low >= 0xDC00 && low <= 0xDFFF) {
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                        i += 6;
+                    }
+                }
+
+                // UTF-8 encode
+                if (code < 0x80) {
+                    out += static_cast<char>(code);
+                } else if (code < 0x800) {
+                    out += static_cast<char>(0xC0 | (code >> 6));
+                    out += static_cast<char>(0x80 | (code & 0x3F));
+                } else if (code < 0x10000) {
+                    out += static_cast<char>(0xE0 | (code >> 12));
+                    out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                    out += static_cast<char>(0x80 | (code & 0x3F));
+                } else {
+                    out += static_cast<char>(0xF0 | (code >> 18));
+                    out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+                    out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                    out += static_cast<char>(0x80 | (code & 0x3F));
+                }
+                break;
+            }
+            default:
+                throw std::runtime_error("Invalid JSON value: Invalid escape sequence in string");
+        }
+    }
+}
+
+// Reads straight from the buffer following the JSON grammar:
+//  number := '-'? ('0' | [1-9][0-9]*) ('.' [0-9]+)? ([eE] [+-]? [0-9]+)?
+// Integers accumulate in uint64 with overflow detection and stay int64 when they fit; fractions,
+// exponents and integers beyond int64 are converted by std::from_chars, which rounds exactly and
+// ignores the locale
+JsonParser::Number JsonParser::scanNumber(const StructuralIndex& json, size_t& pos) {
+    const std::string_view text = json.text();
+    const size_t start = pos;
+    auto isDigit = [&text](size_t i) { return i < text.size() && static_cast<unsigned char>(text[i] - '0') < 10; };
+
+    bool negative = pos < text.size() && text[pos] == '-';
+    if (negative) {
         ++pos;
     }
+    if (!isDigit(pos)) {
+        throw std::runtime_error("Invalid JSON value: Malformed number");
+    }
 
-    if (content[pos] != '"') {
-        throw std::runtime_error("Invalid JSON value: Expected '\"' at the end of string");
+    uint64_t magnitude = 0;
+    bool overflow = false;
+    if (text[pos] == '0') {
+        ++pos;
+        if (isDigit(pos)) {
+            throw std::runtime_error("Invalid JSON value: Number has a leading zero");
+        }
+    } else {
+        for (; isDigit(pos); ++pos) {
+            uint64_t digit = static_cast<uint64_t>(text[pos] - '0');
+            overflow = overflow || magnitude > (UINT64_MAX - digit) / 10;
+            magnitude = magnitude * 10 + digit;
+        }
     }
 
-    ++pos;
+    bool isInteger = true;
+    bool negativeExponent = false;
+    if (pos < text.size() && text[pos] == '.') {
+        isInteger = false;
+        if (!isDigit(++pos)) {
+            throw std::runtime_error("Invalid JSON value: Malformed number");
+        }
+        while (isDigit(pos)) {
+            ++pos;
+        }
+        if (pos < text.size() && text[pos] == '.') {
+            throw std::runtime_error("Invalid JSON value: Number has more than one decimal point");
+        }
+    }
+    if (pos < text.size() && (text[pos] == 'e' || text[pos] == 'E')) {
+        isInteger = false;
+        ++pos;
+        if (pos < text.size() && (text[pos] == '+' || text[pos] == '-')) {
+            negativeExponent = text[pos] == '-';
+            ++pos;
+        }
+        if (!isDigit(pos)) {
+            throw std::runtime_error("Invalid JSON value: Malformed number");
+        }
+        while (isDigit(pos)) {
+            ++pos;
+        }
+    }
+
+    Number number;
+    const uint64_t limit = negative ? uint64_t(1) << 63 : uint64_t(INT64_MAX);
+    if (isInteger && !overflow && magnitude <= limit) {
+        number.isInt = true;
+        number.integer = negative ? static_cast<int64_t>(0 - magnitude) : static_cast<int64_t>(magnitude);
+        return number;
+    }
 
-    return result;
+    auto [end, error] = std::from_chars(text.data() + start, text.data() + pos, number.real);
+    if (error == std::errc::result_out_of_range && negativeExponent) {
+        // Too small for a denormal, rounds to zero
+        number.real = negative ? -0.0 : 0.0;
+    } else if (error != std::errc() || end != text.data() + pos) {
+        throw std::runtime_error("Invalid JSON value: Number out of range");
+    }
+    return number;
 }
 
-Json JsonParser::parseNumber(const std::string& json, size_t& pos) {
-    size_t start = pos;
-    bool isDouble = false;
+Json JsonParser::parseNumber(const StructuralIndex& json, size_t& pos) {
+    Number number = scanNumber(json, pos);
+    return number.isInt ? Json(number.integer) : Json(number.real);
+}
 
-    while (pos < json.size() && (std::isdigit(json[pos]) || json[pos] == '.' || json[pos] =='-')) {
-        if (json[pos] == '.') {
-            if (!isDouble) {
-                isDouble = true;
+// Tape parsing mirrors the DOM functions above but appends words instead of building nodes
+void JsonParser::parseTapeValue(const StructuralIndex& content, size_t& pos, JsonTape& tape, Scope scope) {
+    skipWhitespace(content, pos);
+    char c = content.peek(pos);
+    if (c == '{') {
+        parseTapeContainer(content, pos, tape, true, scope);
+    } else if (c == '[') {
+        parseTapeContainer(content, pos, tape, false, scope);
+    } else if (c == '"') {
+        parseTapeString(content, pos, tape);
+    } else if (std::isdigit(static_cast<unsigned char>(c)) || c == '-') {
+        Number number = scanNumber(content, pos);
+        if (number.isInt) {
+            tape.append(JsonTape::Type::Int);
+            tape.appendRaw(static_cast<uint64_t>(number.integer));
+        } else {
+            uint64_t raw;
+            std::memcpy(&raw, &number.real, sizeof(raw));
+            tape.append(JsonTape::Type::Double);
+            tape.appendRaw(raw);
+        }
+    } else if (matchLiteral(content, pos, "null")) {
+        tape.append(JsonTape::Type::Null);
+    } else if (matchLiteral(content, pos, "true")) {
+        tape.append(JsonTape::Type::True);
+    } else if (matchLiteral(content, pos, "false")) {
+        tape.append(JsonTape::Type::False);
+    } else {
+        throw std::runtime_error("Invalid JSON value");
+    }
+}
+
+void JsonParser::parseTapeContainer(const StructuralIndex& content, size_t& pos, JsonTape& tape, bool isObject, Scope scope) {
+    const bool selective = isSelective(scope);
+    const char close = isObject ? '}' : ']';
+    size_t start = tape.append(isObject ? JsonTape::Type::ObjectStart : JsonTape::Type::ArrayStart);
+    size_t count = 0;
+    bool uniform = !isObject;
+    bool allInt = !isObject;
+    bool allDouble = !isObject;
+    ++pos;
+
+    skipWhitespace(content, pos);
+    if (content.peek(pos) == close) {
+        ++pos;
+    } else {
+        size_t index = 0;
+        while (true) {
+            skipWhitespace(content, pos);
+            Scope child = nullptr;
+            bool keep = true;
+
+            if (isObject) {
+                size_t keyWord = tape.words.size();
+                size_t keyBytes = tape.strings.size();
+                parseTapeString(content, pos, tape);
+
+                skipWhitespace(content, pos);
+                if (content.peek(pos) != ':') {
+                    throw std::runtime_error("Invalid JSON value: Expected ':' after key in object");
+                }
+                ++pos;
+
+                if (selective) {
+                    child = scope->member(tape.pending(keyWord).asString());
+                    keep = child != nullptr;
+                    if (!keep) {
+                        tape.words.resize(keyWord);
+                        tape.strings.resize(keyBytes);
+                    }
+                }
+            } else if (selective) {
+                child = scope->element(index);
+                keep = child != nullptr;
+            }
+
+            if (keep) {
+                size_t before = tape.words.size();
+                parseTapeValue(content, pos, tape, child);
+                uniform = uniform && tape.words.size() - before == 2;
+                JsonTape::Type type = tape.pending(before).type();
+                allInt = allInt && type == JsonTape::Type::Int;
+                allDouble = allDouble && type == JsonTape::Type::Double;
+                ++count;
             } else {
-                throw std::runtime_error("Invalid JSON value: Number has more than one decimal point");
+                skipValue(content, pos);
+                // Placeholders keep the indices of later needed elements valid
+                if (!isObject && !scope->elements.empty() && index < scope->lastElement) {
+                    tape.append(JsonTape::Type::Null);
+                    uniform = allInt = allDouble = false;
+                    ++count;
+                }
             }
+            ++index;
+
+            skipWhitespace(content, pos);
+            if (content.peek(pos) != ',') {
+                break;
+            }
+            ++pos;
+        }
+
+        if (content.peek(pos) != close) {
+            throw std::runtime_error(isObject ? "Invalid JSON value: Expected '}' at end of object"
+                                              : "Invalid JSON value: Expected ']' at end of array");
         }
         ++pos;
     }
 
-    if (isDouble) {
-        return Json(std::stod(json.substr(start, pos - start)));
-    } else {
-        return Json(static_cast<int64_t>(std::stoi(json.substr(start, pos - start))));
+    // Homogeneous numeric arrays drop their tag words so the values sit back to back
+    uint64_t flags = uniform ? JsonTape::UniformFlag : 0;
+    if (count > 0 && (allInt || allDouble)) {
+        for (size_t i = 0; i < count; ++i) {
+            tape.words[start + 1 + i] = tape.words[start + 2 + 2 * i];
+        }
+        tape.words.resize(start + 1 + count);
+        flags = allInt ? JsonTape::PackedIntFlag : JsonTape::PackedDoubleFlag;
     }
-}
\ No newline at end of file
+
+    size_t end = tape.append(isObject ? JsonTape::Type::ObjectEnd : JsonTape::Type::ArrayEnd, count);
+    tape.patch(start, end | flags);
+    if (isObject && count > 1) {
+        mergeRepeatedKeys(tape, start);
+    }
+}
+
+// The object opening at start ends with the last word of the tape. When a key repeats, its first
+// member takes the value of the last one and the others are dropped, as Json objects do. The
+// members are found from their keys' hashes; the words are only rewritten when a key repeats
+void JsonParser::mergeRepeatedKeys(JsonTape& tape, size_t start) {
+    using Type = JsonTape::Type;
+    std::vector<uint64_t>& words = tape.words;
+    const size_t end = words.size() - 1;
+
+    // Reused by every object this thread closes; source[i] is the member whose value member i
+    // takes, Dropped for members merged into an earlier one
+    constexpr size_t Dropped = std::numeric_limits<size_t>::max();
+    thread_local std::vector<size_t> keys;
+    thread_local std::vector<size_t> source;
+    thread_local std::vector<uint32_t> slots;
+    keys.clear();
+    for (size_t w = start + 1; w < end; ) {
+        keys.push_back(w);
+        size_t value = w + 2;
+        uint64_t word = words[value];
+        switch (static_cast<Type>(word >> 56)) {
+            case Type::Int:
+            case Type::Double:
+            case Type::String:
+                w = value + 2;
+                break;
+            case Type::ArrayStart:
+            case Type::ObjectStart:
+                w = static_cast<size_t>(word & JsonTape::PayloadMask & ~JsonTape::ContainerFlags) + 1;
+                break;
+            default:
+                w = value + 1;
+                break;
+        }
+    }
+
+    const size_t count = keys.size();
+    size_t mask = 1;
+    while (mask < count * 2) {
+        mask <<= 1;
+    }
+    slots.assign(mask, 0);
+    --mask;
+    source.resize(count);
+    bool repeated = false;
+    for (size_t i = 0; i < count; ++i) {
+        std::string_view key = tape.pending(keys[i]).asString();
+        source[i] = i;
+        for (size_t slot = JsonObject::hashKey(key) & mask; ; slot = (slot + 1) & mask) {
+            if (slots[slot] == 0) {
+                slots[slot] = static_cast<uint32_t>(i + 1);
+                break;
+            }
+            size_t first = slots[slot] - 1;
+            if (tape.pending(keys[first]).asString() == key) {
+                source[first] = i;
+                source[i] = Dropped;
+                repeated = true;
+                break;
+            }
+        }
+    }
+    if (!repeated) {
+        return;
+    }
+
+    // Members are copied in order, container start words move their end index with the value
+    std::vector<uint64_t> merged;
+    merged.reserve(end - start);
+    for (size_t i = 0; i < count; ++i) {
+        if (source[i] == Dropped) {
+            continue;
+        }
+        merged.push_back(words[keys[i]]);
+        merged.push_back(words[keys[i] + 1]);
+        size_t from = keys[source[i]] + 2;
+        size_t to = source[i] + 1 < count ? keys[source[i] + 1] : end;
+        const uint64_t at = start + 1 + merged.size();
+        for (size_t w = from; w < to; ) {
+            uint64_t word = words[w];
+            uint64_t payload = word & JsonTape::PayloadMask;
+            switch (static_cast<Type>(word >> 56)) {
+                case Type::Int:
+                case Type::Double:
+                case Type::String:
+                    merged.push_back(word);
+                    merged.push_back(words[w + 1]);
+                    w += 2;
+                    break;
+                case Type::ArrayStart:
+                case Type::ObjectStart:
+                    merged.push_back(word + at - from);
+                    if (payload & (JsonTape::PackedIntFlag | JsonTape::PackedDoubleFlag)) {
+                        // Packed values carry no tags, copy them up to the end word
+                        size_t last = static_cast<size_t>(payload & ~JsonTape::ContainerFlags);
+                        merged.insert(merged.end(), words.begin() + static_cast<std::ptrdiff_t>(w + 1), words.begin() + static_cast<std::ptrdiff_t>(last));
+                        w = last;
+                    } else {
+                        w += 1;
+                    }
+                    break;
+                default:
+                    merged.push_back(word);
+                    w += 1;
+                    break;
+            }
+        }
+    }
+
+    size_t members = 0;
+    for (size_t i = 0; i < count; ++i) {
+        members += source[i] != Dropped;
+    }
+    words.resize(start + 1);
+    words.insert(words.end(), merged.begin(), merged.end());
+    tape.patch(start, tape.append(Type::ObjectEnd, members));
+}
+
+// Unescaped strings stay views into the input, only escaped ones are decoded into the string buffer
+void JsonParser::parseTapeString(const StructuralIndex& content, size_t& pos, JsonTape& tape) {
+    bool escaped = false;
+    std::string_view raw = scanString(content, pos, escaped);
+
+    if (!escaped) {
+        tape.append(JsonTape::Type::String, static_cast<uint64_t>(raw.data() - content.text().data()) | JsonTape::SourceFlag);
+        tape.appendRaw(raw.size());
+        return;
+    }
+
+    size_t offset = tape.strings.size();
+    unescapeString(raw, tape.strings);
+    tape.append(JsonTape::Type::String, offset);
+    tape.appendRaw(tape.strings.size() - offset);
+}
+
+JsonTape JsonParser::buildTape(const StructuralIndex& content, Scope scope) {
+    JsonTape tape;
+    tape.source = content.text();
+    if (scope == nullptr) {
+        tape.words.reserve(content.size() / 8 + 16);
+    }
+    size_t pos = 0;
+    located(pos, [&]() { parseTapeValue(content, pos, tape, scope); });
+    tape.seal();
+    return tape;
+}
+
+size_t JsonParser::chunkBytes() {
+    static const size_t bytes = []() {
+        const char* forced = std::getenv("JSON_EVAL_CHUNK_BYTES");
+        size_t value = forced != nullptr ? std::strtoull(forced, nullptr, 10) : 0;
+        return value > 0 ? value : DefaultChunkBytes;
+    }();
+    return bytes;
+}
+
+namespace {
+
+// Bracket depth changes over one slice of the input, relative to the depth at its start
+struct DepthScan {
+    long net = 0;
+    std::vector<size_t> commas;     // commas[k]: first comma at relative depth -k
+    std::vector<size_t> closes;     // closes[k]: first bracket that takes the depth to -(k + 1)
+};
+
+constexpr size_t None = std::numeric_limits<size_t>::max();
+
+DepthScan scanDepth(const StructuralIndex& content, size_t begin, size_t end) {
+    DepthScan scan;
+    long depth = 0;
+    for (size_t pos = content.nextToken(begin); pos < end; pos = content.nextToken(pos + 1)) {
+        char token = content[pos];
+        if (token == '{' || token == '[') {
+            ++depth;
+        } else if (token == '}' || token == ']') {
+            if (--depth < -static_cast<long>(scan.closes.size())) {
+                scan.closes.push_back(pos);
+            }
+        } else if (token == ',' && depth <= 0) {
+            size_t slot = static_cast<size_t>(-depth);
+            if (slot >= scan.commas.size()) {
+                scan.commas.resize(slot + 1, None);
+            }
+            if (scan.commas[slot] == None) {
+                scan.commas[slot] = pos;
+            }
+        }
+    }
+    scan.net = depth;
+    return scan;
+}
+
+} // namespace
+
+// Pre-scan of the container opening at open: the positions of the depth-one commas that end a
+// chunk, then the closing bracket. The input is cut into slices of one chunk, each slice is
+// scanned on the pool for its depth changes, and a prefix sum over the slices turns them into
+// absolute depths. Only the count of brackets is checked; a mismatched pair makes a chunk fail
+// to parse. Empty when the document is not worth splitting or has no closing bracket
+std::vector<size_t> JsonParser::splitElements(const StructuralIndex& content, size_t open, size_t minChunkBytes) {
+    std::vector<size_t> ends;
+    char bracket = content.peek(open);
+    size_t bytes = content.size() - std::min(open, content.size());
+    if ((bracket != '[' && bracket != '{') || bytes / 2 < minChunkBytes) {
+        return ends;
+    }
+
+    // Enough chunks to balance the pool, no smaller than minChunkBytes
+    ThreadPool& pool = ThreadPool::instance();
+    size_t target = std::max(minChunkBytes, bytes / (pool.size() * 4));
+    size_t slices = (bytes + target - 1) / target;
+    std::vector<DepthScan> scans(slices);
+    auto sliceStart = [&](size_t i) { return i == 0 ? open + 1 : open + i * target; };
+    pool.parallelFor(slices, 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            scans[i] = scanDepth(content, sliceStart(i), std::min(open + (i + 1) * target, content.size()));
+        }
+    });
+
+    // The root bracket itself opens depth one, a comma at depth one separates two of its elements
+    long depth = 1;
+    for (const DepthScan& scan : scans) {
+        if (depth < 1) {
+            break;
+        }
+        // Absolute depth one is relative depth 1 - depth, zero is -depth
+        size_t level = static_cast<size_t>(depth);
+        size_t comma = level - 1 < scan.commas.size() ? scan.commas[level - 1] : None;
+        size_t close = level - 1 < scan.closes.size() ? scan.closes[level - 1] : None;
+        if (comma < close) {
+            ends.push_back(comma);
+        }
+        if (close != None) {
+            ends.push_back(close);
+            return ends;
+        }
+        depth += scan.net;
+    }
+    ends.clear();
+    return ends;
+}
+
+// Parses the members or elements from pos up to end, the comma or bracket the pre-scan found
+// after the last of them. element() parses one of them, key included
+template <class F>
+void JsonParser::parseElements(const StructuralIndex& content, size_t& pos, size_t end, bool isObject, F&& element) {
+    while (true) {
+        skipWhitespace(content, pos);
+        if (isObject) {
+            element([&content, &pos]() {
+                skipWhitespace(content, pos);
+                if (content.peek(pos) != ':') {
+                    throw std::runtime_error("Invalid JSON value: Expected ':' after key in object");
+                }
+                ++pos;
+            });
+        } else {
+            element([]() {});
+        }
+
+        skipWhitespace(content, pos);
+        if (pos == end) {
+            return;
+        }
+        if (pos > end || content.peek(pos) != ',') {
+            throw std::runtime_error(isObject ? "Invalid JSON value: Expected '}' at end of object"
+                                              : "Invalid JSON value: Expected ']' at end of array");
+        }
+        ++pos;
+    }
+}
+
+// Runs parseChunk(i, pos) for every chunk on the pool, false when one of them failed. The chunks
+// after a failed one are skipped
+template <class F>
+bool JsonParser::parseChunks(size_t open, const std::vector<size_t>& ends, F&& parseChunk) {
+    std::atomic<size_t> firstFailure{None};
+
+    ThreadPool::instance().parallelFor(ends.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end && i < firstFailure.load(std::memory_order_relaxed); ++i) {
+            size_t pos = i == 0 ? open + 1 : ends[i - 1] + 1;
+            try {
+                parseChunk(i, pos);
+            } catch (const std::runtime_error&) {
+                size_t failed = firstFailure.load(std::memory_order_relaxed);
+                while (i < failed && !firstFailure.compare_exchange_weak(failed, i, std::memory_order_relaxed)) {
+                }
+            }
+        }
+    });
+    return firstFailure.load() == None;
+}
+
+Json JsonParser::parseParallel(std::string_view jsonString, size_t minChunkBytes) {
+    StructuralIndex content(jsonString);
+    size_t open = 0;
+    skipWhitespace(content, open);
+    std::vector<size_t> ends = splitElements(content, open, minChunkBytes);
+    if (ends.size() < 2) {
+        Scratch scratch;
+        size_t pos = 0;
+        return located(pos, [&]() { return parseValue(content, pos, scratch); });
+    }
+
+    const bool isObject = content[open] == '{';
+    std::vector<std::vector<Json>> elements(ends.size());
+    std::vector<JsonObject> members(ends.size());
+    bool parsed = content[ends.back()] == (isObject ? '}' : ']') && parseChunks(open, ends, [&](size_t i, size_t& pos) {
+        Scratch scratch;
+        parseElements(content, pos, ends[i], isObject, [&](auto&& colon) {
+            if (isObject) {
+                std::string buffer;
+                std::string_view key = parseString(content, pos, buffer);
+                colon();
+                members[i].emplace(key, Json()) = parseValue(content, pos, scratch);
+            } else {
+                elements[i].push_back(parseValue(content, pos, scratch));
+            }
+        });
+    });
+    // Malformed input is parsed again on this thread, which stops at the same byte as without splitting
+    if (!parsed) {
+        Scratch scratch;
+        size_t pos = 0;
+        return located(pos, [&]() { return parseValue(content, pos, scratch); });
+    }
+
+    // Elements are moved, not copied; a key repeated across chunks takes the last value
+    if (isObject) {
+        size_t count = 0;
+        for (const auto& chunk : members) {
+            count += chunk.size();
+        }
+        JsonObject object = std::move(members[0]);
+        object.reserve(count);
+        for (size_t i = 1; i < members.size(); ++i) {
+            for (auto& [key, value] : members[i]) {
+                object.emplace(std::move(key), Json()) = std::move(value);
+            }
+        }
+        return Json(std::move(object));
+    }
+
+    size_t count = 0;
+    for (const auto& chunk : elements) {
+        count += chunk.size();
+    }
+    Json::Array array;
+    array.reserve(count);
+    for (auto& chunk : elements) {
+        std::move(chunk.begin(), chunk.end(), std::back_inserter(array));
+    }
+    return Json(std::move(array));
+}
+
+JsonParser::Elements JsonParser::parseTapeElements(const StructuralIndex& content, size_t& pos, size_t end, JsonTape& tape, bool isObject) {
+    Elements shape;
+    shape.uniform = shape.allInt = shape.allDouble = !isObject;
+    parseElements(content, pos, end, isObject, [&](auto&& colon) {
+        if (isObject) {
+            parseTapeString(content, pos, tape);
+            colon();
+        }
+        size_t before = tape.words.size();
+        parseTapeValue(content, pos, tape);
+        auto type = static_cast<JsonTape::Type>(tape.words[before] >> 56);
+        shape.uniform = shape.uniform && tape.words.size() - before == 2;
+        shape.allInt = shape.allInt && type == JsonTape::Type::Int;
+        shape.allDouble = shape.allDouble && type == JsonTape::Type::Double;
+        ++shape.count;
+    });
+    return shape;
+}
+
+// Copies the chunk tapes behind one container start word, in parallel. Container words hold tape
+// indices and decoded strings offsets into the string buffer, both move by the chunk's base
+void JsonParser::joinTape(JsonTape& tape, std::vector<JsonTape>& chunks, const std::vector<Elements>& shapes, bool isObject) {
+    using Type = JsonTape::Type;
+
+    Elements total;
+    total.uniform = total.allInt = total.allDouble = !isObject;
+    for (const Elements& shape : shapes) {
+        total.count += shape.count;
+        total.uniform = total.uniform && shape.uniform;
+        total.allInt = total.allInt && shape.allInt;
+        total.allDouble = total.allDouble && shape.allDouble;
+    }
+    const bool packed = total.allInt || total.allDouble;
+
+    std::vector<size_t> wordBase(chunks.size());
+    std::vector<size_t> stringBase(chunks.size());
+    size_t words = 1;
+    size_t strings = 0;
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        wordBase[i] = words;
+        stringBase[i] = strings;
+        words += packed ? shapes[i].count : chunks[i].words.size();
+        strings += chunks[i].strings.size();
+    }
+
+    uint64_t flags = packed ? (total.allInt ? JsonTape::PackedIntFlag : JsonTape::PackedDoubleFlag)
+                            : (total.uniform ? JsonTape::UniformFlag : 0);
+    tape.words.resize(words + 1);
+    tape.strings.resize(strings);
+    tape.words[0] = (static_cast<uint64_t>(isObject ? Type::ObjectStart : Type::ArrayStart) << 56) | words | flags;
+    tape.words[words] = (static_cast<uint64_t>(isObject ? Type::ObjectEnd : Type::ArrayEnd) << 56) | total.count;
+
+    ThreadPool::instance().parallelFor(chunks.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const std::vector<uint64_t>& from = chunks[i].words;
+            uint64_t* to = tape.words.data() + wordBase[i];
+            std::memcpy(&tape.strings[stringBase[i]], chunks[i].strings.data(), chunks[i].strings.size());
+
+            // Every element of a packed root is a tag word followed by its raw value
+            if (packed) {
+                for (size_t k = 0; k < shapes[i].count; ++k) {
+                    to[k] = from[2 * k + 1];
+                }
+                continue;
+            }
+
+            for (size_t w = 0; w < from.size(); ) {
+                uint64_t word = from[w];
+                uint64_t payload = word & JsonTape::PayloadMask;
+                switch (static_cast<Type>(word >> 56)) {
+                    case Type::Int:
+                    case Type::Double:
+                        to[w] = word;
+                        to[w + 1] = from[w + 1];
+                        w += 2;
+                        break;
+                    case Type::String:
+                        to[w] = (payload & JsonTape::SourceFlag) ? word : word + stringBase[i];
+                        to[w + 1] = from[w + 1];
+                        w += 2;
+                        break;
+                    case Type::ArrayStart:
+                    case Type::ObjectStart: {
+                        to[w] = word + wordBase[i];
+                        if (payload & (JsonTape::PackedIntFlag | JsonTape::PackedDoubleFlag)) {
+                            // Packed values carry no tags, copy them up to the end word
+                            size_t last = static_cast<size_t>(payload & ~JsonTape::ContainerFlags);
+                            std::copy(from.begin() + static_cast<std::ptrdiff_t>(w + 1), from.begin() + static_cast<std::ptrdiff_t>(last), to + w + 1);
+                            w = last;
+                        } else {
+                            w += 1;
+                        }
+                        break;
+                    }
+                    default:
+                        to[w] = word;
+                        w += 1;
+                        break;
+                }
+            }
+        }
+    });
+}
+
+JsonTape JsonParser::parseTapeParallel(std::string_view jsonString, size_t minChunkBytes) {
+    StructuralIndex content(jsonString);
+    size_t open = 0;
+    skipWhitespace(content, open);
+    std::vector<size_t> ends = splitElements(content, open, minChunkBytes);
+    if (ends.size() < 2) {
+        return buildTape(content, nullptr);
+    }
+
+    // Every chunk builds its own words and string buffer, no state is shared while parsing
+    const bool isObject = content[open] == '{';
+    std::vector<JsonTape> chunks(ends.size());
+    std::vector<Elements> shapes(ends.size());
+    bool parsed = content[ends.back()] == (isObject ? '}' : ']') && parseChunks(open, ends, [&](size_t i, size_t& pos) {
+        chunks[i].source = jsonString;
+        chunks[i].words.reserve((ends[i] - pos) / 8 + 16);
+        shapes[i] = parseTapeElements(content, pos, ends[i], chunks[i], isObject);
+    });
+    // Malformed input is parsed again on this thread, which stops at the same byte as without splitting
+    if (!parsed) {
+        return buildTape(content, nullptr);
+    }
+
+    JsonTape tape;
+    tape.source = jsonString;
+    joinTape(tape, chunks, shapes, isObject);
+    if (isObject) {
+        mergeRepeatedKeys(tape, 0);
+    }
+    tape.seal();
+    return tape;
+}
@@ -0,0 +1,27 @@
+// src/jsonRef.cpp
+#include "../include/json_parser/jsonRef.hpp"
+#include "../include/json_parser/jsonWriter.hpp"
+
+namespace {
+
+Json copyOf(const Json& json) { return json; }
+Json copyOf(const JsonTape::Ref& ref) { return ref.toJson(); }
+
+} // namespace
+
+Json JsonRef::toJson() const& {
+    return visit([](const auto& target) { return copyOf(target); });
+}
+
+Json JsonRef::toJson() && {
+    if (auto* owned = std::get_if<Json>(&value)) {
+        return std::move(*owned);
+    }
+    return toJson();
+}
+
+std::ostream& operator<<(std::ostream& os, const JsonRef& ref) {
+    JsonWriter writer(os);
+    writer.write(ref);
+    return os;
+}
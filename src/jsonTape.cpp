@@ -0,0 +1,160 @@
+// src/jsonTape.cpp
+#include "../include/json_parser/jsonTape.hpp"
+
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+void JsonTape::Ref::corrupted() {
+    throw std::runtime_error("Corrupted tape: a link points outside the document");
+}
+
+struct JsonTape::KeyIndex {
+    // Open addressing over the key words of one object, stored relative to its start word; 0 is an
+    // empty slot. A null table marks an object looked up once
+    using Table = std::vector<uint32_t>;
+
+    std::mutex mutex;
+    std::unordered_map<size_t, std::shared_ptr<const Table>> tables;
+};
+
+bool JsonTape::Ref::find(std::string_view key, uint32_t hash, Ref& out) const {
+    std::shared_ptr<const KeyIndex::Table> table;
+    if (size() >= IndexedMembers && endIndex() - pos <= std::numeric_limits<uint32_t>::max()) {
+        std::shared_ptr<KeyIndex> index = std::atomic_load(&tape->keys);
+        if (!index) {
+            auto created = std::make_shared<KeyIndex>();
+            if (std::atomic_compare_exchange_strong(&tape->keys, &index, created)) {
+                index = std::move(created);
+            }
+        }
+
+        bool build = false;
+        {
+            std::lock_guard<std::mutex> lock(index->mutex);
+            auto found = index->tables.try_emplace(pos);
+            table = found.first->second;
+            build = !found.second && !table;
+        }
+        if (build) {
+            // Built outside the lock, the first table finished is kept. size() is the member count
+            // unless the tape is corrupted, the fill check keeps the probes finite either way
+            size_t mask = 1;
+            while (mask < size() * 2) {
+                mask <<= 1;
+            }
+            auto built = std::make_shared<KeyIndex::Table>(mask, 0);
+            --mask;
+            size_t filled = 0;
+            for (Ref item = child(); !item.isEnd(); item = item.after().after()) {
+                if (++filled * 2 > mask + 1) {
+                    corrupted();
+                }
+                size_t slot = JsonObject::hashKey(item.asString()) & mask;
+                while ((*built)[slot] != 0) {
+                    slot = (slot + 1) & mask;
+                }
+                (*built)[slot] = static_cast<uint32_t>(item.pos - pos);
+            }
+
+            std::lock_guard<std::mutex> lock(index->mutex);
+            std::shared_ptr<const KeyIndex::Table>& kept = index->tables[pos];
+            if (!kept) {
+                kept = std::move(built);
+            }
+            table = kept;
+        }
+    }
+
+    if (table) {
+        const size_t mask = table->size() - 1;
+        for (size_t slot = hash & mask; (*table)[slot] != 0; slot = (slot + 1) & mask) {
+            Ref item(tape, pos + (*table)[slot]);
+            if (item.asString() == key) {
+                out = item.after();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    for (Ref item = child(); !item.isEnd(); ) {
+        Ref value = item.after();
+        if (item.asString() == key) {
+            out = value;
+            return true;
+        }
+        item = value.after();
+    }
+    return false;
+}
+
+bool JsonTape::Ref::at(size_t index, Ref& out) const {
+    if (index >= size()) {
+        return false;
+    }
+    if (payload() & PackedIntFlag) {
+        out = Ref(tape, (pos + 1 + index) | PackedInt);
+        return true;
+    }
+    if (payload() & PackedDoubleFlag) {
+        out = Ref(tape, (pos + 1 + index) | PackedDouble);
+        return true;
+    }
+    if (payload() & UniformFlag) {
+        // size() allows for one word per element, a uniform element takes two
+        if (index >= (endIndex() - pos - 1) / 2) {
+            corrupted();
+        }
+        out = Ref(tape, pos + 1 + 2 * index);
+        return true;
+    }
+
+    Ref item = child();
+    for (size_t i = 0; i < index; ++i) {
+        if (item.isEnd()) {
+            corrupted();
+        }
+        item = item.after();
+    }
+    out = item;
+    return true;
+}
+
+Json JsonTape::Ref::toJson() const {
+    switch (type()) {
+        case Type::Null:
+            return nullptr;
+        case Type::True:
+            return true;
+        case Type::False:
+            return false;
+        case Type::Int:
+            return asInt();
+        case Type::Double:
+            return asDouble();
+        case Type::String:
+            return Json(asString());
+        case Type::ArrayStart: {
+            Json::Array vec;
+            vec.reserve(size());
+            forEach([&vec](const Ref& item) {
+                vec.push_back(item.toJson());
+            });
+            return Json(std::move(vec));
+        }
+        case Type::ObjectStart: {
+            JsonObject object;
+            object.reserve(size());
+            for (Ref item = child(); !item.isEnd(); ) {
+                Ref value = item.after();
+                object.emplace(item.asString(), value.toJson());
+                item = value.after();
+            }
+            return Json(std::move(object));
+        }
+        default:
+            throw std::runtime_error("Invalid tape position");
+    }
+}
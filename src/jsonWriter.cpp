@@ -0,0 +1,426 @@
+// src/jsonWriter.cpp
+#include "../include/json_parser/jsonWriter.hpp"
+#include "../include/json_parser/structuralIndex.hpp"
+#include "../include/json_parser/simd.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+using Kernel = StructuralIndex::Kernel;
+
+namespace {
+
+// Quotes, backslashes and control characters have to be escaped, everything else is copied
+struct EscapeTable {
+    bool needed[256] = {};
+
+    constexpr EscapeTable() {
+        for (int c = 0; c < 0x20; ++c) {
+            needed[c] = true;
+        }
+        needed[static_cast<unsigned char>('"')] = true;
+        needed[static_cast<unsigned char>('\\')] = true;
+    }
+};
+
+constexpr EscapeTable Escapes;
+
+// Short escapes of the control characters, 'u' where only \u00XX exists
+constexpr char ControlEscapes[33] = "uuuuuuuubtnufruuuuuuuuuuuuuuuuuu";
+
+size_t escapeScanScalar(const char* text, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        if (Escapes.needed[static_cast<unsigned char>(text[i])]) {
+            return i;
+        }
+    }
+    return size;
+}
+
+#if JSON_PARSER_X86
+
+unsigned countTrailingZeros(uint32_t bits) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, bits);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctz(bits));
+#endif
+}
+
+// A byte is a control character when the unsigned minimum with 0x1F leaves it unchanged
+JSON_PARSER_TARGET("sse4.2")
+size_t escapeScanSse42(const char* text, size_t size) {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1F);
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i));
+        __m128i hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+                                    _mm_cmpeq_epi8(_mm_min_epu8(chunk, control), chunk));
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(hits));
+        if (mask != 0) {
+            return i + countTrailingZeros(mask);
+        }
+    }
+    return i + escapeScanScalar(text + i, size - i);
+}
+
+JSON_PARSER_TARGET("avx2")
+size_t escapeScanAvx2(const char* text, size_t size) {
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i control = _mm256_set1_epi8(0x1F);
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + i));
+        __m256i hits = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote), _mm256_cmpeq_epi8(chunk, backslash)),
+                                       _mm256_cmpeq_epi8(_mm256_min_epu8(chunk, control), chunk));
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(hits));
+        if (mask != 0) {
+            return i + countTrailingZeros(mask);
+        }
+    }
+    return i + escapeScanScalar(text + i, size - i);
+}
+
+#endif
+
+// Position in a container being written, containers are walked without recursion
+struct DomFrame {
+    const Json* container;
+    JsonObject::const_iterator member;
+    size_t element;
+    bool first;
+};
+
+struct TapeFrame {
+    JsonTape::Ref next;
+    bool isObject;
+    bool first;
+};
+
+} // namespace
+
+size_t JsonWriter::escapeScan(const char* text, size_t size) {
+#if JSON_PARSER_X86
+    switch (StructuralIndex::activeKernel()) {
+        case Kernel::Avx2: return escapeScanAvx2(text, size);
+        case Kernel::Sse42: return escapeScanSse42(text, size);
+        default: break;
+    }
+#endif
+    return escapeScanScalar(text, size);
+}
+
+bool JsonWriter::parseStyle(std::string_view name, Style& style) {
+    if (name == "spaced") {
+        style = Style::Spaced;
+    } else if (name == "compact") {
+        style = Style::Compact;
+    } else if (name == "pretty") {
+        style = Style::Pretty;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+std::string_view JsonWriter::styleName(Style style) {
+    switch (style) {
+        case Style::Compact:
+            return "compact";
+        case Style::Pretty:
+            return "pretty";
+        default:
+            return "spaced";
+    }
+}
+
+JsonWriter::JsonWriter(int fd, Style style) : fd(fd), style(style) {
+}
+
+JsonWriter::JsonWriter(std::ostream& out, Style style) : stream(&out), style(style) {
+}
+
+JsonWriter::~JsonWriter() {
+    try {
+        flush();
+    } catch (...) {
+        // Nobody left to report to, the stream or descriptor keeps its error state
+    }
+}
+
+void JsonWriter::flush() {
+    const char* data = block.data();
+    size_t size = used;
+    used = 0;
+
+    if (stream != nullptr) {
+        if (!stream->write(data, static_cast<std::streamsize>(size))) {
+            throw std::runtime_error("Unable to write output");
+        }
+        return;
+    }
+    while (size > 0) {
+#ifdef _WIN32
+        int written = _write(fd, data, static_cast<unsigned>(std::min<size_t>(size, 1u << 30)));
+#else
+        ssize_t written = ::write(fd, data, size);
+#endif
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            throw std::runtime_error("Unable to write output");
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+}
+
+void JsonWriter::writeRaw(std::string_view text) {
+    while (!text.empty()) {
+        if (used == BlockBytes) {
+            flush();
+        }
+        size_t count = std::min(text.size(), BlockBytes - used);
+        std::memcpy(block.data() + used, text.data(), count);
+        used += count;
+        text.remove_prefix(count);
+    }
+}
+
+void JsonWriter::writeInt(int64_t value) {
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    writeRaw(std::string_view(digits, static_cast<size_t>(result.ptr - digits)));
+}
+
+void JsonWriter::writeDouble(double value) {
+    // JSON has no NaN or infinity
+    if (!std::isfinite(value)) {
+        writeRaw("null");
+        return;
+    }
+    char digits[32];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    writeRaw(std::string_view(digits, static_cast<size_t>(result.ptr - digits)));
+}
+
+void JsonWriter::writeString(std::string_view text) {
+    put('"');
+    while (!text.empty()) {
+        size_t clean = escapeScan(text.data(), text.size());
+        writeRaw(text.substr(0, clean));
+        if (clean == text.size()) {
+            break;
+        }
+
+        unsigned char c = static_cast<unsigned char>(text[clean]);
+        put('\\');
+        if (c == '"' || c == '\\') {
+            put(static_cast<char>(c));
+        } else if (ControlEscapes[c] != 'u') {
+            put(ControlEscapes[c]);
+        } else {
+            static constexpr char Hex[] = "0123456789abcdef";
+            char escape[5] = {'u', '0', '0', Hex[c >> 4], Hex[c & 0xF]};
+            writeRaw(std::string_view(escape, sizeof(escape)));
+        }
+        text.remove_prefix(clean + 1);
+    }
+    put('"');
+}
+
+void JsonWriter::writeKey(std::string_view key, bool first) {
+    item(first);
+    writeString(key);
+    colon();
+}
+
+void JsonWriter::open(char bracket) {
+    put(bracket);
+    ++depth;
+}
+
+// Goes before every member or element
+void JsonWriter::item(bool first) {
+    if (!first) {
+        put(',');
+    }
+    if (style == Style::Pretty) {
+        put('\n');
+        indent();
+    } else if (style == Style::Spaced && !first) {
+        put(' ');
+    }
+}
+
+void JsonWriter::close(char bracket, bool empty) {
+    --depth;
+    if (style == Style::Pretty && !empty) {
+        put('\n');
+        indent();
+    }
+    put(bracket);
+}
+
+void JsonWriter::colon() {
+    put(':');
+    if (style != Style::Compact) {
+        put(' ');
+    }
+}
+
+void JsonWriter::indent() {
+    for (size_t i = 0; i < depth; ++i) {
+        writeRaw("  ");
+    }
+}
+
+void JsonWriter::packed(const JsonTape::Ref& array) {
+    const uint64_t* values = array.packedData();
+    size_t count = array.size();
+    bool isInt = array.isPackedInt();
+
+    open('[');
+    for (size_t i = 0; i < count; ++i) {
+        item(i == 0);
+        if (isInt) {
+            writeInt(static_cast<int64_t>(values[i]));
+        } else {
+            double value;
+            std::memcpy(&value, &values[i], sizeof(value));
+            writeDouble(value);
+        }
+    }
+    close(']', count == 0);
+}
+
+void JsonWriter::write(const Json& root) {
+    std::vector<DomFrame> stack;
+    const Json* value = &root;
+
+    while (value != nullptr) {
+        // Non-empty containers push a frame, everything else is written whole
+        if (value->isObject() && !value->asObject().empty()) {
+            open('{');
+            stack.push_back(DomFrame{value, value->asObject().begin(), 0, true});
+        } else if (value->isArray() && !value->asArray().empty()) {
+            open('[');
+            stack.push_back(DomFrame{value, {}, 0, true});
+        } else if (value->isObject()) {
+            writeRaw("{}");
+        } else if (value->isArray()) {
+            writeRaw("[]");
+        } else if (value->isNull()) {
+            writeRaw("null");
+        } else if (value->isBool()) {
+            writeRaw(value->asBool() ? "true" : "false");
+        } else if (value->isInt()) {
+            writeInt(value->asInt());
+        } else if (value->isDouble()) {
+            writeDouble(value->asDouble());
+        } else {
+            writeString(value->asString());
+        }
+
+        // Next value: the following member or element of the innermost unfinished container
+        value = nullptr;
+        while (value == nullptr && !stack.empty()) {
+            DomFrame& frame = stack.back();
+            if (frame.container->isObject()) {
+                if (frame.member != frame.container->asObject().end()) {
+                    item(frame.first);
+                    writeString(frame.member->first);
+                    colon();
+                    value = &frame.member->second;
+                    ++frame.member;
+                    frame.first = false;
+                    continue;
+                }
+                close('}', false);
+            } else {
+                const auto& elements = frame.container->asArray();
+                if (frame.element < elements.size()) {
+                    item(frame.first);
+                    value = &elements[frame.element++];
+                    frame.first = false;
+                    continue;
+                }
+                close(']', false);
+            }
+            stack.pop_back();
+        }
+    }
+}
+
+void JsonWriter::write(const JsonRef& value) {
+    value.visit([this](const auto& target) { write(target); });
+}
+
+void JsonWriter::write(const JsonTape::Ref& root) {
+    using Type = JsonTape::Type;
+
+    std::vector<TapeFrame> stack;
+    JsonTape::Ref value = root;
+    bool pending = true;
+
+    while (pending) {
+        Type type = value.type();
+        if (value.isPackedInt() || value.isPackedDouble()) {
+            packed(value);
+        } else if ((type == Type::ObjectStart || type == Type::ArrayStart) && value.size() > 0) {
+            bool isObject = type == Type::ObjectStart;
+            open(isObject ? '{' : '[');
+            stack.push_back(TapeFrame{value.child(), isObject, true});
+        } else {
+            switch (type) {
+                case Type::Null: writeRaw("null"); break;
+                case Type::True: writeRaw("true"); break;
+                case Type::False: writeRaw("false"); break;
+                case Type::Int: writeInt(value.asInt()); break;
+                case Type::Double: writeDouble(value.asDouble()); break;
+                case Type::String: writeString(value.asString()); break;
+                case Type::ObjectStart: writeRaw("{}"); break;
+                case Type::ArrayStart: writeRaw("[]"); break;
+                default: throw std::runtime_error("Invalid tape position");
+            }
+        }
+
+        pending = false;
+        while (!pending && !stack.empty()) {
+            TapeFrame& frame = stack.back();
+            if (!frame.next.isEnd()) {
+                item(frame.first);
+                frame.first = false;
+                if (frame.isObject) {
+                    writeString(frame.next.asString());
+                    colon();
+                    value = frame.next.after();
+                } else {
+                    value = frame.next;
+                }
+                // Containers know their end, skipping the value before writing it is O(1)
+                frame.next = value.after();
+                pending = true;
+                continue;
+            }
+            close(frame.isObject ? '}' : ']', false);
+            stack.pop_back();
+        }
+    }
+}
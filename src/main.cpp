@@ -1,32 +1,364 @@
 // src/main.cpp
 #include <iostream>
+#include <filesystem>
 #include <fstream>
+#include <cstdlib>
+#include <limits>
+#include <new>
+#include <optional>
 #include <string>
+#include <vector>
 
 #include "../include/json_parser/json.hpp"
 #include "../include/json_parser/jsonParser.hpp"
 #include "../include/json_parser/jsonEvaluator.hpp"
+#include "../include/json_parser/mappedFile.hpp"
+#include "../include/json_parser/pathFilter.hpp"
+#include "../include/json_parser/jsonLines.hpp"
+#include "../include/json_parser/expressionBatch.hpp"
+#include "../include/json_parser/queryServer.hpp"
+#include "../include/json_parser/snapshot.hpp"
+#include "../include/json_parser/jsonWriter.hpp"
+#include "../include/json_parser/stats.hpp"
 
-Json callParser(const std::string& filePath);
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+#if JSON_EVAL_STATS
+// Every allocation of the process is counted for --stats
+void* operator new(size_t size) {
+    Stats::countAllocation(size);
+    if (void* block = std::malloc(size > 0 ? size : 1)) {
+        return block;
+    }
+    throw std::bad_alloc();
+}
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+void operator delete[](void* pointer) noexcept { std::free(pointer); }
+void operator delete(void* pointer, size_t) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { std::free(pointer); }
+// std::pmr::new_delete_resource and over-aligned types allocate through the aligned forms;
+// aligned_alloc wants the size rounded up to a multiple of the alignment
+void* operator new(size_t size, std::align_val_t alignment) {
+    const size_t align = static_cast<size_t>(alignment);
+    if (size > std::numeric_limits<size_t>::max() - align) {
+        throw std::bad_alloc();
+    }
+    Stats::countAllocation(size);
+    const size_t rounded = ((size > 0 ? size : 1) + align - 1) & ~(align - 1);
+#ifdef _WIN32
+    void* block = _aligned_malloc(rounded, align);
+#else
+    void* block = std::aligned_alloc(align, rounded);
+#endif
+    if (block) {
+        return block;
+    }
+    throw std::bad_alloc();
+}
+void* operator new[](size_t size, std::align_val_t alignment) { return operator new(size, alignment); }
+#ifdef _WIN32
+void operator delete(void* pointer, std::align_val_t) noexcept { _aligned_free(pointer); }
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept { _aligned_free(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { _aligned_free(pointer); }
+void operator delete[](void* pointer, size_t, std::align_val_t) noexcept { _aligned_free(pointer); }
+#else
+void operator delete(void* pointer, std::align_val_t) noexcept { std::free(pointer); }
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, size_t, std::align_val_t) noexcept { std::free(pointer); }
+#endif
+#endif
+
+namespace {
+
+// Expressions one per line from a file, or from stdin for "-"
+ExpressionBatch loadBatch(const std::string& path) {
+    if (path == "-") {
+        return ExpressionBatch::compile(std::cin);
+    }
+    std::ifstream input(path);
+    if (!input) {
+        throw std::runtime_error("Cannot open expression file: " + path);
+    }
+    return ExpressionBatch::compile(input);
+}
+
+// Forwards the query to a json_eval --serve daemon, output and exit code match a local run
+int forwardQuery(const std::string& socketPath, const std::vector<std::string>& args, JsonWriter::Style style) {
+    std::string path = std::filesystem::absolute(args[0]).string();
+    QueryServer::Response response = QueryServer::request(
+        socketPath, {"query", path, args.size() > 1 ? args[1] : "", std::string(JsonWriter::styleName(style))});
+    if (!response.ok) {
+        std::cerr << "\033[1;31m" "Error: " << response.text << "\033[0m" << std::endl;
+        return 1;
+    }
+    std::cout << response.text << std::endl;
+    return 0;
+}
+
+// Printed on stderr when main returns, after the result has been written
+struct StatsReport {
+    bool enabled;
+    bool asJson;
+
+    ~StatsReport() {
+        if (enabled) {
+            Stats::report(std::cerr, asJson);
+        }
+    }
+};
+
+} // namespace
 
 int main(int argc, char* argv[]) {
-    if (argc < 2) {
-        std::cerr << "\033[38;5;208m" << "Usage: " << argv[0] << " <file_path>" << "\033[0m" << std::endl;
+    bool selective = false;
+    bool parallel = false;
+    bool lines = false;
+    std::optional<Aggregate::Kind> aggregate;
+    std::optional<std::string> batch;
+    bool asObject = false;
+    std::optional<std::string> serve;
+    std::optional<std::string> connect;
+    bool serverStats = false;
+    bool writeSnapshot = false;
+    bool verify = false;
+    bool stats = false;
+    bool statsJson = false;
+    JsonWriter::Style style = JsonWriter::Style::Spaced;
+    QueryServer::Options serverOptions;
+    bool validArgs = true;
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--selective") {
+            selective = true;
+        } else if (arg == "--parallel") {
+            parallel = true;
+        } else if (arg == "--lines") {
+            lines = true;
+        } else if (arg == "--aggregate" && i + 1 < argc) {
+            Aggregate::Kind kind;
+            validArgs = validArgs && Aggregate::parseKind(argv[++i], kind);
+            aggregate = kind;
+        } else if (arg == "--batch" && i + 1 < argc) {
+            batch = argv[++i];
+        } else if (arg == "--json") {
+            asObject = true;
+        } else if (arg == "--serve" && i + 1 < argc) {
+            serve = argv[++i];
+        } else if (arg == "--cache" && i + 1 < argc) {
+            serverOptions.cacheCapacity = std::strtoul(argv[++i], nullptr, 10);
+            validArgs = validArgs && serverOptions.cacheCapacity > 0;
+        } else if (arg == "--connect" && i + 1 < argc) {
+            connect = argv[++i];
+        } else if (arg == "--server-stats") {
+            serverStats = true;
+        } else if (arg == "--snapshot") {
+            writeSnapshot = true;
+        } else if (arg == "--verify") {
+            verify = true;
+        } else if (arg == "--stats") {
+            stats = true;
+        } else if (arg == "--stats-json") {
+            stats = statsJson = true;
+        } else if (arg == "--compact") {
+            style = JsonWriter::Style::Compact;
+        } else if (arg == "--pretty") {
+            style = JsonWriter::Style::Pretty;
+        } else {
+            args.push_back(arg);
+        }
+    }
+
+    // NDJSON input needs an expression to run on each record, aggregating needs NDJSON input,
+    // a batch replaces the expression and does not combine with NDJSON. The server takes no
+    // document, a client forwards single queries only, with their output style but not the
+    // options of a local parse (--selective, --verify). Parallel parsing builds the whole
+    // document, NDJSON records are already processed in parallel. Statistics cover one local run
+    bool serverCommand = serve || serverStats;
+    if ((serverCommand ? !args.empty() : (args.empty() || args.size() > 2)) || (lines && args.size() != 2) ||
+        (aggregate && !lines) || (batch && (lines || args.size() != 1)) || (asObject && !batch) ||
+        (serve && (connect || serverStats)) || (serverStats && !connect) || (connect && (lines || batch || selective || verify)) ||
+        (writeSnapshot && (args.size() != 2 || lines || batch || serverCommand || connect)) ||
+        (parallel && (selective || lines || serverCommand || connect)) ||
+        (stats && (lines || serverCommand || connect)) || !validArgs) {
+        std::cerr << "\033[38;5;208m" << "Usage: " << argv[0]
+                  << " [--selective | --parallel] [--verify] [--compact | --pretty] [--stats | --stats-json] [--lines [--aggregate min|max|sum|avg|count] | --batch <file|-> [--json]]"
+                  << " [--connect <socket>] <file_path> [expression]\n"
+                  << "       " << argv[0] << " [--parallel] [--stats | --stats-json] --snapshot <json_file> <snapshot_file>\n"
+                  << "       " << argv[0] << " --serve <socket> [--cache N]\n"
+                  << "       " << argv[0] << " --connect <socket> --server-stats" << "\033[0m" << std::endl;
+        return 1;
+    }
+    if (stats && !Stats::Enabled) {
+        std::cerr << "\033[1;31m" "Error: --stats needs a build configured with -DJSON_EVAL_STATS=ON" "\033[0m" << std::endl;
         return 1;
     }
 
+    // Plain queries go to the daemon named by JSON_EVAL_SOCKET when one is listening. The daemon
+    // answers from its own parse, so options about parsing or checking the file run locally
+    const char* socketVariable = std::getenv("JSON_EVAL_SOCKET");
+    bool localOnly = serverCommand || connect || lines || batch || stats || selective || parallel || verify;
+    if (!localOnly && socketVariable != nullptr && *socketVariable != '\0') {
+        try {
+            return forwardQuery(socketVariable, args, style);
+        } catch (const std::exception&) {
+            // Not reachable, answer locally
+        }
+    }
+
+    StatsReport report{stats, statsJson};
     try {
-        Json json = callParser(argv[1]);
+        if (serve) {
+            QueryServer::serve(*serve, serverOptions);
+            return 0;
+        }
+        if (serverStats) {
+            std::cout << QueryServer::request(*connect, {"stats"}).text << std::endl;
+            return 0;
+        }
+        if (connect) {
+            return forwardQuery(*connect, args, style);
+        }
 
-        // If there is an expression evaluate it, if not just print the json
-        if (argc == 2) {
-            std::cout << json << std::endl;
+        // The file is mapped read-only, the parser works straight on the mapping
+        MappedFile file = [&args]() {
+            Stats::Scope phase(Stats::Phase::Read);
+            MappedFile mapped(args[0]);
+            Stats::addBytesRead(mapped.view().size());
+            return mapped;
+        }();
+
+        if (writeSnapshot) {
+            JsonTape tape;
+            {
+                Stats::Scope phase(Stats::Phase::Parse);
+                tape = parallel ? JsonParser::parseTapeParallel(file.view()) : JsonParser::parseTape(file.view());
+            }
+            if (stats) {
+                Stats::countNodes(tape);
+            }
+            Stats::Scope phase(Stats::Phase::Print);
+            Snapshot::write(tape, args[1]);
             return 0;
-        } else if (argc == 3) {
-            Json result = JsonEvaluator::evaluate(json, argv[2]);
-            std::cout << result << std::endl;
+        }
+
+        // A snapshot is evaluated in place without parsing, anything else is parsed into a tape,
+        // only the paths of the filter when one is given, split between the cores with --parallel
+        std::optional<Snapshot> snapshot;
+        if (Snapshot::isSnapshot(file.view())) {
+            if (lines) {
+                throw std::runtime_error("A snapshot holds a single document, it cannot be read as JSON Lines");
+            }
+            snapshot.emplace(std::move(file));
+            if (verify && !snapshot->verify()) {
+                throw std::runtime_error("Snapshot checksum mismatch");
+            }
+        } else if (verify) {
+            throw std::runtime_error("--verify checks snapshot files, " + args[0] + " is not one");
+        }
+        JsonTape parsed;
+        auto documentTape = [&](const PathFilter* filter) -> const JsonTape& {
+            const JsonTape* tape = &parsed;
+            {
+                Stats::Scope phase(Stats::Phase::Parse);
+                if (snapshot) {
+                    tape = &snapshot->tape();
+                } else if (filter) {
+                    parsed = JsonParser::parseTape(file.view(), *filter);
+                } else {
+                    parsed = parallel ? JsonParser::parseTapeParallel(file.view()) : JsonParser::parseTape(file.view());
+                }
+            }
+            if (stats) {
+                Stats::countNodes(*tape);
+            }
+            return *tape;
+        };
+
+        // Every expression of the batch against one parse, shared path prefixes are resolved once
+        if (batch) {
+            ExpressionBatch expressions = [&batch]() {
+                Stats::Scope phase(Stats::Phase::Evaluate);
+                return loadBatch(*batch);
+            }();
+
+            const JsonTape& tape = documentTape(selective ? &expressions.filter() : nullptr);
+            std::vector<ExpressionBatch::Result> results;
+            {
+                Stats::Scope phase(Stats::Phase::Evaluate);
+                results = expressions.evaluate(tape);
+            }
+            {
+                Stats::Scope phase(Stats::Phase::Print);
+                expressions.write(std::cout, results, asObject, style);
+                if (!std::cout.flush()) {
+                    throw std::runtime_error("Unable to write output");
+                }
+            }
+            for (const auto& result : results) {
+                if (!result.ok) {
+                    return 1;
+                }
+            }
             return 0;
         }
+
+        // If there is an expression evaluate it, if not just print the json
+        // The tape is written directly, without building a DOM first
+        if (args.size() == 1) {
+            const JsonTape& tape = documentTape(nullptr);
+            Stats::Scope phase(Stats::Phase::Print);
+            JsonWriter writer(JsonWriter::StandardOutput, style);
+            writer.write(tape.root());
+            writer.writeRaw("\n");
+            // The destructor would swallow a failed final write
+            writer.flush();
+            return 0;
+        }
+
+        CompiledExpression expression = [&args]() {
+            Stats::Scope phase(Stats::Phase::Evaluate);
+            return CompiledExpression::compile(args[1]);
+        }();
+
+        // One record per line, evaluated in parallel and written in order
+        if (lines) {
+            PathFilter filter = PathFilter::fromExpression(expression);
+            JsonLines::Options options;
+            options.filter = selective ? &filter : nullptr;
+            options.aggregate = aggregate;
+            options.style = style;
+            options.consumed = [&file](size_t offset, size_t length) { file.discard(offset, length); };
+
+            JsonLines::Summary summary = JsonLines::process(file.view(), expression, options, std::cout, std::cerr);
+            if (summary.aggregate) {
+                std::cout << summary.aggregate->result() << '\n';
+            }
+            if (!std::cout.flush()) {
+                throw std::runtime_error("Unable to write output");
+            }
+            return summary.failures == 0 ? 0 : 1;
+        }
+
+        // Read-only query: the tape keeps unescaped strings as views into the mapping and a path
+        // result is printed from the tape without copying it.
+        // In selective mode only the paths the expression can reach are parsed
+        PathFilter filter = PathFilter::fromExpression(expression);
+        const JsonTape& tape = documentTape(selective ? &filter : nullptr);
+        JsonRef result;
+        {
+            Stats::Scope phase(Stats::Phase::Evaluate);
+            result = JsonEvaluator::evaluateRef(tape, expression);
+        }
+        Stats::Scope phase(Stats::Phase::Print);
+        JsonWriter writer(JsonWriter::StandardOutput, style);
+        writer.write(result);
+        writer.writeRaw("\n");
+        writer.flush();
     } catch (const std::exception& e) {
         std::cerr << "\033[1;31m" "Error: " << e.what() << "\033[0m" << std::endl;
         return 1;
@@ -34,16 +366,3 @@ int main(int argc, char* argv[]) {
 
     return 0;
 }
-
-// Helper function to read a file and call JsonParser::parse
-Json callParser(const std::string& filePath) {
-    std::ifstream inputFile(filePath);
-    if (!inputFile) {
-        throw std::runtime_error("Unable to open file: " + filePath);
-    }
-
-    std::string content((std::istreambuf_iterator<char>(inputFile)), std::istreambuf_iterator<char>());
-    inputFile.close();
-
-    return JsonParser::parse(content);
-}
\ No newline at end of file
@@ -0,0 +1,194 @@
+// src/mappedFile.cpp
+#include "../include/json_parser/mappedFile.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& filePath) {
+    HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Unable to open file: " + filePath);
+    }
+    fileHandle = file;
+
+    // Pipes and consoles have no size and cannot be mapped, they are read to the end
+    LARGE_INTEGER fileSize;
+    if (GetFileType(file) != FILE_TYPE_DISK || !GetFileSizeEx(file, &fileSize)) {
+        readAll(filePath);
+        return;
+    }
+    length = static_cast<size_t>(fileSize.QuadPart);
+    if (length == 0) {
+        return;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping != nullptr) {
+        mappingHandle = mapping;
+        data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    }
+    if (data == nullptr) {
+        readAll(filePath);
+    }
+}
+
+void MappedFile::readAll(const std::string& filePath) {
+    if (mappingHandle != nullptr) {
+        CloseHandle(mappingHandle);
+        mappingHandle = nullptr;
+    }
+    char chunk[1 << 16];
+    DWORD received = 0;
+    BOOL ok;
+    while ((ok = ReadFile(static_cast<HANDLE>(fileHandle), chunk, sizeof(chunk), &received, nullptr)) && received > 0) {
+        buffer.insert(buffer.end(), chunk, chunk + received);
+    }
+    // A pipe whose writer is done reports a broken pipe instead of end of file
+    if (!ok && GetLastError() != ERROR_BROKEN_PIPE) {
+        release();
+        throw std::runtime_error("Unable to read file: " + filePath);
+    }
+    data = buffer.data();
+    length = buffer.size();
+}
+
+// Windows trims the working set of a read-only view by itself
+void MappedFile::discard(size_t, size_t) const {
+}
+
+void MappedFile::release() {
+    if (data != nullptr && buffer.empty()) {
+        UnmapViewOfFile(data);
+    }
+    buffer.clear();
+    if (mappingHandle != nullptr) {
+        CloseHandle(mappingHandle);
+    }
+    if (fileHandle != nullptr) {
+        CloseHandle(fileHandle);
+    }
+    data = nullptr;
+    length = 0;
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& filePath) {
+    int fd = open(filePath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Unable to open file: " + filePath);
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        throw std::runtime_error("Unable to read file size: " + filePath);
+    }
+    // Pipes and devices report no size and cannot be mapped, they are read to the end
+    if (!S_ISREG(info.st_mode)) {
+        readAll(fd, filePath);
+        return;
+    }
+    length = static_cast<size_t>(info.st_size);
+    if (length == 0) {
+        close(fd);
+        return;
+    }
+
+    void* mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED) {
+        length = 0;
+        readAll(fd, filePath);
+        return;
+    }
+    close(fd);
+
+    // The parser reads front to back, let the kernel read ahead aggressively
+    madvise(mapping, length, MADV_SEQUENTIAL);
+    data = static_cast<const char*>(mapping);
+}
+
+// Reads fd to its end into the buffer and closes it
+void MappedFile::readAll(int fd, const std::string& filePath) {
+    char chunk[1 << 16];
+    while (true) {
+        ssize_t received = read(fd, chunk, sizeof(chunk));
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received < 0) {
+            close(fd);
+            buffer.clear();
+            throw std::runtime_error("Unable to read file: " + filePath);
+        }
+        if (received == 0) {
+            break;
+        }
+        buffer.insert(buffer.end(), chunk, chunk + received);
+    }
+    close(fd);
+    data = buffer.data();
+    length = buffer.size();
+}
+
+void MappedFile::discard(size_t offset, size_t count) const {
+    // Only whole pages inside the range, neighbouring data may still be in use
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t begin = (offset + page - 1) / page * page;
+    size_t end = std::min(offset + count, length) / page * page;
+    if (data != nullptr && buffer.empty() && begin < end) {
+        madvise(const_cast<char*>(data) + begin, end - begin, MADV_DONTNEED);
+    }
+}
+
+void MappedFile::release() {
+    if (data != nullptr && buffer.empty()) {
+        munmap(const_cast<char*>(data), length);
+    }
+    buffer.clear();
+    data = nullptr;
+    length = 0;
+}
+
+#endif
+
+MappedFile::~MappedFile() {
+    release();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        release();
+        data = std::exchange(other.data, nullptr);
+        length = std::exchange(other.length, 0);
+        buffer = std::move(other.buffer);
+        other.buffer.clear();
+#ifdef _WIN32
+        fileHandle = std::exchange(other.fileHandle, nullptr);
+        mappingHandle = std::exchange(other.mappingHandle, nullptr);
+#endif
+    }
+    return *this;
+}
@@ -0,0 +1,340 @@
+// src/numericKernels.cpp
+#include "../include/json_parser/numericKernels.hpp"
+#include "../include/json_parser/structuralIndex.hpp"
+#include "../include/json_parser/simd.hpp"
+
+#include <cstring>
+
+using Kernel = StructuralIndex::Kernel;
+
+namespace {
+
+int64_t toInt(uint64_t word) { return static_cast<int64_t>(word); }
+
+double toDouble(uint64_t word) {
+    double d;
+    std::memcpy(&d, &word, sizeof(d));
+    return d;
+}
+
+// Adds modulo 2^64 and counts how often the running sum wrapped (+1 upwards, -1 downwards):
+// the exact total is representable exactly when the wraps cancel out. Signed overflow happens
+// when both operands have the same sign and the sum has the other one.
+void addWrapping(int64_t& sum, int64_t value, int64_t& wraps) {
+    uint64_t next = static_cast<uint64_t>(sum) + static_cast<uint64_t>(value);
+    if ((((static_cast<uint64_t>(sum) ^ next) & (static_cast<uint64_t>(value) ^ next)) >> 63) != 0) {
+        wraps += value < 0 ? -1 : 1;
+    }
+    sum = static_cast<int64_t>(next);
+}
+
+template <bool IsMax, class T>
+T pickScalar(T best, T value) {
+    if constexpr (IsMax) {
+        return value > best ? value : best;
+    } else {
+        return value < best ? value : best;
+    }
+}
+
+template <bool IsMax>
+int64_t extremeIntScalar(const uint64_t* values, size_t count, int64_t best) {
+    for (size_t i = 0; i < count; ++i) {
+        best = pickScalar<IsMax>(best, toInt(values[i]));
+    }
+    return best;
+}
+
+template <bool IsMax>
+double extremeDoubleScalar(const uint64_t* values, size_t count, double best) {
+    for (size_t i = 0; i < count; ++i) {
+        best = pickScalar<IsMax>(best, toDouble(values[i]));
+    }
+    return best;
+}
+
+void sumIntScalar(const uint64_t* values, size_t count, int64_t& sum, int64_t& wraps) {
+    for (size_t i = 0; i < count; ++i) {
+        addWrapping(sum, toInt(values[i]), wraps);
+    }
+}
+
+double sumDoubleScalar(const uint64_t* values, size_t count, double sum) {
+    for (size_t i = 0; i < count; ++i) {
+        sum += toDouble(values[i]);
+    }
+    return sum;
+}
+
+#if JSON_PARSER_X86
+
+// SSE4.2 brings the 64-bit signed compare, two values per register
+
+template <bool IsMax>
+JSON_PARSER_TARGET("sse4.2")
+__m128i pickIntSse(__m128i best, __m128i value) {
+    __m128i replace = IsMax ? _mm_cmpgt_epi64(value, best) : _mm_cmpgt_epi64(best, value);
+    return _mm_blendv_epi8(best, value, replace);
+}
+
+template <bool IsMax>
+JSON_PARSER_TARGET("sse4.2")
+int64_t extremeIntSse42(const uint64_t* values, size_t count) {
+    if (count < 4) {
+        return extremeIntScalar<IsMax>(values + 1, count - 1, toInt(values[0]));
+    }
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + 2));
+    size_t i = 4;
+    for (; i + 4 <= count; i += 4) {
+        a = pickIntSse<IsMax>(a, _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i)));
+        b = pickIntSse<IsMax>(b, _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i + 2)));
+    }
+    a = pickIntSse<IsMax>(a, b);
+
+    int64_t lanes[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), a);
+    return extremeIntScalar<IsMax>(values + i, count - i, pickScalar<IsMax>(lanes[0], lanes[1]));
+}
+
+template <bool IsMax>
+JSON_PARSER_TARGET("sse4.2")
+double extremeDoubleSse42(const uint64_t* values, size_t count) {
+    if (count < 4) {
+        return extremeDoubleScalar<IsMax>(values + 1, count - 1, toDouble(values[0]));
+    }
+    const double* data = reinterpret_cast<const double*>(values);
+    __m128d a = _mm_loadu_pd(data);
+    __m128d b = _mm_loadu_pd(data + 2);
+    size_t i = 4;
+    for (; i + 4 <= count; i += 4) {
+        if constexpr (IsMax) {
+            a = _mm_max_pd(a, _mm_loadu_pd(data + i));
+            b = _mm_max_pd(b, _mm_loadu_pd(data + i + 2));
+        } else {
+            a = _mm_min_pd(a, _mm_loadu_pd(data + i));
+            b = _mm_min_pd(b, _mm_loadu_pd(data + i + 2));
+        }
+    }
+    a = IsMax ? _mm_max_pd(a, b) : _mm_min_pd(a, b);
+
+    double lanes[2];
+    _mm_storeu_pd(lanes, a);
+    return extremeDoubleScalar<IsMax>(values + i, count - i, pickScalar<IsMax>(lanes[0], lanes[1]));
+}
+
+JSON_PARSER_TARGET("sse4.2")
+void sumIntSse42(const uint64_t* values, size_t count, int64_t& sum, int64_t& wraps) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi64x(1);
+    __m128i total = zero;
+    __m128i laneWraps = zero;
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+        __m128i next = _mm_add_epi64(total, value);
+        __m128i overflow = _mm_cmpgt_epi64(zero, _mm_and_si128(_mm_xor_si128(next, total), _mm_xor_si128(next, value)));
+        __m128i direction = _mm_or_si128(_mm_cmpgt_epi64(zero, value), one);
+        laneWraps = _mm_add_epi64(laneWraps, _mm_and_si128(overflow, direction));
+        total = next;
+    }
+
+    int64_t lanes[2];
+    int64_t lanesWrapped[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), total);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanesWrapped), laneWraps);
+    for (int lane = 0; lane < 2; ++lane) {
+        addWrapping(sum, lanes[lane], wraps);
+        wraps += lanesWrapped[lane];
+    }
+    sumIntScalar(values + i, count - i, sum, wraps);
+}
+
+JSON_PARSER_TARGET("sse4.2")
+double sumDoubleSse42(const uint64_t* values, size_t count) {
+    const double* data = reinterpret_cast<const double*>(values);
+    __m128d a = _mm_setzero_pd();
+    __m128d b = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        a = _mm_add_pd(a, _mm_loadu_pd(data + i));
+        b = _mm_add_pd(b, _mm_loadu_pd(data + i + 2));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(a, b));
+    return sumDoubleScalar(values + i, count - i, lanes[0] + lanes[1]);
+}
+
+// AVX2 doubles the width, 64-bit compares are still emulated by compare + blend
+
+template <bool IsMax>
+JSON_PARSER_TARGET("avx2")
+__m256i pickIntAvx2(__m256i best, __m256i value) {
+    __m256i replace = IsMax ? _mm256_cmpgt_epi64(value, best) : _mm256_cmpgt_epi64(best, value);
+    return _mm256_blendv_epi8(best, value, replace);
+}
+
+template <bool IsMax>
+JSON_PARSER_TARGET("avx2")
+int64_t extremeIntAvx2(const uint64_t* values, size_t count) {
+    if (count < 8) {
+        return extremeIntScalar<IsMax>(values + 1, count - 1, toInt(values[0]));
+    }
+    __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values));
+    __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + 4));
+    size_t i = 8;
+    for (; i + 8 <= count; i += 8) {
+        a = pickIntAvx2<IsMax>(a, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i)));
+        b = pickIntAvx2<IsMax>(b, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i + 4)));
+    }
+    a = pickIntAvx2<IsMax>(a, b);
+
+    int64_t lanes[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), a);
+    int64_t best = lanes[0];
+    for (int lane = 1; lane < 4; ++lane) {
+        best = pickScalar<IsMax>(best, lanes[lane]);
+    }
+    return extremeIntScalar<IsMax>(values + i, count - i, best);
+}
+
+template <bool IsMax>
+JSON_PARSER_TARGET("avx2")
+double extremeDoubleAvx2(const uint64_t* values, size_t count) {
+    if (count < 8) {
+        return extremeDoubleScalar<IsMax>(values + 1, count - 1, toDouble(values[0]));
+    }
+    const double* data = reinterpret_cast<const double*>(values);
+    __m256d a = _mm256_loadu_pd(data);
+    __m256d b = _mm256_loadu_pd(data + 4);
+    size_t i = 8;
+    for (; i + 8 <= count; i += 8) {
+        if constexpr (IsMax) {
+            a = _mm256_max_pd(a, _mm256_loadu_pd(data + i));
+            b = _mm256_max_pd(b, _mm256_loadu_pd(data + i + 4));
+        } else {
+            a = _mm256_min_pd(a, _mm256_loadu_pd(data + i));
+            b = _mm256_min_pd(b, _mm256_loadu_pd(data + i + 4));
+        }
+    }
+    a = IsMax ? _mm256_max_pd(a, b) : _mm256_min_pd(a, b);
+
+    double lanes[4];
+    _mm256_storeu_pd(lanes, a);
+    double best = lanes[0];
+    for (int lane = 1; lane < 4; ++lane) {
+        best = pickScalar<IsMax>(best, lanes[lane]);
+    }
+    return extremeDoubleScalar<IsMax>(values + i, count - i, best);
+}
+
+JSON_PARSER_TARGET("avx2")
+void sumIntAvx2(const uint64_t* values, size_t count, int64_t& sum, int64_t& wraps) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi64x(1);
+    __m256i total = zero;
+    __m256i laneWraps = zero;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+        __m256i next = _mm256_add_epi64(total, value);
+        __m256i overflow = _mm256_cmpgt_epi64(zero, _mm256_and_si256(_mm256_xor_si256(next, total), _mm256_xor_si256(next, value)));
+        __m256i direction = _mm256_or_si256(_mm256_cmpgt_epi64(zero, value), one);
+        laneWraps = _mm256_add_epi64(laneWraps, _mm256_and_si256(overflow, direction));
+        total = next;
+    }
+
+    int64_t lanes[4];
+    int64_t lanesWrapped[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), total);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanesWrapped), laneWraps);
+    for (int lane = 0; lane < 4; ++lane) {
+        addWrapping(sum, lanes[lane], wraps);
+        wraps += lanesWrapped[lane];
+    }
+    sumIntScalar(values + i, count - i, sum, wraps);
+}
+
+JSON_PARSER_TARGET("avx2")
+double sumDoubleAvx2(const uint64_t* values, size_t count) {
+    const double* data = reinterpret_cast<const double*>(values);
+    __m256d a = _mm256_setzero_pd();
+    __m256d b = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        a = _mm256_add_pd(a, _mm256_loadu_pd(data + i));
+        b = _mm256_add_pd(b, _mm256_loadu_pd(data + i + 4));
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, _mm256_add_pd(a, b));
+    return sumDoubleScalar(values + i, count - i, (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]));
+}
+
+#endif
+
+template <bool IsMax>
+int64_t extremeInt(const uint64_t* values, size_t count) {
+#if JSON_PARSER_X86
+    switch (StructuralIndex::activeKernel()) {
+        case Kernel::Avx2: return extremeIntAvx2<IsMax>(values, count);
+        case Kernel::Sse42: return extremeIntSse42<IsMax>(values, count);
+        default: break;
+    }
+#endif
+    return extremeIntScalar<IsMax>(values + 1, count - 1, toInt(values[0]));
+}
+
+template <bool IsMax>
+double extremeDouble(const uint64_t* values, size_t count) {
+#if JSON_PARSER_X86
+    switch (StructuralIndex::activeKernel()) {
+        case Kernel::Avx2: return extremeDoubleAvx2<IsMax>(values, count);
+        case Kernel::Sse42: return extremeDoubleSse42<IsMax>(values, count);
+        default: break;
+    }
+#endif
+    return extremeDoubleScalar<IsMax>(values + 1, count - 1, toDouble(values[0]));
+}
+
+} // namespace
+
+int64_t NumericKernels::minInt(const uint64_t* values, size_t count) {
+    return extremeInt<false>(values, count);
+}
+
+int64_t NumericKernels::maxInt(const uint64_t* values, size_t count) {
+    return extremeInt<true>(values, count);
+}
+
+double NumericKernels::minDouble(const uint64_t* values, size_t count) {
+    return extremeDouble<false>(values, count);
+}
+
+double NumericKernels::maxDouble(const uint64_t* values, size_t count) {
+    return extremeDouble<true>(values, count);
+}
+
+bool NumericKernels::sumInt(const uint64_t* values, size_t count, int64_t& sum) {
+    int64_t wraps = 0;
+    sum = 0;
+#if JSON_PARSER_X86
+    switch (StructuralIndex::activeKernel()) {
+        case Kernel::Avx2: sumIntAvx2(values, count, sum, wraps); return wraps == 0;
+        case Kernel::Sse42: sumIntSse42(values, count, sum, wraps); return wraps == 0;
+        default: break;
+    }
+#endif
+    sumIntScalar(values, count, sum, wraps);
+    return wraps == 0;
+}
+
+double NumericKernels::sumDouble(const uint64_t* values, size_t count) {
+#if JSON_PARSER_X86
+    switch (StructuralIndex::activeKernel()) {
+        case Kernel::Avx2: return sumDoubleAvx2(values, count);
+        case Kernel::Sse42: return sumDoubleSse42(values, count);
+        default: break;
+    }
+#endif
+    return sumDoubleScalar(values, count, 0.0);
+}
@@ -0,0 +1,120 @@
+// src/pathFilter.cpp
+#include "../include/json_parser/pathFilter.hpp"
+
+#include <algorithm>
+
+using NodeType = CompiledExpression::NodeType;
+using StepType = CompiledExpression::StepType;
+
+PathFilter PathFilter::fromExpression(const CompiledExpression& expression) {
+    PathFilter filter;
+    filter.add(expression);
+    return filter;
+}
+
+void PathFilter::add(const CompiledExpression& expression) {
+    // Every path node counts, including the ones nested inside subscripts and function arguments
+    for (size_t id = 0; id < expression.nodeCount(); ++id) {
+        const auto& node = expression.node(id);
+        if (node.type != NodeType::Path) {
+            continue;
+        }
+
+        Node* current = &nodes.front();
+        for (size_t i = 0; i < node.count; ++i) {
+            const auto& step = expression.step(node.first + i);
+            if (step.type == StepType::Key) {
+                current = child(current, step.key);
+            } else if (step.type == StepType::Index) {
+                current = child(current, step.value);
+            } else if (step.type == StepType::Slice) {
+                current = everyElement(current);
+            } else if (step.type == StepType::Filter) {
+                current = everyElement(current);
+                addFields(current, expression, step.value);
+            } else {
+                // Any element may be selected, materialize the whole indexed array
+                break;
+            }
+        }
+        current->full = true;
+    }
+}
+
+// Every field the predicate compares is needed whole in every element
+void PathFilter::addFields(Node* element, const CompiledExpression& expression, size_t id) {
+    using PredicateType = CompiledExpression::PredicateType;
+    const auto& predicate = expression.predicate(id);
+    if (predicate.type == PredicateType::Or || predicate.type == PredicateType::And || predicate.type == PredicateType::Not) {
+        addFields(element, expression, predicate.left);
+        if (predicate.type != PredicateType::Not) {
+            addFields(element, expression, predicate.right);
+        }
+        return;
+    }
+
+    size_t operands[] = {predicate.left, predicate.right};
+    for (size_t i = 0; i < (predicate.type == PredicateType::Compare ? 2u : 1u); ++i) {
+        const auto& operand = expression.operand(operands[i]);
+        if (!operand.isField) {
+            continue;
+        }
+        Node* current = element;
+        for (size_t s = 0; s < operand.count; ++s) {
+            const auto& step = expression.step(operand.first + s);
+            current = step.type == StepType::Key ? child(current, step.key) : child(current, step.value);
+        }
+        current->full = true;
+    }
+}
+
+PathFilter::Node* PathFilter::child(Node* parent, const std::string& key) {
+    if (const Node* existing = parent->member(key)) {
+        return const_cast<Node*>(existing);
+    }
+
+    Node* node = &nodes.emplace_back();
+    parent->members.emplace_back(key, node);
+    return node;
+}
+
+PathFilter::Node* PathFilter::child(Node* parent, size_t index) {
+    // Once every element is needed, an index only adds to what each of them keeps
+    if (const Node* existing = parent->element(index)) {
+        return const_cast<Node*>(existing);
+    }
+
+    Node* node = &nodes.emplace_back();
+    parent->elements.emplace_back(index, node);
+    parent->lastElement = std::max(parent->lastElement, index);
+    return node;
+}
+
+PathFilter::Node* PathFilter::everyElement(Node* parent) {
+    if (parent->allElements != nullptr) {
+        return const_cast<Node*>(parent->allElements);
+    }
+
+    Node* node = &nodes.emplace_back();
+    parent->allElements = node;
+    // Paths through single elements now apply to all of them
+    for (const auto& [index, existing] : parent->elements) {
+        merge(node, existing);
+    }
+    parent->elements.clear();
+    parent->lastElement = 0;
+    return node;
+}
+
+void PathFilter::merge(Node* target, const Node* source) {
+    target->full = target->full || source->full;
+    for (const auto& [key, member] : source->members) {
+        merge(child(target, key), member);
+    }
+    if (source->allElements != nullptr) {
+        merge(everyElement(target), source->allElements);
+    }
+    for (const auto& [index, element] : source->elements) {
+        merge(child(target, index), element);
+    }
+}
@@ -0,0 +1,472 @@
+// src/queryServer.cpp
+#include "../include/json_parser/queryServer.hpp"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+
+void QueryServer::serve(const std::string&, const Options&) {
+    throw std::runtime_error("Query server requires Unix domain sockets");
+}
+
+QueryServer::Response QueryServer::request(const std::string&, const std::vector<std::string>&) {
+    throw std::runtime_error("Query server requires Unix domain sockets");
+}
+
+#else
+
+#include "../include/json_parser/documentCache.hpp"
+#include "../include/json_parser/jsonEvaluator.hpp"
+#include "../include/json_parser/jsonWriter.hpp"
+#include "../include/json_parser/threadPool.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr uint32_t MaxRequestField = uint32_t(1) << 20;
+constexpr uint32_t MaxFields = 16;
+constexpr int ClientTimeoutSeconds = 5;
+constexpr int PollMilliseconds = 100;
+constexpr size_t ReadBytes = size_t(1) << 16;
+
+volatile std::sig_atomic_t stopRequested = 0;
+
+void requestStop(int) {
+    stopRequested = 1;
+}
+
+void appendLength(std::string& out, uint32_t length) {
+    out.push_back(static_cast<char>(length >> 24));
+    out.push_back(static_cast<char>(length >> 16));
+    out.push_back(static_cast<char>(length >> 8));
+    out.push_back(static_cast<char>(length));
+}
+
+void appendField(std::string& out, const std::string& text) {
+    appendLength(out, static_cast<uint32_t>(text.size()));
+    out += text;
+}
+
+uint32_t decodeLength(const unsigned char* bytes) {
+    return (uint32_t(bytes[0]) << 24) | (uint32_t(bytes[1]) << 16) | (uint32_t(bytes[2]) << 8) | uint32_t(bytes[3]);
+}
+
+/**
+ * @class Socket
+ * @brief Owns a socket descriptor and reads/writes length-prefixed fields on it
+ */
+class Socket {
+public:
+    explicit Socket(int fd) : fd(fd) {}
+    ~Socket() {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    Socket(const Socket&) = delete;
+    Socket& operator=(const Socket&) = delete;
+
+    int get() const { return fd; }
+
+    void writeField(const std::string& text) {
+        std::string framed;
+        appendField(framed, text);
+        writeAll(framed.data(), framed.size());
+    }
+
+    void writeLength(uint32_t length) {
+        std::string framed;
+        appendLength(framed, length);
+        writeAll(framed.data(), framed.size());
+    }
+
+    std::string readField(uint32_t maxLength) {
+        uint32_t length = readLength();
+        if (length > maxLength) {
+            throw std::runtime_error("Query field too long");
+        }
+        std::string text(length, '\0');
+        readAll(text.data(), length);
+        return text;
+    }
+
+    uint32_t readLength() {
+        unsigned char bytes[4];
+        readAll(bytes, sizeof(bytes));
+        return decodeLength(bytes);
+    }
+
+private:
+    int fd;
+
+    void writeAll(const void* data, size_t size) {
+        const char* bytes = static_cast<const char*>(data);
+        while (size > 0) {
+            ssize_t written = send(fd, bytes, size, 0);
+            if (written < 0 && errno == EINTR) {
+                continue;
+            }
+            if (written <= 0) {
+                throw std::runtime_error("Query connection closed while writing");
+            }
+            bytes += written;
+            size -= static_cast<size_t>(written);
+        }
+    }
+
+    void readAll(void* data, size_t size) {
+        char* bytes = static_cast<char*>(data);
+        while (size > 0) {
+            ssize_t received = recv(fd, bytes, size, 0);
+            if (received < 0 && errno == EINTR) {
+                continue;
+            }
+            if (received <= 0) {
+                throw std::runtime_error("Query connection closed while reading");
+            }
+            bytes += received;
+            size -= static_cast<size_t>(received);
+        }
+    }
+};
+
+sockaddr_un socketAddress(const std::string& socketPath) {
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("Socket path too long: " + socketPath);
+    }
+    std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+    return address;
+}
+
+void setNonBlocking(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+// The fields of the request framed at the start of bytes, false while some of them are still to come
+bool parseRequest(const std::string& bytes, std::vector<std::string>& fields) {
+    auto lengthAt = [&bytes](size_t at) { return decodeLength(reinterpret_cast<const unsigned char*>(bytes.data() + at)); };
+    if (bytes.size() < 4) {
+        return false;
+    }
+    uint32_t count = lengthAt(0);
+    if (count == 0 || count > MaxFields) {
+        throw std::runtime_error("Malformed query request");
+    }
+
+    size_t at = 4;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (bytes.size() < at + 4) {
+            return false;
+        }
+        uint32_t length = lengthAt(at);
+        if (length > MaxRequestField) {
+            throw std::runtime_error("Query field too long");
+        }
+        at += 4;
+        if (bytes.size() < at + length) {
+            return false;
+        }
+        at += length;
+    }
+
+    fields.clear();
+    for (at = 4; fields.size() < count; at += 4 + fields.back().size()) {
+        fields.push_back(bytes.substr(at + 4, lengthAt(at)));
+    }
+    return true;
+}
+
+// Shared with every answer computed on the pool, so none outlives what it uses; the pool may
+// still finish an answer after serve() returned. Finished answers are handed back to the IO thread,
+// which a byte written to the wake-up pipe gets out of poll()
+struct ServerState {
+    explicit ServerState(size_t capacity) : cache(capacity) {
+        if (pipe(wake) != 0) {
+            throw std::runtime_error("Unable to create the server's wake-up pipe");
+        }
+        setNonBlocking(wake[0]);
+        setNonBlocking(wake[1]);
+    }
+    ~ServerState() {
+        close(wake[0]);
+        close(wake[1]);
+    }
+
+    ServerState(const ServerState&) = delete;
+    ServerState& operator=(const ServerState&) = delete;
+
+    DocumentCache cache;
+    int wake[2];        // Read end polled by the IO thread, write end for the pool
+    std::mutex mutex;
+    std::vector<std::pair<int, std::string>> finished;     // Connection descriptor, framed response
+
+    void finish(int fd, std::string response) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            finished.emplace_back(fd, std::move(response));
+        }
+        // A full pipe already holds a wake-up
+        char byte = 0;
+        ssize_t ignored = write(wake[1], &byte, 1);
+        (void)ignored;
+    }
+};
+
+// A connection the IO thread serves: its request is read, answered on the pool, and the response
+// written back. Descriptors stay open while answering, so they identify their connection
+struct Connection {
+    explicit Connection(int fd) : socket(fd) {}
+
+    Socket socket;
+    std::string input;
+    std::string output;
+    size_t written = 0;
+    bool answering = false;
+    std::chrono::steady_clock::time_point deadline;
+};
+
+std::string answer(const std::vector<std::string>& fields, DocumentCache& cache) {
+    std::ostringstream text;
+    if ((fields.size() == 3 || fields.size() == 4) && fields[0] == "query") {
+        JsonWriter::Style style = JsonWriter::Style::Spaced;
+        if (fields.size() == 4 && !JsonWriter::parseStyle(fields[3], style)) {
+            throw std::runtime_error("Unknown output style: " + fields[3]);
+        }
+        auto document = cache.get(fields[1]);
+        JsonWriter writer(text, style);
+        if (fields[2].empty()) {
+            writer.write(document->tape().root());
+        } else {
+            writer.write(JsonEvaluator::evaluateRef(document->tape(), CompiledExpression::compile(fields[2]), document->indexes));
+        }
+    } else if (fields.size() == 1 && fields[0] == "stats") {
+        DocumentCache::Stats stats = cache.stats();
+        text << "{\"hits\": " << stats.hits << ", \"misses\": " << stats.misses << ", \"evictions\": " << stats.evictions
+             << ", \"documents\": " << stats.documents << "}";
+    } else {
+        throw std::runtime_error("Unknown query request");
+    }
+    return text.str();
+}
+
+// Reads what the client sent, true while the connection is still wanted. A complete request is
+// answered on the pool
+bool readRequest(Connection& connection, const std::shared_ptr<ServerState>& state) {
+    char buffer[ReadBytes];
+    ssize_t received = recv(connection.socket.get(), buffer, sizeof(buffer), 0);
+    if (received < 0) {
+        return errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+    if (received == 0) {
+        return false;
+    }
+    connection.input.append(buffer, static_cast<size_t>(received));
+
+    std::vector<std::string> fields;
+    try {
+        if (!parseRequest(connection.input, fields)) {
+            return true;
+        }
+    } catch (const std::exception&) {
+        // Garbage, nobody is left to tell
+        return false;
+    }
+
+    connection.answering = true;
+    connection.input.clear();
+    ThreadPool::instance().submit([state, fd = connection.socket.get(), fields = std::move(fields)]() {
+        std::string status = "ok";
+        std::string text;
+        try {
+            text = answer(fields, state->cache);
+        } catch (const std::exception& e) {
+            status = "error";
+            text = e.what();
+        }
+        std::string response;
+        appendField(response, status);
+        appendField(response, text);
+        state->finish(fd, std::move(response));
+    });
+    return true;
+}
+
+// Writes what the socket takes of the response, true until it is all written
+bool writeResponse(Connection& connection) {
+    ssize_t sent = send(connection.socket.get(), connection.output.data() + connection.written,
+                        connection.output.size() - connection.written, 0);
+    if (sent < 0) {
+        return errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+    connection.written += static_cast<size_t>(sent);
+    return connection.written < connection.output.size();
+}
+
+} // namespace
+
+void QueryServer::serve(const std::string& socketPath, const Options& options) {
+    using Clock = std::chrono::steady_clock;
+    sockaddr_un address = socketAddress(socketPath);
+
+    // A socket left behind by a killed server is replaced, any other file is not
+    struct stat info;
+    if (lstat(socketPath.c_str(), &info) == 0) {
+        if (!S_ISSOCK(info.st_mode)) {
+            throw std::runtime_error("Socket path exists and is not a socket: " + socketPath);
+        }
+        unlink(socketPath.c_str());
+    }
+
+    Socket listener(socket(AF_UNIX, SOCK_STREAM, 0));
+    if (listener.get() < 0) {
+        throw std::runtime_error("Unable to create socket");
+    }
+    if (bind(listener.get(), reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(listener.get(), SOMAXCONN) != 0) {
+        throw std::runtime_error("Unable to listen on socket: " + socketPath);
+    }
+    setNonBlocking(listener.get());
+
+    // Workers start with the stop signals blocked, so they interrupt poll() on this thread.
+    // Without SA_RESTART the blocked poll() returns EINTR and the loop can stop
+    sigset_t stopSignals;
+    sigemptyset(&stopSignals);
+    sigaddset(&stopSignals, SIGINT);
+    sigaddset(&stopSignals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stopSignals, nullptr);
+    ThreadPool::instance();
+    pthread_sigmask(SIG_UNBLOCK, &stopSignals, nullptr);
+
+    struct sigaction action;
+    std::memset(&action, 0, sizeof(action));
+    action.sa_handler = requestStop;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+
+    // This thread accepts and does all socket IO without blocking; a stalled client only costs
+    // its connection, never a worker. Once stopped, the answers being computed are still delivered
+    auto state = std::make_shared<ServerState>(options.cacheCapacity);
+    std::unordered_map<int, std::unique_ptr<Connection>> connections;
+    std::vector<pollfd> polled;
+    bool accepting = true;
+    while (accepting || !connections.empty()) {
+        Clock::time_point now = Clock::now();
+        if (stopRequested && accepting) {
+            accepting = false;
+            unlink(socketPath.c_str());
+        }
+        for (auto it = connections.begin(); it != connections.end(); ) {
+            const Connection& connection = *it->second;
+            bool reading = !connection.answering && connection.output.empty();
+            bool expired = !connection.answering && now >= connection.deadline;
+            it = expired || (reading && !accepting) ? connections.erase(it) : std::next(it);
+        }
+
+        polled.clear();
+        polled.push_back({state->wake[0], POLLIN, 0});
+        polled.push_back({accepting ? listener.get() : -1, POLLIN, 0});
+        for (const auto& [fd, connection] : connections) {
+            if (!connection->answering) {
+                polled.push_back({fd, static_cast<short>(connection->output.empty() ? POLLIN : POLLOUT), 0});
+            }
+        }
+        if (poll(polled.data(), polled.size(), PollMilliseconds) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        now = Clock::now();
+
+        if (polled[0].revents != 0) {
+            char drain[64];
+            while (read(state->wake[0], drain, sizeof(drain)) > 0) {
+            }
+            std::vector<std::pair<int, std::string>> finished;
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                finished.swap(state->finished);
+            }
+            for (auto& [fd, response] : finished) {
+                Connection& connection = *connections.at(fd);
+                connection.answering = false;
+                connection.output = std::move(response);
+                connection.deadline = now + std::chrono::seconds(ClientTimeoutSeconds);
+            }
+        }
+
+        if (polled[1].revents != 0) {
+            int fd;
+            while ((fd = accept(listener.get(), nullptr, nullptr)) >= 0) {
+                setNonBlocking(fd);
+                auto connection = std::make_unique<Connection>(fd);
+                connection->deadline = now + std::chrono::seconds(ClientTimeoutSeconds);
+                connections.emplace(fd, std::move(connection));
+            }
+        }
+
+        // Accepted descriptors are all new, the ones polled below are still open
+        for (size_t i = 2; i < polled.size(); ++i) {
+            if (polled[i].revents == 0) {
+                continue;
+            }
+            auto it = connections.find(polled[i].fd);
+            Connection& connection = *it->second;
+            bool open = connection.output.empty() ? readRequest(connection, state) : writeResponse(connection);
+            if (!open) {
+                connections.erase(it);
+            }
+        }
+    }
+
+    if (accepting) {
+        unlink(socketPath.c_str());
+    }
+}
+
+QueryServer::Response QueryServer::request(const std::string& socketPath, const std::vector<std::string>& fields) {
+    sockaddr_un address = socketAddress(socketPath);
+
+    Socket connection(socket(AF_UNIX, SOCK_STREAM, 0));
+    if (connection.get() < 0 ||
+        connect(connection.get(), reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        throw std::runtime_error("Unable to connect to query server: " + socketPath);
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    connection.writeLength(static_cast<uint32_t>(fields.size()));
+    for (const auto& field : fields) {
+        connection.writeField(field);
+    }
+
+    Response response;
+    response.ok = connection.readField(MaxRequestField) == "ok";
+    response.text = connection.readField(UINT32_MAX);
+    return response;
+}
+
+#endif
@@ -0,0 +1,152 @@
+// src/snapshot.cpp
+#include "../include/json_parser/snapshot.hpp"
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+namespace {
+
+constexpr char Magic[8] = {'J', 'S', 'O', 'N', 'S', 'N', 'A', 'P'};
+constexpr uint32_t ByteOrderMark = 0x01020304;
+
+// 64-bit multiplicative hash, eight bytes per step
+uint64_t checksum(const char* bytes, size_t size, uint64_t hash = 0x243F6A8885A308D3ull) {
+    auto mix = [&hash](uint64_t word) {
+        hash = (hash ^ word) * 0x9E3779B97F4A7C15ull;
+        hash ^= hash >> 29;
+    };
+
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, bytes + i, sizeof(word));
+        mix(word);
+    }
+    uint64_t tail = 0;
+    std::memcpy(&tail, bytes + i, size - i);
+    mix(tail ^ (static_cast<uint64_t>(size) << 56));
+    return hash;
+}
+
+} // namespace
+
+void Snapshot::write(const JsonTape& tape, const std::string& path) {
+    using Type = JsonTape::Type;
+
+    // Every string is moved into the dictionary, the copied string words point into it
+    std::vector<uint64_t> words(tape.data, tape.data + tape.count);
+    std::string strings;
+    std::unordered_map<std::string_view, uint64_t> dictionary;
+
+    for (size_t i = 0; i < words.size(); ) {
+        auto type = static_cast<Type>(words[i] >> 56);
+        uint64_t payload = words[i] & JsonTape::PayloadMask;
+        switch (type) {
+            case Type::Int:
+            case Type::Double:
+                i += 2;
+                break;
+            case Type::String: {
+                std::string_view text = JsonTape::Ref(&tape, i).asString();
+                auto [it, added] = dictionary.emplace(text, strings.size());
+                if (added) {
+                    strings.append(text);
+                }
+                words[i] = (static_cast<uint64_t>(Type::String) << 56) | JsonTape::SourceFlag | it->second;
+                i += 2;
+                break;
+            }
+            case Type::ArrayStart:
+                // Packed values carry no tags, continue at the end word
+                i = (payload & (JsonTape::PackedIntFlag | JsonTape::PackedDoubleFlag))
+                    ? static_cast<size_t>(payload & ~JsonTape::ContainerFlags) : i + 1;
+                break;
+            default:
+                i += 1;
+                break;
+        }
+    }
+
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = Version;
+    header.byteOrder = ByteOrderMark;
+    header.wordCount = words.size();
+    header.stringBytes = strings.size();
+    header.payloadChecksum = checksum(strings.data(), strings.size(),
+                                      checksum(reinterpret_cast<const char*>(words.data()), words.size() * sizeof(uint64_t)));
+    header.sourceBytes = tape.source.size();
+    header.headerChecksum = checksum(reinterpret_cast<const char*>(&header), offsetof(Header, headerChecksum));
+
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(words.data()), static_cast<std::streamsize>(words.size() * sizeof(uint64_t)));
+        out.write(strings.data(), static_cast<std::streamsize>(strings.size()));
+        if (!out.flush()) {
+            std::remove(temporary.c_str());
+            throw std::runtime_error("Unable to write snapshot: " + path);
+        }
+    }
+    // The rename replaces an existing snapshot atomically, readers see the old or the new one
+#ifdef _WIN32
+    bool renamed = MoveFileExA(temporary.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    bool renamed = std::rename(temporary.c_str(), path.c_str()) == 0;
+#endif
+    if (!renamed) {
+        std::remove(temporary.c_str());
+        throw std::runtime_error("Unable to write snapshot: " + path);
+    }
+}
+
+bool Snapshot::isSnapshot(std::string_view bytes) {
+    return bytes.size() >= sizeof(Header) && std::memcmp(bytes.data(), Magic, sizeof(Magic)) == 0;
+}
+
+Snapshot::Snapshot(MappedFile mapped) : file(std::move(mapped)) {
+    if (!isSnapshot(file.view())) {
+        throw std::runtime_error("Not a snapshot file");
+    }
+
+    const Header& head = header();
+    if (head.version != Version) {
+        throw std::runtime_error("Unsupported snapshot version " + std::to_string(head.version));
+    }
+    if (head.byteOrder != ByteOrderMark) {
+        throw std::runtime_error("Snapshot was written with a different byte order");
+    }
+    if (head.headerChecksum != checksum(file.view().data(), offsetof(Header, headerChecksum))) {
+        throw std::runtime_error("Corrupted snapshot header");
+    }
+    if (head.wordCount == 0 || head.wordCount > (file.size() - sizeof(Header)) / sizeof(uint64_t) ||
+        file.size() - sizeof(Header) - head.wordCount * sizeof(uint64_t) != head.stringBytes) {
+        throw std::runtime_error("Truncated snapshot");
+    }
+
+    // Every string of the snapshot is flagged as source text, the source is the string area
+    const char* words = file.view().data() + sizeof(Header);
+    view.data = reinterpret_cast<const uint64_t*>(words);
+    view.count = static_cast<size_t>(head.wordCount);
+    view.source = std::string_view(words + head.wordCount * sizeof(uint64_t), static_cast<size_t>(head.stringBytes));
+}
+
+bool Snapshot::verify() const {
+    const Header& head = header();
+    const char* words = file.view().data() + sizeof(Header);
+    size_t wordBytes = static_cast<size_t>(head.wordCount) * sizeof(uint64_t);
+    return head.payloadChecksum == checksum(words + wordBytes, static_cast<size_t>(head.stringBytes), checksum(words, wordBytes));
+}
@@ -0,0 +1,155 @@
+// src/stats.cpp
+#include "../include/json_parser/stats.hpp"
+
+#if JSON_EVAL_STATS
+
+#include <atomic>
+#include <cstdio>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+constexpr size_t PhaseCount = 4;
+constexpr const char* PhaseNames[PhaseCount] = {"read", "parse", "evaluate", "print"};
+
+// Allocations and tasks come from any thread, phases are only opened on the main one
+std::atomic<uint64_t> allocationCount{0};
+std::atomic<uint64_t> allocationBytes{0};
+std::atomic<uint64_t> taskCount{0};
+
+struct PhaseTotals {
+    double seconds = 0;
+    uint64_t allocations = 0;
+    uint64_t allocatedBytes = 0;
+    uint64_t tasks = 0;
+};
+
+PhaseTotals phases[PhaseCount];
+uint64_t bytesRead = 0;
+
+enum NodeKind { Null, Bool, Int, Double, String, Array, Object, NodeKinds };
+constexpr const char* NodeNames[NodeKinds] = {"null", "bool", "int", "double", "string", "array", "object"};
+uint64_t nodes[NodeKinds] = {};
+
+long peakRssKb() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return static_cast<long>(counters.PeakWorkingSetSize / 1024);
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+#endif
+}
+
+} // namespace
+
+Stats::Scope::Scope(Phase phase)
+    : phase(phase), start(std::chrono::steady_clock::now()),
+      allocations(allocationCount.load(std::memory_order_relaxed)),
+      allocatedBytes(allocationBytes.load(std::memory_order_relaxed)),
+      tasks(taskCount.load(std::memory_order_relaxed)) {}
+
+Stats::Scope::~Scope() {
+    PhaseTotals& totals = phases[static_cast<size_t>(phase)];
+    totals.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    totals.allocations += allocationCount.load(std::memory_order_relaxed) - allocations;
+    totals.allocatedBytes += allocationBytes.load(std::memory_order_relaxed) - allocatedBytes;
+    totals.tasks += taskCount.load(std::memory_order_relaxed) - tasks;
+}
+
+void Stats::countAllocation(size_t bytes) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocationBytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void Stats::countTask() {
+    taskCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Stats::addBytesRead(size_t bytes) {
+    bytesRead += bytes;
+}
+
+void Stats::countNodes(const JsonTape& tape) {
+    // An explicit stack, documents may nest deeper than the call stack allows
+    std::vector<JsonTape::Ref> pending{tape.root()};
+    while (!pending.empty()) {
+        JsonTape::Ref value = pending.back();
+        pending.pop_back();
+
+        if (value.isPackedInt() || value.isPackedDouble()) {
+            ++nodes[Array];
+            nodes[value.isPackedInt() ? Int : Double] += value.size();
+        } else if (value.isArray()) {
+            ++nodes[Array];
+            value.forEach([&pending](const JsonTape::Ref& item) { pending.push_back(item); });
+        } else if (value.isObject()) {
+            ++nodes[Object];
+            for (JsonTape::Ref key = value.child(); !key.isEnd(); key = key.after().after()) {
+                pending.push_back(key.after());
+            }
+        } else if (value.isString()) {
+            ++nodes[String];
+        } else if (value.isInt()) {
+            ++nodes[Int];
+        } else if (value.isDouble()) {
+            ++nodes[Double];
+        } else if (value.isBool()) {
+            ++nodes[Bool];
+        } else {
+            ++nodes[Null];
+        }
+    }
+}
+
+void Stats::report(std::ostream& out, bool asJson) {
+    char line[160];
+    if (asJson) {
+        out << "{\"phases\": {";
+        for (size_t i = 0; i < PhaseCount; ++i) {
+            std::snprintf(line, sizeof(line), "%s\"%s\": {\"ms\": %.3f, \"allocations\": %llu, \"allocated_bytes\": %llu, \"pool_tasks\": %llu}",
+                          i > 0 ? ", " : "", PhaseNames[i], phases[i].seconds * 1e3,
+                          static_cast<unsigned long long>(phases[i].allocations),
+                          static_cast<unsigned long long>(phases[i].allocatedBytes),
+                          static_cast<unsigned long long>(phases[i].tasks));
+            out << line;
+        }
+        out << "}, \"bytes_read\": " << bytesRead << ", \"nodes\": {";
+        for (size_t i = 0; i < NodeKinds; ++i) {
+            out << (i > 0 ? ", " : "") << '"' << NodeNames[i] << "\": " << nodes[i];
+        }
+        out << "}, \"allocations\": " << allocationCount.load() << ", \"allocated_bytes\": " << allocationBytes.load()
+            << ", \"peak_rss_kb\": " << peakRssKb() << "}\n";
+        return;
+    }
+
+    out << "phase          ms   allocations        bytes   pool tasks\n";
+    for (size_t i = 0; i < PhaseCount; ++i) {
+        std::snprintf(line, sizeof(line), "%-8s %10.3f %13llu %12llu %12llu\n", PhaseNames[i], phases[i].seconds * 1e3,
+                      static_cast<unsigned long long>(phases[i].allocations),
+                      static_cast<unsigned long long>(phases[i].allocatedBytes),
+                      static_cast<unsigned long long>(phases[i].tasks));
+        out << line;
+    }
+    out << "bytes read: " << bytesRead << "\nnodes:";
+    for (size_t i = 0; i < NodeKinds; ++i) {
+        out << (i > 0 ? ", " : " ") << NodeNames[i] << ' ' << nodes[i];
+    }
+    out << "\nheap: " << allocationCount.load() << " allocations, " << allocationBytes.load() << " bytes"
+        << "\npeak RSS: " << peakRssKb() << " KB\n";
+}
+
+#endif // JSON_EVAL_STATS
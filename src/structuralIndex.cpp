@@ -0,0 +1,248 @@
+// src/structuralIndex.cpp
+#include "../include/json_parser/structuralIndex.hpp"
+#include "../include/json_parser/simd.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace {
+
+// Character classes of one 64-byte block, bit i describes byte i
+struct BlockMasks {
+    uint64_t quote;
+    uint64_t backslash;
+    uint64_t whitespace;
+    uint64_t op;
+};
+
+BlockMasks classifyScalar(const char* block) {
+    BlockMasks masks{0, 0, 0, 0};
+    for (unsigned i = 0; i < 64; ++i) {
+        uint64_t bit = uint64_t(1) << i;
+        switch (block[i]) {
+            case '"': masks.quote |= bit; break;
+            case '\\': masks.backslash |= bit; break;
+            case ' ':
+            case '\t':
+            case '\n':
+            case '\r': masks.whitespace |= bit; break;
+            case '{':
+            case '}':
+            case '[':
+            case ']':
+            case ':':
+            case ',': masks.op |= bit; break;
+            default: break;
+        }
+    }
+    return masks;
+}
+
+#if JSON_PARSER_X86
+
+JSON_PARSER_TARGET("sse4.2")
+uint64_t equalMaskSse(const __m128i chunks[4], char c) {
+    const __m128i needle = _mm_set1_epi8(c);
+    uint64_t mask = 0;
+    for (int i = 0; i < 4; ++i) {
+        mask |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunks[i], needle)))) << (16 * i);
+    }
+    return mask;
+}
+
+JSON_PARSER_TARGET("sse4.2")
+BlockMasks classifySse42(const char* block) {
+    __m128i chunks[4];
+    __m128i folded[4];
+    const __m128i caseBit = _mm_set1_epi8(0x20);
+    for (int i = 0; i < 4; ++i) {
+        chunks[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16 * i));
+        // '[' | 0x20 == '{' and ']' | 0x20 == '}', so brackets and braces share one compare each
+        folded[i] = _mm_or_si128(chunks[i], caseBit);
+    }
+
+    BlockMasks masks;
+    masks.quote = equalMaskSse(chunks, '"');
+    masks.backslash = equalMaskSse(chunks, '\\');
+    masks.whitespace = equalMaskSse(chunks, ' ') | equalMaskSse(chunks, '\t') | equalMaskSse(chunks, '\n') | equalMaskSse(chunks, '\r');
+    masks.op = equalMaskSse(folded, '{') | equalMaskSse(folded, '}') | equalMaskSse(chunks, ':') | equalMaskSse(chunks, ',');
+    return masks;
+}
+
+JSON_PARSER_TARGET("avx2")
+uint64_t equalMaskAvx2(__m256i lo, __m256i hi, char c) {
+    const __m256i needle = _mm256_set1_epi8(c);
+    uint64_t low = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, needle)));
+    uint64_t high = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, needle)));
+    return low | (high << 32);
+}
+
+JSON_PARSER_TARGET("avx2")
+BlockMasks classifyAvx2(const char* block) {
+    const __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+    const __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32));
+    const __m256i caseBit = _mm256_set1_epi8(0x20);
+    const __m256i foldedLo = _mm256_or_si256(lo, caseBit);
+    const __m256i foldedHi = _mm256_or_si256(hi, caseBit);
+
+    BlockMasks masks;
+    masks.quote = equalMaskAvx2(lo, hi, '"');
+    masks.backslash = equalMaskAvx2(lo, hi, '\\');
+    masks.whitespace = equalMaskAvx2(lo, hi, ' ') | equalMaskAvx2(lo, hi, '\t') | equalMaskAvx2(lo, hi, '\n') | equalMaskAvx2(lo, hi, '\r');
+    masks.op = equalMaskAvx2(foldedLo, foldedHi, '{') | equalMaskAvx2(foldedLo, foldedHi, '}') |
+               equalMaskAvx2(lo, hi, ':') | equalMaskAvx2(lo, hi, ',');
+    return masks;
+}
+
+#endif
+
+uint64_t prefixXor(uint64_t bits) {
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+}
+
+/**
+ * @brief State carried from one 64-byte block to the next
+ *
+ * Turns the raw character classes into token starts: backslash runs decide which quotes are
+ * escaped, a prefix XOR over the real quotes yields the in-string mask, and scalars start where
+ * a non-whitespace byte follows whitespace or a structural character.
+ */
+struct BlockScanner {
+    uint64_t prevEscaped = 0;     // First byte of the next block is escaped
+    uint64_t prevInString = 0;    // All ones while the previous block ended inside a string
+    uint64_t prevSeparator = 1;   // Last byte of the previous block was whitespace or structural
+
+    uint64_t next(const BlockMasks& masks) {
+        // Backslashes escape the following byte, runs of them cancel out pairwise
+        const uint64_t evenBits = 0x5555555555555555ULL;
+        uint64_t backslash = masks.backslash & ~prevEscaped;
+        uint64_t followsEscape = (backslash << 1) | prevEscaped;
+        uint64_t oddSequenceStarts = backslash & ~evenBits & ~followsEscape;
+        uint64_t sequencesStartingOnEvenBits = oddSequenceStarts + backslash;
+        prevEscaped = sequencesStartingOnEvenBits < backslash ? 1 : 0;
+        uint64_t invertMask = sequencesStartingOnEvenBits << 1;
+        uint64_t escaped = (evenBits ^ invertMask) & followsEscape;
+
+        // Opening quote and string contents are inside, the closing quote is not
+        uint64_t quote = masks.quote & ~escaped;
+        uint64_t inString = prefixXor(quote) ^ prevInString;
+        prevInString = static_cast<uint64_t>(static_cast<int64_t>(inString) >> 63);
+
+        uint64_t op = masks.op & ~inString;
+        uint64_t separator = masks.whitespace | op;
+        uint64_t scalar = ~(separator | quote) & ~inString;
+        uint64_t scalarStart = scalar & ((separator << 1) | prevSeparator | (quote << 1));
+        prevSeparator = ((separator | quote) >> 63) & 1;
+
+        return op | quote | scalarStart;
+    }
+};
+
+template <BlockMasks (*Classify)(const char*)>
+void buildIndex(std::string_view content, std::vector<uint64_t>& tokens) {
+    BlockScanner scanner;
+    const size_t fullBlocks = content.size() / 64;
+
+    for (size_t i = 0; i < fullBlocks; ++i) {
+        tokens[i] = scanner.next(Classify(content.data() + i * 64));
+    }
+
+    // The tail is padded with spaces so it never contributes a token
+    size_t tail = content.size() - fullBlocks * 64;
+    if (tail > 0) {
+        char block[64];
+        std::memset(block, ' ', sizeof(block));
+        std::memcpy(block, content.data() + fullBlocks * 64, tail);
+        tokens[fullBlocks] = scanner.next(Classify(block));
+    }
+}
+
+// The best kernel the CPU (and for AVX2 the OS) supports
+StructuralIndex::Kernel supportedKernel() {
+#if JSON_PARSER_X86 && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return StructuralIndex::Kernel::Avx2;
+    }
+    if (__builtin_cpu_supports("sse4.2")) {
+        return StructuralIndex::Kernel::Sse42;
+    }
+#elif JSON_PARSER_X86 && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    __cpuid(info, 1);
+    bool sse42 = (info[2] & (1 << 20)) != 0;
+    bool osSavesYmm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+    if (maxLeaf >= 7 && osSavesYmm) {
+        __cpuidex(info, 7, 0);
+        if (info[1] & (1 << 5)) {
+            return StructuralIndex::Kernel::Avx2;
+        }
+    }
+    if (sse42) {
+        return StructuralIndex::Kernel::Sse42;
+    }
+#endif
+
+    return StructuralIndex::Kernel::Scalar;
+}
+
+// JSON_EVAL_SIMD picks a kernel below the supported one, never above: an unsupported instruction
+// set would fault on the first document
+StructuralIndex::Kernel detectKernel() {
+    StructuralIndex::Kernel supported = supportedKernel();
+    if (const char* forced = std::getenv("JSON_EVAL_SIMD")) {
+        std::string name(forced);
+        StructuralIndex::Kernel requested = supported;
+        if (name == "scalar") {
+            requested = StructuralIndex::Kernel::Scalar;
+        } else if (name == "sse42") {
+            requested = StructuralIndex::Kernel::Sse42;
+        } else if (name == "avx2") {
+            requested = StructuralIndex::Kernel::Avx2;
+        }
+        return std::min(requested, supported);
+    }
+    return supported;
+}
+
+} // namespace
+
+StructuralIndex::Kernel StructuralIndex::activeKernel() {
+    static const Kernel kernel = detectKernel();
+    return kernel;
+}
+
+const char* StructuralIndex::kernelName(Kernel kernel) {
+    switch (kernel) {
+        case Kernel::Avx2: return "avx2";
+        case Kernel::Sse42: return "sse42";
+        default: return "scalar";
+    }
+}
+
+StructuralIndex::StructuralIndex(std::string_view content, Kernel kernel)
+    : content(content), tokens((content.size() + 63) / 64) {
+#if JSON_PARSER_X86
+    if (kernel == Kernel::Avx2) {
+        buildIndex<classifyAvx2>(content, tokens);
+        return;
+    }
+    if (kernel == Kernel::Sse42) {
+        buildIndex<classifySse42>(content, tokens);
+        return;
+    }
+#else
+    (void)kernel;
+#endif
+    buildIndex<classifyScalar>(content, tokens);
+}
@@ -0,0 +1,127 @@
+// src/threadPool.cpp
+#include "../include/json_parser/threadPool.hpp"
+#include "../include/json_parser/stats.hpp"
+
+namespace {
+
+// Identifies the pool and queue of the current worker thread, so nested submits stay local
+thread_local const ThreadPool* currentPool = nullptr;
+thread_local size_t currentQueue = 0;
+
+} // namespace
+
+ThreadPool::ThreadPool(size_t threadCount) {
+    threadCount = std::max<size_t>(threadCount, 1);
+    for (size_t i = 0; i < threadCount; ++i) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+    for (size_t i = 0; i < threadCount; ++i) {
+        threads.emplace_back([this, i]() { workerLoop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+ThreadPool& ThreadPool::instance() {
+    static ThreadPool pool(std::thread::hardware_concurrency());
+    return pool;
+}
+
+void ThreadPool::push(std::function<void()> task) {
+    Stats::countTask();
+    size_t target = currentPool == this ? currentQueue : nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+    {
+        // Counted before it is queued so pending never drops below the number of queued tasks;
+        // taking the lock orders the increment against a worker deciding to sleep
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        pending.fetch_add(1, std::memory_order_release);
+    }
+    {
+        std::lock_guard<std::mutex> lock(queues[target]->mutex);
+        queues[target]->tasks.push_back(std::move(task));
+    }
+    wake.notify_one();
+}
+
+// Own queue from the back (newest, still hot in cache), other queues from the front
+bool ThreadPool::tryPop(size_t self, std::function<void()>& task) {
+    {
+        std::lock_guard<std::mutex> lock(queues[self]->mutex);
+        if (!queues[self]->tasks.empty()) {
+            task = std::move(queues[self]->tasks.back());
+            queues[self]->tasks.pop_back();
+            pending.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    for (size_t i = 1; i < queues.size(); ++i) {
+        Queue& victim = *queues[(self + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            pending.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ThreadPool::runPendingTask() {
+    if (pending.load(std::memory_order_acquire) == 0) {
+        return false;
+    }
+
+    std::function<void()> task;
+    size_t self = currentPool == this ? currentQueue : 0;
+    if (!tryPop(self, task)) {
+        return false;
+    }
+    task();
+    executed.fetch_add(1, std::memory_order_relaxed);
+    notifyWaiters();
+    return true;
+}
+
+// Called after every task: it may have been the one a thread in helpUntil waits for. Taking the
+// lock orders the wake-up against that thread checking its condition before it sleeps
+void ThreadPool::notifyWaiters() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters.load(std::memory_order_relaxed) != 0) {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+        }
+        wake.notify_all();
+    }
+}
+
+void ThreadPool::workerLoop(size_t index) {
+    currentPool = this;
+    currentQueue = index;
+
+    while (true) {
+        std::function<void()> task;
+        if (tryPop(index, task)) {
+            task();
+            executed.fetch_add(1, std::memory_order_relaxed);
+            notifyWaiters();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wake.wait(lock, [this]() { return stopping || pending.load(std::memory_order_acquire) != 0; });
+        if (stopping) {
+            return;
+        }
+    }
+}
@@ -6,8 +6,10 @@ NC='\033[0m'
 # Detect OS and set executable path
 if [[ "$OSTYPE" == "msys" || "$OSTYPE" == "cygwin" || "$OSTYPE" == "win32" ]]; then
     EXECUTABLE="./build/Debug/json_eval.exe"
+    BENCH="./build/Debug/json_bench.exe"
 else
     EXECUTABLE="./build/json_eval"
+    BENCH="./build/json_bench"
 fi
 
 # Parse command line arguments
@@ -50,17 +52,18 @@ run_test() {
     local input_file="$2"
     local expression="$3"
     local expected="$4"
+    local options="$5"
     
     TOTAL=$((TOTAL + 1))
     
     if [ "$VERBOSE" = true ]; then
         echo "Testing: $desc"
-        echo "Command: $EXECUTABLE '$input_file' '$expression'"
-        result=$($EXECUTABLE "$input_file" "$expression" 2>&1)
+        echo "Command: $EXECUTABLE $options '$input_file' '$expression'"
+        result=$($EXECUTABLE $options "$input_file" "$expression" 2>&1)
         echo "Output : $result"
     else
         echo "Testing: $desc... "
-        result=$($EXECUTABLE "$input_file" "$expression" 2>&1)
+        result=$($EXECUTABLE $options "$input_file" "$expression" 2>&1)
     fi
     
     if [ "$result" == "$expected" ]; then
@@ -100,10 +103,116 @@ cat > $TEST_DIR/numbers.json << EOF
         -1,
         1.5,
         -1.5
-    ]
+    ],
+    "big": [9007199254740993, 9007199254740992],
+    "d": [2.5, -0.5, 1.25],
+    "p": 0.30000000000000004,
+    "e": [1e9, 1E2, -2.5e-3],
+    "imax": 9223372036854775807,
+    "huge": 18446744073709551616
 }
 EOF
 
+cat > $TEST_DIR/orders.json << 'EOF'
+{"order": {"items": [{"price": 10, "qty": 2}, {"price": 2.5}, {"name": "gift"}, {"price": 7, "qty": 1}]}, "n": [5, 1, 9, 3, 7]}
+EOF
+
+cat > $TEST_DIR/bad_number.json << 'EOF'
+[1, 01]
+EOF
+
+cat > $TEST_DIR/strings.json << 'EOF'
+{
+    "plain": "test",
+    "escaped": "a\"b\\c\u00e9",
+    "brackets": "]}\\\"[{,:",
+    "empty": [],
+    "none": {}
+}
+EOF
+
+cat > $TEST_DIR/wide.json << 'EOF'
+{"small": {"z": 1, "a": 2, "m": 3}, "wide": {"k0": 0, "k1": 1, "k2": 2, "k3": 3, "k4": 4, "k5": 5, "k6": 6, "k7": 7, "k8": 8, "k9": 9, "k10": 10, "k11": 11, "k12": 12, "k13": 13, "k14": 14, "k15": 15, "k16": 16, "k17": 17, "k18": 18, "k19": 19}}
+EOF
+
+cat > $TEST_DIR/parallel.json << 'EOF'
+[{"id": 1, "name": "a\"b"}, [1, 2, 3], "x\ty", 2.5, {"id": 5, "tags": ["p", "q"]}, [-4, 9]]
+EOF
+
+cat > $TEST_DIR/repeated.json << 'EOF'
+{"o": {"a": 1, "a": 2}}
+EOF
+
+cat > $TEST_DIR/duplicates.json << 'EOF'
+{"a": 1, "b": {"c": 3, "x": [7, 8], "c": 4}, "a": [[1, 2], {"k": "v"}], "d": "w", "a": {"z": [2.5]}}
+EOF
+
+cat > $TEST_DIR/lines.ndjson << 'EOF'
+{"v": 3, "list": [1, 2, 3]}
+{"v": -7, "list": []}
+
+{"v": 2.5, "list": [4]}
+EOF
+
+cat > $TEST_DIR/batch_subtrees.txt << 'EOF'
+a.b[3]
+a
+EOF
+
+cat > $TEST_DIR/batch.txt << 'EOF'
+a.b[0]
+a.b[1]
+
+size(a.b)
+a.b[3][1]
+a.b[a.b[1]].c
+EOF
+
+cat > $TEST_DIR/batch_errors.txt << 'EOF'
+a.b[1]
+a.x
+EOF
+
+printf 'a.b[\t1]\na.x\n' > $TEST_DIR/batch_escapes.txt
+
+cat > $TEST_DIR/batch_filters.txt << 'EOF'
+users[?id==5].name
+users[?id==6 && age>0].age
+users[?id==1000].name
+EOF
+
+# 100 users, enough for batch filters to build an index
+{
+    echo '{"users": ['
+    for i in $(seq 0 99); do
+        echo "{\"id\": $i, \"name\": \"user$i\", \"age\": $(( (i * 7) % 60 + 18 ))}"
+    done | paste -sd, -
+    echo ']}'
+} > $TEST_DIR/users.json
+
+# 300 members and a repeated key, enough for lookups to go through a key table
+{
+    echo '{"many": {'
+    for i in $(seq 0 299); do
+        echo "\"k$i\": $i"
+    done | paste -sd, -
+    echo ', "k5": "last"}}'
+} > $TEST_DIR/many_keys.json
+
+cat > $TEST_DIR/batch_many_keys.txt << 'EOF'
+many.k0
+many.k299
+many.k5
+many.k300
+many.k150
+EOF
+
+{
+    echo '{"a": ['
+    seq -s ', ' -20000 20000
+    echo '], "i": [0, 1, 2, 3]}'
+} > $TEST_DIR/large.json
+
 echo "Starting tests..."
 echo "================="
 echo "Basic Path Expressions"
@@ -115,6 +224,11 @@ run_test "Access nested object property" "$TEST_DIR/basic.json" "a.b[2].c" "\"te
 run_test "Get complete array contents" "$TEST_DIR/basic.json" "a.b" "[1, 2, {\"c\": \"test\"}, [11, 12]]"
 run_test "Dynamic array indexing using path" "$TEST_DIR/basic.json" "a.b[a.b[1]].c" "\"test\""
 run_test "Access nested array element" "$TEST_DIR/basic.json" "a.b[3][1]" "12"
+run_test "Whitespace around tokens is ignored" "$TEST_DIR/basic.json" " a . b [ 1 ] " "2"
+run_test "Whitespace ends a key" "$TEST_DIR/basic.json" "a b" $'\e[1;31mError: Unexpected \'b\' at position 2\e[0m'
+# Pipes cannot be mapped, they are read instead
+run_test "Read document from a pipe" <(echo '{"a": [1, 2]}') "a[1]" "2"
+run_test "Read JSON Lines from a pipe" <(printf '{"v": 1}\n{"v": 5}\n') "v" $'1\n5' "--lines"
 
 echo "================="
 echo "Built-in Functions"
@@ -126,6 +240,9 @@ run_test "Min of nested array" "$TEST_DIR/basic.json" "min(a.b[3])" "11"
 run_test "Size of object" "$TEST_DIR/basic.json" "size(a)" "1"
 run_test "Size of array" "$TEST_DIR/basic.json" "size(a.b)" "4"
 run_test "Size of string from dynamic path" "$TEST_DIR/basic.json" "size(a.b[a.b[1]].c)" "4"
+# The CLI evaluates the tape, a repeated key must answer as it did when it evaluated the DOM
+run_test "Size of object with a repeated key" "$TEST_DIR/repeated.json" "size(o)" "1"
+run_test "Object with a repeated key" "$TEST_DIR/repeated.json" "o" "{\"a\": 2}"
 
 echo "================="
 echo "Number Operations"
@@ -143,6 +260,239 @@ run_test "Positive integer access" "$TEST_DIR/numbers.json" "a[0]" "1"
 run_test "Negative integer access" "$TEST_DIR/numbers.json" "a[1]" "-1"
 run_test "Positive float access" "$TEST_DIR/numbers.json" "a[2]" "1.5"
 run_test "Negative float access" "$TEST_DIR/numbers.json" "a[3]" "-1.5"
+run_test "Max keeps int64 precision" "$TEST_DIR/numbers.json" "max(big)" "9007199254740993"
+run_test "Min of double array" "$TEST_DIR/numbers.json" "min(d)" "-0.5"
+run_test "Min of mixed int and double array" "$TEST_DIR/numbers.json" "min(a)" "-1.5"
+run_test "Exponent number" "$TEST_DIR/numbers.json" "e[0]" "1e+09"
+run_test "Negative exponent" "$TEST_DIR/numbers.json" "min(e)" "-0.0025"
+run_test "Largest int64 stays exact" "$TEST_DIR/numbers.json" "imax" "9223372036854775807"
+run_test "Integer beyond int64 becomes double" "$TEST_DIR/numbers.json" "max(huge, 1)" "18446744073709551616"
+run_test "Leading zero rejected" "$TEST_DIR/bad_number.json" "[0]" $'\e[1;31mError: Invalid JSON value: Number has a leading zero at byte 5\e[0m'
+
+echo "================="
+echo "Strings and Containers"
+echo "================="
+
+# Strings are read straight from the mapped file, escapes are decoded
+run_test "Unescaped string" "$TEST_DIR/strings.json" "plain" "\"test\""
+run_test "Size of escaped string" "$TEST_DIR/strings.json" "size(escaped)" "7"
+run_test "Size of empty array" "$TEST_DIR/strings.json" "size(empty)" "0"
+run_test "Size of empty object" "$TEST_DIR/strings.json" "size(none)" "0"
+run_test "Structural characters inside string" "$TEST_DIR/strings.json" "size(brackets)" "8"
+run_test "Object members keep document order" "$TEST_DIR/wide.json" "small" '{"z":1,"a":2,"m":3}' "--compact"
+run_test "Indexed object keeps document order" "$TEST_DIR/wide.json" "wide" '{"k0":0,"k1":1,"k2":2,"k3":3,"k4":4,"k5":5,"k6":6,"k7":7,"k8":8,"k9":9,"k10":10,"k11":11,"k12":12,"k13":13,"k14":14,"k15":15,"k16":16,"k17":17,"k18":18,"k19":19}' "--compact"
+
+echo "================="
+echo "SIMD Kernels"
+echo "================="
+
+# The structural index must be identical whichever kernel builds it
+JSON_EVAL_SIMD=scalar run_test "Scalar kernel dynamic path" "$TEST_DIR/basic.json" "a.b[a.b[1]].c" "\"test\""
+JSON_EVAL_SIMD=sse42 run_test "SSE4.2 kernel nested array" "$TEST_DIR/basic.json" "min(a.b[3])" "11"
+JSON_EVAL_SIMD=scalar run_test "Scalar kernel escaped string" "$TEST_DIR/strings.json" "size(brackets)" "8"
+JSON_EVAL_SIMD=scalar run_test "Scalar kernel int64 max" "$TEST_DIR/numbers.json" "max(big, 1)" "9007199254740993"
+JSON_EVAL_SIMD=sse42 run_test "SSE4.2 kernel double min" "$TEST_DIR/numbers.json" "min(d, 0)" "-0.5"
+
+echo "================="
+echo "DOM Construction"
+echo "================="
+
+# json_bench parses every generated shape into the DOM and counts the allocations against its nodes
+EXECUTABLE="$BENCH" run_test "Every DOM node is allocated once" "--size" "1" $'deep: ok\nwide: ok\nnumeric: ok\nscientific: ok\nlogs: ok\nndjson: ok' "--check-allocations"
+# A repeated key keeps its first position and takes the last value, in the DOM and on the tape
+JSON_EVAL_CHUNK_BYTES=8 EXECUTABLE="$BENCH" run_test "Repeated keys merge alike in DOM and tape" "--check-parsers" "$TEST_DIR/duplicates.json" '{"a":{"z":[2.5]},"b":{"c":4,"x":[7,8]},"d":"w"}'
+run_test "Repeated key takes the last value" "$TEST_DIR/duplicates.json" "a.z[0]" "2.5"
+run_test "Repeated keys count once" "$TEST_DIR/duplicates.json" "size(b)" "2"
+run_test "Repeated keys with selective parsing" "$TEST_DIR/duplicates.json" "size(b)" "2" "--selective"
+JSON_EVAL_CHUNK_BYTES=8 run_test "Repeated keys across parallel chunks" "$TEST_DIR/duplicates.json" "a" '{"z":[2.5]}' "--parallel --compact"
+
+echo "================="
+echo "Selective Parsing"
+echo "================="
+
+# Only the paths the expression reaches are parsed, results must not change
+run_test "Selective array element" "$TEST_DIR/basic.json" "a.b[1]" "2" "--selective"
+run_test "Selective dynamic subscript" "$TEST_DIR/basic.json" "a.b[a.b[1]].c" "\"test\"" "--selective"
+run_test "Selective size of array" "$TEST_DIR/basic.json" "size(a.b)" "4" "--selective"
+run_test "Selective max with literals" "$TEST_DIR/basic.json" "max(a.b[0], 10, a.b[1], 15)" "15" "--selective"
+run_test "Selective skips escaped strings" "$TEST_DIR/strings.json" "size(none)" "0" "--selective"
+
+echo "================="
+echo "Parallel Parsing"
+echo "================="
+
+# Tiny chunks force the top-level container to be split between its elements
+JSON_EVAL_CHUNK_BYTES=8 run_test "Parallel parse keeps element order" "$TEST_DIR/parallel.json" "[4].tags[1]" "\"q\"" "--parallel"
+JSON_EVAL_CHUNK_BYTES=8 run_test "Parallel parse decodes escapes" "$TEST_DIR/parallel.json" "[0]" '{"id":1,"name":"a\"b"}' "--parallel --compact"
+JSON_EVAL_CHUNK_BYTES=8 run_test "Parallel parse of top-level object" "$TEST_DIR/large.json" "min(a[i[3]], a)" "-20000" "--parallel"
+JSON_EVAL_CHUNK_BYTES=1 run_test "Parallel parse reports the global offset" "$TEST_DIR/bad_number.json" "[0]" $'\e[1;31mError: Invalid JSON value: Number has a leading zero at byte 5\e[0m' "--parallel"
+
+echo "================="
+echo "Parallel Evaluation"
+echo "================="
+
+# Long arrays are reduced in chunks, costly arguments run on the thread pool
+run_test "Max of large array" "$TEST_DIR/large.json" "max(a)" "20000"
+run_test "Min of large array with literal" "$TEST_DIR/large.json" "min(a, 5)" "-20000"
+run_test "Min of expensive arguments" "$TEST_DIR/large.json" "min(a[i[i[i[3]]]], a[i[i[i[1]]]], 7)" "-19999"
+
+echo "================="
+echo "Projections"
+echo "================="
+
+# Elements the rest of the path does not reach are left out of a projection
+run_test "Projection lists every match" "$TEST_DIR/orders.json" "order.items[*].price" "[10, 2.5, 7]"
+run_test "Sum of projection" "$TEST_DIR/orders.json" "sum(order.items[*].price)" "19.5"
+run_test "Count of projection" "$TEST_DIR/orders.json" "count(order.items[*].qty)" "2"
+run_test "Average of slice" "$TEST_DIR/orders.json" "avg(n[1:3])" "5"
+run_test "Negative slice bound" "$TEST_DIR/orders.json" "n[-2:]" "[3, 7]"
+run_test "Sum of packed array" "$TEST_DIR/orders.json" "sum(n[::2], n)" "46"
+run_test "Selective projection and index" "$TEST_DIR/orders.json" "max(order.items[3].qty, order.items[*].price)" "10" "--selective"
+
+echo "================="
+echo "Filters"
+echo "================="
+
+run_test "Filter by equality" "$TEST_DIR/users.json" "users[?id==42].name" "[\"user42\"]"
+run_test "Filter keeps document order" "$TEST_DIR/users.json" "users[?id==3 || id==1].id" "[1, 3]"
+run_test "Count with negated filter" "$TEST_DIR/users.json" "count(users[?age>=70 && !(id<90)])" "1"
+run_test "Filter on string literal" "$TEST_DIR/users.json" "users[?name=='user7'].id" "[7]"
+run_test "Selective filter" "$TEST_DIR/users.json" "users[?id==42].name" "[\"user42\"]" "--selective"
+run_test "Batch filters share an index" "$TEST_DIR/batch_filters.txt" "$TEST_DIR/users.json" $'["user5"]\n[60]\n[]' "--batch"
+run_test "Filter needs ==" "$TEST_DIR/users.json" "users[?id=42]" $'\e[1;31mError: Unexpected \'=\' at position 9\e[0m'
+
+echo "================="
+echo "JSON Lines"
+echo "================="
+
+run_test "Lines mode evaluates every record in order" "$TEST_DIR/lines.ndjson" "v" $'3\n-7\n2.5' "--lines"
+run_test "Lines mode with functions" "$TEST_DIR/lines.ndjson" "size(list)" $'3\n0\n1' "--lines"
+run_test "Lines mode prints selected subtrees" "$TEST_DIR/lines.ndjson" "list" $'[1, 2, 3]\n[]\n[4]' "--lines"
+run_test "Lines mode compact" "$TEST_DIR/lines.ndjson" "list" $'[1,2,3]\n[]\n[4]' "--lines --compact"
+run_test "Lines mode pretty" "$TEST_DIR/lines.ndjson" "list" $'[\n  1,\n  2,\n  3\n]\n[]\n[\n  4\n]' "--lines --pretty"
+run_test "Lines aggregate min" "$TEST_DIR/lines.ndjson" "v" "-7" "--lines --aggregate min"
+run_test "Lines aggregate max of selective results" "$TEST_DIR/lines.ndjson" "size(list)" "3" "--lines --selective --aggregate max"
+run_test "Lines aggregate avg" "$TEST_DIR/lines.ndjson" "v" "-0.5" "--lines --aggregate avg"
+run_test "Lines aggregate count" "$TEST_DIR/lines.ndjson" "v" "3" "--lines --aggregate count"
+run_test "Lines mode reports misses per record" "$TEST_DIR/lines.ndjson" "list[1]" $'2\nError: line 2: Array index out of bounds: 1\nError: line 4: Array index out of bounds: 1' "--lines"
+
+echo "================="
+echo "Batch Mode"
+echo "================="
+
+# --batch takes the expression file, so the document goes in the expression slot
+run_test "Batch prints one result per expression" "$TEST_DIR/batch.txt" "$TEST_DIR/basic.json" $'1\n2\n4\n12\n"test"' "--batch"
+run_test "Batch selective parsing" "$TEST_DIR/batch.txt" "$TEST_DIR/basic.json" $'1\n2\n4\n12\n"test"' "--selective --batch"
+run_test "Batch as JSON object" "$TEST_DIR/batch.txt" "$TEST_DIR/basic.json" '{"a.b[0]": 1, "a.b[1]": 2, "size(a.b)": 4, "a.b[3][1]": 12, "a.b[a.b[1]].c": "test"}' "--json --batch"
+run_test "Batch compact" "$TEST_DIR/batch_subtrees.txt" "$TEST_DIR/basic.json" $'[11,12]\n{"b":[1,2,{"c":"test"},[11,12]]}' "--compact --batch"
+run_test "Batch as compact JSON object" "$TEST_DIR/batch_errors.txt" "$TEST_DIR/basic.json" '{"a.b[1]":2,"a.x":{"error":"Key '"'x'"' not found"}}' "--compact --json --batch"
+run_test "Batch as pretty JSON object" "$TEST_DIR/batch_errors.txt" "$TEST_DIR/basic.json" $'{\n  "a.b[1]": 2,\n  "a.x": {\n    "error": "Key \'x\' not found"\n  }\n}' "--pretty --json --batch"
+run_test "Batch subtree results" "$TEST_DIR/batch_subtrees.txt" "$TEST_DIR/basic.json" $'[11, 12]\n{"b": [1, 2, {"c": "test"}, [11, 12]]}' "--batch"
+run_test "Batch as JSON object escapes its keys" "$TEST_DIR/batch_escapes.txt" "$TEST_DIR/basic.json" '{"a.b[\t1]": 2, "a.x": {"error": "Key '"'x'"' not found"}}' "--json --batch"
+run_test "Batch reports failures inline" "$TEST_DIR/batch_errors.txt" "$TEST_DIR/basic.json" $'2\nError: Key \'x\' not found' "--batch"
+run_test "Batch lookups into an object with many keys" "$TEST_DIR/batch_many_keys.txt" "$TEST_DIR/many_keys.json" $'0\n299\n"last"\nError: Key \'k300\' not found\n150' "--batch"
+
+echo "================="
+echo "Output"
+echo "================="
+
+run_test "Doubles keep full precision" "$TEST_DIR/numbers.json" "p" "0.30000000000000004"
+run_test "Strings are escaped" "$TEST_DIR/strings.json" "escaped" '"a\"b\\cé"'
+run_test "Compact output" "$TEST_DIR/basic.json" "a.b" '[1,2,{"c":"test"},[11,12]]' "--compact"
+run_test "Pretty output" "$TEST_DIR/basic.json" "a.b[3]" $'[\n  11,\n  12\n]' "--pretty"
+
+# A failed write reaches the error path, the wrapper reports the exit status
+if [ -w /dev/full ]; then
+    printf '#!/bin/sh\n"%s" "$@" > /dev/full\necho "exit $?"\n' "$EXECUTABLE" > $TEST_DIR/write_full.sh
+    EXECUTABLE="sh $TEST_DIR/write_full.sh" run_test "Failed write is an error" "$TEST_DIR/basic.json" "a.b" $'\e[1;31mError: Unable to write output\e[0m\nexit 1'
+    EXECUTABLE="sh $TEST_DIR/write_full.sh" run_test "Failed batch write is an error" "$TEST_DIR/batch.txt" "$TEST_DIR/basic.json" $'\e[1;31mError: Unable to write output\e[0m\nexit 1' "--batch"
+fi
+
+echo "================="
+echo "Statistics"
+echo "================="
+
+# The report goes to stderr and its numbers vary, instrumented builds are checked by pattern
+run_stats_test() {
+    local desc="$1"
+    local input_file="$2"
+    local expression="$3"
+    local pattern="$4"
+    local options="$5"
+
+    TOTAL=$((TOTAL + 1))
+    echo "Testing: $desc... "
+    result=$($EXECUTABLE $options "$input_file" "$expression" 2>&1)
+    if echo "$result" | grep -Eq "$pattern"; then
+        echo -e "${GREEN}PASSED${NC}"
+        PASSED=$((PASSED + 1))
+    else
+        echo -e "${RED}FAILED${NC}"
+        echo "Expected: $pattern"
+        echo "Got     : $result"
+    fi
+    echo "-------------------"
+}
+
+# Only builds configured with -DJSON_EVAL_STATS=ON carry the instrumentation
+if $EXECUTABLE --stats "$TEST_DIR/basic.json" "a.b[0]" > /dev/null 2>&1; then
+    run_stats_test "Stats keep the result first" "$TEST_DIR/basic.json" "a.b[1]" "^2" "--stats"
+    run_stats_test "Stats count nodes by type" "$TEST_DIR/basic.json" "a.b[1]" "nodes: null 0, bool 0, int 4, double 0, string 1, array 2, object 3" "--stats"
+    run_stats_test "Stats as JSON" "$TEST_DIR/numbers.json" "max(big)" '"phases": \{"read": \{"ms": [0-9.]+, "allocations"' "--stats-json"
+else
+    run_test "Stats need an instrumented build" "$TEST_DIR/basic.json" "a.b[1]" $'\e[1;31mError: --stats needs a build configured with -DJSON_EVAL_STATS=ON\e[0m' "--stats"
+fi
+
+echo "================="
+echo "Snapshots"
+echo "================="
+
+# --snapshot takes the output file in the expression slot
+run_test "Write snapshot" "$TEST_DIR/basic.json" "$TEST_DIR/basic.jbin" "" "--snapshot"
+run_test "Snapshot dynamic subscript" "$TEST_DIR/basic.jbin" "a.b[a.b[1]].c" "\"test\""
+run_test "Snapshot verified checksum" "$TEST_DIR/basic.jbin" "max(a.b[3])" "12" "--verify"
+# The header and the file size are checked on every open, with or without --verify
+head -c $(( $(wc -c < "$TEST_DIR/basic.jbin") - 8 )) "$TEST_DIR/basic.jbin" > "$TEST_DIR/truncated.jbin"
+run_test "Truncated snapshot is rejected" "$TEST_DIR/truncated.jbin" "a.b[1]" $'\e[1;31mError: Truncated snapshot\e[0m'
+# A corrupted payload is only found by --verify, but reading it never leaves the tape: the end
+# index of the object "a" (word 3, after the 64-byte header) points past the last word
+cp "$TEST_DIR/basic.jbin" "$TEST_DIR/corrupt_link.jbin"
+printf '\377\377' | dd of="$TEST_DIR/corrupt_link.jbin" bs=1 seek=88 conv=notrunc 2>/dev/null
+run_test "Corrupted snapshot link is rejected" "$TEST_DIR/corrupt_link.jbin" "a" $'\e[1;31mError: Corrupted tape: a link points outside the document\e[0m'
+run_test "Verify rejects plain JSON" "$TEST_DIR/basic.json" "a.b[1]" $'\e[1;31mError: --verify checks snapshot files, '"$TEST_DIR"$'/basic.json is not one\e[0m' "--verify"
+run_test "Snapshot batch" "$TEST_DIR/batch.txt" "$TEST_DIR/basic.jbin" $'1\n2\n4\n12\n"test"' "--batch"
+
+# The daemon needs Unix domain sockets
+if [[ "$OSTYPE" != "msys" && "$OSTYPE" != "cygwin" && "$OSTYPE" != "win32" ]]; then
+    echo "================="
+    echo "Query Server"
+    echo "================="
+
+    SOCKET="$TEST_DIR/eval.sock"
+    $EXECUTABLE --serve "$SOCKET" &
+    SERVER_PID=$!
+    for _ in $(seq 50); do
+        [ -S "$SOCKET" ] && break
+        sleep 0.1
+    done
+
+    run_test "Server answers a query" "$TEST_DIR/basic.json" "a.b[a.b[1]].c" "\"test\"" "--connect $SOCKET"
+    run_test "Server answers from its cache" "$TEST_DIR/basic.json" "size(a.b)" "4" "--connect $SOCKET"
+    run_test "Server answers a filter" "$TEST_DIR/users.json" "users[?id==42].age" "[72]" "--connect $SOCKET"
+    run_test "Server evaluates a snapshot in place" "$TEST_DIR/basic.jbin" "a.b[a.b[1]].c" "\"test\"" "--connect $SOCKET"
+    run_test "Server verifies a snapshot it loads" "$TEST_DIR/corrupt_link.jbin" "a.b[1]" $'\e[1;31mError: Snapshot checksum mismatch\e[0m' "--connect $SOCKET"
+    run_test "Server survives a corrupted snapshot" "$TEST_DIR/basic.json" "a.b[1]" "2" "--connect $SOCKET"
+    JSON_EVAL_SOCKET="$SOCKET" run_test "Plain command line forwarded to server" "$TEST_DIR/numbers.json" "max(big)" "9007199254740993"
+    JSON_EVAL_SOCKET="$SOCKET" run_test "Forwarded query keeps its output style" "$TEST_DIR/basic.json" "a.b[2]" $'{\n  "c": "test"\n}' "--pretty"
+    run_test "Server answers in compact style" "$TEST_DIR/basic.json" "a.b" '[1,2,{"c":"test"},[11,12]]' "--compact --connect $SOCKET"
+    # A corrupted snapshot: the daemon does not verify checksums, so --verify runs locally
+    cp "$TEST_DIR/basic.jbin" "$TEST_DIR/corrupt.jbin"
+    printf 'X' | dd of="$TEST_DIR/corrupt.jbin" bs=1 seek=70 conv=notrunc 2>/dev/null
+    JSON_EVAL_SOCKET="$SOCKET" run_test "Verified query is answered locally" "$TEST_DIR/corrupt.jbin" "a.b[1]" $'\e[1;31mError: Snapshot checksum mismatch\e[0m' "--verify"
+
+    kill $SERVER_PID
+    wait $SERVER_PID 2>/dev/null
+fi
 
 # Error handling tests
 # run_test "Nonexistent file" "nonexistent.json" "value" "Error: Cannot open file nonexistent.json"